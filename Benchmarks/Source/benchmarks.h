@@ -0,0 +1,54 @@
+// Vulkan Renderer - benchmarks.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _BENCHMARKS_H_
+#define _BENCHMARKS_H_
+
+#include <chrono>
+#include <cstdint>
+
+// Each benchmark prints its own report table to stdout
+void runDrawQueueBenchmark();
+void runDispatchBenchmark();
+
+// Best of several runs in microseconds, the minimum is the least noisy figure for short work
+template<typename Function>
+double measureMicroseconds(uint32_t runCount, Function&& function)
+{
+    double best = 0.0;
+    for (uint32_t run = 0; run < runCount; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        auto end = std::chrono::steady_clock::now();
+
+        double elapsed = std::chrono::duration<double, std::micro>(end - start).count();
+        if (run == 0 || elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+#endif // !_BENCHMARKS_H_
@@ -0,0 +1,243 @@
+// Vulkan Renderer - dispatch_benchmark.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <cstdio>
+#include <vector>
+
+#include "benchmarks.h"
+#include "vkdefines.h"
+
+#ifdef _MSC_VER
+#pragma comment(lib, "vulkan-1.lib")
+#endif
+
+constexpr uint32_t dispatchRunCount = 10;
+constexpr uint32_t dispatchCallCount = 100000;
+
+struct BenchmarkDevice
+{
+    VkInstance      instance;
+    VkDevice        device;
+    VkCommandPool   commandPool;
+    VkCommandBuffer commandBuffer;
+    VkFence         fence;
+};
+
+// No surface and no extensions, only what recording and polling a fence need. Returns false
+// on machines without a Vulkan driver so the CPU benchmarks still run there.
+static bool createBenchmarkDevice(BenchmarkDevice& benchmarkDevice)
+{
+    VkApplicationInfo applicationInfo;
+    applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    applicationInfo.pNext = nullptr;
+    applicationInfo.pApplicationName = "Vulkan Renderer Benchmarks";
+    applicationInfo.applicationVersion = VK_MAKE_VERSION(0, 0, 0);
+    applicationInfo.pEngineName = "Vulkan Renderer";
+    applicationInfo.engineVersion = VK_MAKE_VERSION(0, 0, 0);
+    applicationInfo.apiVersion = VK_API_VERSION_1_2;
+
+    VkInstanceCreateInfo instanceCreateInfo;
+    instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instanceCreateInfo.pNext = nullptr;
+    instanceCreateInfo.flags = 0;
+    instanceCreateInfo.pApplicationInfo = &applicationInfo;
+    instanceCreateInfo.enabledLayerCount = 0;
+    instanceCreateInfo.ppEnabledLayerNames = nullptr;
+    instanceCreateInfo.enabledExtensionCount = 0;
+    instanceCreateInfo.ppEnabledExtensionNames = nullptr;
+
+    if (vkCreateInstance(&instanceCreateInfo, nullptr, &benchmarkDevice.instance) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    uint32_t physicalDeviceCount = 1;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkResult result = vkEnumeratePhysicalDevices(benchmarkDevice.instance, &physicalDeviceCount, &physicalDevice);
+    if ((result != VK_SUCCESS && result != VK_INCOMPLETE) || physicalDeviceCount == 0)
+    {
+        vkDestroyInstance(benchmarkDevice.instance, nullptr);
+        return false;
+    }
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    uint32_t queueFamilyIndex = 0;
+    while (queueFamilyIndex < queueFamilyCount && (queueFamilies[queueFamilyIndex].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0)
+    {
+        queueFamilyIndex++;
+    }
+
+    float queuePriority = 1.0f;
+
+    VkDeviceQueueCreateInfo deviceQueueCreateInfo;
+    deviceQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    deviceQueueCreateInfo.pNext = nullptr;
+    deviceQueueCreateInfo.flags = 0;
+    deviceQueueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+    deviceQueueCreateInfo.queueCount = 1;
+    deviceQueueCreateInfo.pQueuePriorities = &queuePriority;
+
+    VkDeviceCreateInfo deviceCreateInfo;
+    deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceCreateInfo.pNext = nullptr;
+    deviceCreateInfo.flags = 0;
+    deviceCreateInfo.queueCreateInfoCount = 1;
+    deviceCreateInfo.pQueueCreateInfos = &deviceQueueCreateInfo;
+    deviceCreateInfo.enabledLayerCount = 0;
+    deviceCreateInfo.ppEnabledLayerNames = nullptr;
+    deviceCreateInfo.enabledExtensionCount = 0;
+    deviceCreateInfo.ppEnabledExtensionNames = nullptr;
+    deviceCreateInfo.pEnabledFeatures = nullptr;
+
+    if (queueFamilyIndex == queueFamilyCount || vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &benchmarkDevice.device) != VK_SUCCESS)
+    {
+        vkDestroyInstance(benchmarkDevice.instance, nullptr);
+        return false;
+    }
+
+    loadDeviceDispatch(benchmarkDevice.device);
+
+    VkCommandPoolCreateInfo commandPoolCreateInfo;
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.pNext = nullptr;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+
+    result = vkCreateCommandPool(benchmarkDevice.device, &commandPoolCreateInfo, nullptr, &benchmarkDevice.commandPool);
+    CHECK_VKRESULT(result);
+
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo;
+    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.pNext = nullptr;
+    commandBufferAllocateInfo.commandPool = benchmarkDevice.commandPool;
+    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = 1;
+
+    result = vkAllocateCommandBuffers(benchmarkDevice.device, &commandBufferAllocateInfo, &benchmarkDevice.commandBuffer);
+    CHECK_VKRESULT(result);
+
+    VkFenceCreateInfo fenceCreateInfo;
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceCreateInfo.pNext = nullptr;
+    fenceCreateInfo.flags = 0;
+
+    result = vkCreateFence(benchmarkDevice.device, &fenceCreateInfo, nullptr, &benchmarkDevice.fence);
+    CHECK_VKRESULT(result);
+
+    return true;
+}
+
+static void destroyBenchmarkDevice(BenchmarkDevice& benchmarkDevice)
+{
+    vkDestroyFence(benchmarkDevice.device, benchmarkDevice.fence, nullptr);
+    vkDestroyCommandPool(benchmarkDevice.device, benchmarkDevice.commandPool, nullptr);
+    vkDestroyDevice(benchmarkDevice.device, nullptr);
+    clearDeviceDispatch();
+    vkDestroyInstance(benchmarkDevice.instance, nullptr);
+}
+
+// Recording restarts every run so the command buffer doesn't grow across runs, both variants pay the same for it
+template<typename Record>
+static double measureRecording(const BenchmarkDevice& benchmarkDevice, Record&& record)
+{
+    VkCommandBufferBeginInfo beginInfo;
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.pNext = nullptr;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = nullptr;
+
+    return measureMicroseconds(dispatchRunCount, [&]() {
+        vkResetCommandPool(benchmarkDevice.device, benchmarkDevice.commandPool, 0);
+        vkBeginCommandBuffer(benchmarkDevice.commandBuffer, &beginInfo);
+        record(benchmarkDevice.commandBuffer);
+        vkEndCommandBuffer(benchmarkDevice.commandBuffer);
+    });
+}
+
+static void printDispatchResult(const char* function, double loaderMicroseconds, double directMicroseconds)
+{
+    double loaderNanoseconds = loaderMicroseconds * 1000.0 / dispatchCallCount;
+    double directNanoseconds = directMicroseconds * 1000.0 / dispatchCallCount;
+    std::printf("%-20s %12.2f %12.2f %12.2f\n", function, loaderNanoseconds, directNanoseconds, loaderNanoseconds - directNanoseconds);
+}
+
+void runDispatchBenchmark()
+{
+    BenchmarkDevice benchmarkDevice;
+    if (!createBenchmarkDevice(benchmarkDevice))
+    {
+        std::printf("No Vulkan device, skipped\n");
+        return;
+    }
+
+    std::printf("%-20s %12s %12s %12s\n", "Function", "Loader ns", "Direct ns", "Saved ns");
+
+    // A state setter does next to nothing in the driver, what's left is mostly the call itself.
+    // The parenthesized name calls the loader export instead of the dispatch table.
+    VkRect2D scissor;
+    scissor.offset.x = 0;
+    scissor.offset.y = 0;
+    scissor.extent.width = 1;
+    scissor.extent.height = 1;
+
+    double loaderScissorTime = measureRecording(benchmarkDevice, [&](VkCommandBuffer commandBuffer) {
+        for (uint32_t i = 0; i < dispatchCallCount; i++)
+        {
+            (vkCmdSetScissor)(commandBuffer, 0, 1, &scissor);
+        }
+    });
+
+    double directScissorTime = measureRecording(benchmarkDevice, [&](VkCommandBuffer commandBuffer) {
+        for (uint32_t i = 0; i < dispatchCallCount; i++)
+        {
+            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        }
+    });
+
+    printDispatchResult("vkCmdSetScissor", loaderScissorTime, directScissorTime);
+
+    // Device functions other than commands are unwrapped by the loader through the device handle instead
+    VkDevice device = benchmarkDevice.device;
+    VkFence fence = benchmarkDevice.fence;
+
+    double loaderFenceTime = measureMicroseconds(dispatchRunCount, [&]() {
+        for (uint32_t i = 0; i < dispatchCallCount; i++)
+        {
+            (vkGetFenceStatus)(device, fence);
+        }
+    });
+
+    double directFenceTime = measureMicroseconds(dispatchRunCount, [&]() {
+        for (uint32_t i = 0; i < dispatchCallCount; i++)
+        {
+            vkGetFenceStatus(device, fence);
+        }
+    });
+
+    printDispatchResult("vkGetFenceStatus", loaderFenceTime, directFenceTime);
+
+    destroyBenchmarkDevice(benchmarkDevice);
+}
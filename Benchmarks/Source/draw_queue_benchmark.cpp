@@ -0,0 +1,99 @@
+// Vulkan Renderer - draw_queue_benchmark.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+#include "benchmarks.h"
+#include "draw_queue.h"
+
+constexpr uint32_t sortRunCount = 10;
+
+static void fillDrawQueue(DrawQueue& queue, const std::vector<DrawPacket>& source)
+{
+    queue.packets = source;
+}
+
+// Roughly what a scene submits: few layers, a few hundred pipelines, thousands of materials
+static std::vector<DrawPacket> generatePackets(size_t packetCount)
+{
+    std::mt19937_64 random(packetCount);
+    std::uniform_int_distribution<uint32_t> layerDistribution(0, 3);
+    std::uniform_int_distribution<uint32_t> pipelineDistribution(0, 255);
+    std::uniform_int_distribution<uint32_t> materialDistribution(0, 4095);
+    std::uniform_real_distribution<float> depthDistribution(0.0f, 1.0f);
+
+    std::vector<DrawPacket> packets(packetCount);
+    for (size_t i = 0; i < packetCount; i++)
+    {
+        uint32_t layer = layerDistribution(random);
+        packets[i].sortKey = makeSortKey(layer, pipelineDistribution(random), materialDistribution(random), depthDistribution(random), layer == 3);
+        packets[i].drawIndex = uint32_t(i);
+        packets[i].reserved = 0;
+    }
+    return packets;
+}
+
+static bool isSorted(const DrawQueue& queue)
+{
+    return std::is_sorted(queue.packets.begin(), queue.packets.end(), [](const DrawPacket& a, const DrawPacket& b) {
+        return a.sortKey < b.sortKey;
+    });
+}
+
+void runDrawQueueBenchmark()
+{
+    const size_t packetCounts[] = { 100000, 250000, 1000000 };
+    uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    std::printf("%10s %14s %14s %14s %10s\n", "Packets", "std::sort us", "Radix 1T us", "Radix MT us", "Threads");
+
+    for (size_t packetCount : packetCounts)
+    {
+        std::vector<DrawPacket> source = generatePackets(packetCount);
+        DrawQueue queue;
+        bool sorted = true;
+
+        // Copying the packets back in is part of every run, it is the same for all three
+        double stdSortTime = measureMicroseconds(sortRunCount, [&]() {
+            fillDrawQueue(queue, source);
+            std::stable_sort(queue.packets.begin(), queue.packets.end(), [](const DrawPacket& a, const DrawPacket& b) {
+                return a.sortKey < b.sortKey;
+            });
+        });
+
+        double singleThreadTime = measureMicroseconds(sortRunCount, [&]() {
+            fillDrawQueue(queue, source);
+            sortDrawQueue(queue, 1);
+        });
+        sorted = sorted && isSorted(queue);
+
+        double multiThreadTime = measureMicroseconds(sortRunCount, [&]() {
+            fillDrawQueue(queue, source);
+            sortDrawQueue(queue, threadCount);
+        });
+        sorted = sorted && isSorted(queue);
+
+        std::printf("%10zu %14.1f %14.1f %14.1f %10u%s\n", packetCount, stdSortTime, singleThreadTime, multiThreadTime, threadCount, sorted ? "" : "  NOT SORTED");
+    }
+}
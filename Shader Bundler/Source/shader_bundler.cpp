@@ -0,0 +1,236 @@
+// Vulkan Renderer - shader_bundler.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shader_bundle.h"
+#include "shader_permutations.h"
+#include "utility.h"
+
+// Compiles every permutation of shader_permutations.h with glslangValidator, optimizes it with
+// spirv-opt and packs the results into one bundle the renderer maps at startup.
+//
+// Usage: "Shader Bundler.exe" <source directory> <bundle path> [--size]
+
+struct CompiledPermutation
+{
+    const ShaderPermutation* permutation;
+    uint64_t                 nameHash;
+    std::vector<char>        code;
+    size_t                   unoptimizedSize;
+    double                   compileMilliseconds;
+    bool                     succeeded;
+};
+
+static bool runCommand(const std::string& command)
+{
+#ifdef _WIN32
+    // cmd.exe strips the outer quotes of a command line that starts with a quote
+    const std::string commandLine = "\"" + command + "\"";
+#else
+    const std::string& commandLine = command;
+#endif
+    return std::system(commandLine.c_str()) == 0;
+}
+
+static void compilePermutation(
+    CompiledPermutation& compiled,
+    const std::filesystem::path& sourceDirectory,
+    const std::filesystem::path& intermediateDirectory,
+    bool optimizeForSize)
+{
+    const ShaderPermutation& permutation = *compiled.permutation;
+
+    const std::filesystem::path sourcePath = sourceDirectory / permutation.sourcePath;
+    const std::filesystem::path unoptimizedPath = intermediateDirectory / (std::string(permutation.name) + ".unoptimized.spv");
+    const std::filesystem::path optimizedPath = intermediateDirectory / (std::string(permutation.name) + ".spv");
+
+    std::string defines;
+    std::istringstream defineStream(permutation.defines);
+    for (std::string define; defineStream >> define;)
+    {
+        defines += " -D" + define;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    compiled.succeeded =
+        runCommand("glslangValidator -V" + defines + " -o \"" + unoptimizedPath.string() + "\" \"" + sourcePath.string() + "\"") &&
+        runCommand(std::string("spirv-opt ") + (optimizeForSize ? "-Os --strip-debug" : "-O") +
+            " \"" + unoptimizedPath.string() + "\" -o \"" + optimizedPath.string() + "\"");
+
+    auto end = std::chrono::high_resolution_clock::now();
+    compiled.compileMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+    if (!compiled.succeeded)
+    {
+        return;
+    }
+
+    std::error_code error;
+    compiled.unoptimizedSize = size_t(std::filesystem::file_size(unoptimizedPath, error));
+    compiled.code = loadFile(optimizedPath.string());
+}
+
+static bool writeBundle(const std::filesystem::path& bundlePath, std::vector<CompiledPermutation>& permutations)
+{
+    std::sort(permutations.begin(), permutations.end(), [](const CompiledPermutation& a, const CompiledPermutation& b)
+    {
+        return a.nameHash < b.nameHash;
+    });
+
+    for (size_t i = 1; i < permutations.size(); i++)
+    {
+        if (permutations[i].nameHash == permutations[i - 1].nameHash)
+        {
+            std::cerr << "Name hash collision between " << permutations[i - 1].permutation->name << " and " << permutations[i].permutation->name << std::endl;
+            return false;
+        }
+    }
+
+    ShaderBundleHeader header;
+    header.magic = shaderBundleMagic;
+    header.version = shaderBundleVersion;
+    header.entryCount = uint32_t(permutations.size());
+    header.reserved = 0;
+
+    std::vector<ShaderBundleEntry> entries(permutations.size());
+    uint32_t offset = uint32_t(sizeof(ShaderBundleHeader) + entries.size() * sizeof(ShaderBundleEntry));
+
+    for (size_t i = 0; i < permutations.size(); i++)
+    {
+        entries[i].nameHash = permutations[i].nameHash;
+        entries[i].offset = offset;
+        entries[i].size = uint32_t(permutations[i].code.size());
+
+        offset += (entries[i].size + 3) & ~3u;
+    }
+
+    std::ofstream file(bundlePath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open " << bundlePath.string() << std::endl;
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(ShaderBundleHeader));
+    file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ShaderBundleEntry));
+
+    const char padding[4] = {};
+    for (const CompiledPermutation& compiled : permutations)
+    {
+        file.write(compiled.code.data(), compiled.code.size());
+        file.write(padding, ((compiled.code.size() + 3) & ~size_t(3)) - compiled.code.size());
+    }
+
+    return file.good();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <source directory> <bundle path> [--size]" << std::endl;
+        return 1;
+    }
+
+    const std::filesystem::path sourceDirectory = argv[1];
+    const std::filesystem::path bundlePath = argv[2];
+    const bool optimizeForSize = argc > 3 && std::string(argv[3]) == "--size";
+
+    const std::filesystem::path intermediateDirectory = std::filesystem::temp_directory_path() / "Shader Bundler";
+    std::filesystem::create_directories(intermediateDirectory);
+
+    std::vector<CompiledPermutation> permutations(shaderPermutationCount);
+    for (uint32_t i = 0; i < shaderPermutationCount; i++)
+    {
+        permutations[i].permutation = &shaderPermutations[i];
+        permutations[i].nameHash = hashShaderName(shaderPermutations[i].name);
+        permutations[i].unoptimizedSize = 0;
+        permutations[i].compileMilliseconds = 0.0;
+        permutations[i].succeeded = false;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Workers pull permutations off a shared counter until all of them are compiled
+    std::atomic<uint32_t> nextPermutation{ 0 };
+    auto worker = [&]()
+    {
+        for (uint32_t i = nextPermutation++; i < shaderPermutationCount; i = nextPermutation++)
+        {
+            compilePermutation(permutations[i], sourceDirectory, intermediateDirectory, optimizeForSize);
+        }
+    };
+
+    const uint32_t threadCount = std::max(1u, std::min(std::thread::hardware_concurrency(), shaderPermutationCount));
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back(worker);
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    bool succeeded = true;
+    size_t totalSize = 0;
+
+    std::printf("%-32s %12s %14s %14s\n", "Permutation", "Time (ms)", "SPIR-V (B)", "Optimized (B)");
+    for (const CompiledPermutation& compiled : permutations)
+    {
+        if (!compiled.succeeded)
+        {
+            std::printf("%-32s %12.2f %14s %14s\n", compiled.permutation->name, compiled.compileMilliseconds, "failed", "failed");
+            succeeded = false;
+            continue;
+        }
+
+        std::printf("%-32s %12.2f %14zu %14zu\n", compiled.permutation->name, compiled.compileMilliseconds, compiled.unoptimizedSize, compiled.code.size());
+        totalSize += compiled.code.size();
+    }
+
+    std::printf("%u permutations, %zu bytes of SPIR-V, %.2f ms on %u threads\n",
+        shaderPermutationCount, totalSize, std::chrono::duration<double, std::milli>(end - start).count(), threadCount);
+
+    if (!succeeded || !writeBundle(bundlePath, permutations))
+    {
+        return 1;
+    }
+
+    return 0;
+}
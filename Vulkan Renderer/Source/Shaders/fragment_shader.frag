@@ -22,11 +22,22 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// Set when the swapchain uses a UNORM format and the shader has to apply the sRGB transfer function itself
+layout(constant_id = 0) const bool encodeSrgb = false;
+
 layout(location = 0) in vec3 fragColor;
 
 layout(location = 0) out vec4 out_color;
 
+vec3 linearToSrgb(vec3 color)
+{
+	vec3 low = color * 12.92;
+	vec3 high = 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055;
+	return mix(high, low, lessThanEqual(color, vec3(0.0031308)));
+}
+
 void main()
 {
-	out_color = vec4(fragColor.r, fragColor.g, fragColor.b, 1.0);
+	vec3 color = encodeSrgb ? linearToSrgb(fragColor) : fragColor;
+	out_color = vec4(color.r, color.g, color.b, 1.0);
 }
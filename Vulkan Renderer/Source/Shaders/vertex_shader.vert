@@ -24,29 +24,71 @@
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_KHR_vulkan_glsl : enable
 
-vec2 positions[] =
+#ifdef GPU_DRIVEN
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
+// Position has a stream of its own so the DEPTH_ONLY permutation used by the depth prepass fetches nothing else
+layout(location = 0) in vec3 position;
+#ifndef DEPTH_ONLY
+layout(location = 1) in vec3 color;
+#endif
+
+// Per-draw data, has to match DrawPushConstants in push_constants.h
+layout(push_constant) uniform DrawConstants
 {
-	vec2(-0.5, 0.5),
-	vec2(0.5, 0.5),
-	vec2(0.0, -0.5)
-};
+	mat4 transform;
+	uint objectIndex;
+	uint materialIndex;
+} draw;
 
-vec3 colors[] =
+// Per-frame data, has to match FrameConstants in frame_constants.h
+layout(set = 1, binding = 0) uniform FrameConstants
 {
-	vec3(1.0, 0.0, 0.0),
-	vec3(0.0, 1.0, 0.0),
-	vec3(0.0, 0.0, 1.0)
+	mat4 viewProjection;
+} frame;
+
+#ifdef GPU_DRIVEN
+// Has to match GpuInstance in gpu_driven.h
+struct Instance
+{
+	mat4 transform;
+	uint meshIndex;
+	uint materialIndex;
+	uint reserved0;
+	uint reserved1;
 };
 
+// draw.objectIndex holds the bindless index of the instance buffer
+layout(set = 0, binding = 2) readonly buffer InstanceBuffer { Instance instances[]; } instanceBuffers[];
+#else
+// Per-instance stream, locations from firstInstanceAttributeLocation on. Has to match InstanceData in instance_stream.h.
+layout(location = 8) in vec4 instanceTransform0;
+layout(location = 9) in vec4 instanceTransform1;
+layout(location = 10) in vec4 instanceTransform2;
+layout(location = 11) in vec4 instanceTransform3;
+#endif
+
+// Invariant so the prepass and the color pass compute bit identical depth for the EQUAL test
 out gl_PerVertex
 {
-	vec4 gl_Position;
+	invariant vec4 gl_Position;
 };
 
+#ifndef DEPTH_ONLY
 layout(location = 0) out vec3 fragColor;
+#endif
 
 void main()
 {
-	gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-	fragColor = colors[gl_VertexIndex];
+#ifdef GPU_DRIVEN
+	mat4 transform = draw.transform * instanceBuffers[draw.objectIndex].instances[gl_InstanceIndex].transform;
+#else
+	mat4 transform = draw.transform * mat4(instanceTransform0, instanceTransform1, instanceTransform2, instanceTransform3);
+#endif
+
+	gl_Position = frame.viewProjection * transform * vec4(position, 1.0);
+#ifndef DEPTH_ONLY
+	fragColor = color;
+#endif
 }
@@ -0,0 +1,363 @@
+// Vulkan Renderer - bindless_descriptors.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+#include "bindless_descriptors.h"
+#include "host_allocator.h"
+#include "pipeline_layout_cache.h"
+
+constexpr uint32_t maxBindlessSampledImages = 16384;
+constexpr uint32_t maxBindlessSamplers = 1024;
+constexpr uint32_t maxBindlessStorageBuffers = 16384;
+
+// Treiber stack of free array indices. The upper half of the head counts modifications, so a pop that
+// read a stale next index fails its compare exchange even if the same index is on top again (ABA).
+struct IndexFreeList
+{
+    std::atomic<uint64_t>  head;
+    std::atomic<uint32_t>* next;
+    uint32_t               capacity;
+};
+
+static bool                  bindlessEnabled = false;
+static VkDescriptorSetLayout bindlessSetLayout = VK_NULL_HANDLE;
+static VkDescriptorPool      bindlessPool = VK_NULL_HANDLE;
+static VkDescriptorSet       bindlessSet = VK_NULL_HANDLE;
+static VkDevice              bindlessDevice = VK_NULL_HANDLE;
+static std::mutex            writeMutex; // vkUpdateDescriptorSets needs the set externally synchronized
+
+static IndexFreeList sampledImageIndices;
+static IndexFreeList samplerIndices;
+static IndexFreeList storageBufferIndices;
+
+static void initFreeList(IndexFreeList& list, uint32_t capacity)
+{
+    list.capacity = capacity;
+    list.next = new std::atomic<uint32_t>[capacity];
+
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        list.next[i].store(i + 1 < capacity ? i + 1 : invalidBindlessIndex, std::memory_order_relaxed);
+    }
+
+    list.head.store(capacity > 0 ? 0 : invalidBindlessIndex, std::memory_order_release);
+}
+
+static void destroyFreeList(IndexFreeList& list)
+{
+    delete[] list.next;
+    list.next = nullptr;
+    list.capacity = 0;
+    list.head.store(invalidBindlessIndex, std::memory_order_relaxed);
+}
+
+static uint32_t popIndex(IndexFreeList& list)
+{
+    uint64_t head = list.head.load(std::memory_order_acquire);
+
+    while (true)
+    {
+        const uint32_t index = uint32_t(head);
+        if (index == invalidBindlessIndex)
+        {
+            return invalidBindlessIndex;
+        }
+
+        const uint64_t newHead = (((head >> 32) + 1) << 32) | list.next[index].load(std::memory_order_relaxed);
+        if (list.head.compare_exchange_weak(head, newHead, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            return index;
+        }
+    }
+}
+
+static void pushIndex(IndexFreeList& list, uint32_t index)
+{
+    if (index >= list.capacity)
+    {
+        __debugbreak(); // Not an index from this list
+        return;
+    }
+
+    uint64_t head = list.head.load(std::memory_order_relaxed);
+    uint64_t newHead;
+
+    do
+    {
+        list.next[index].store(uint32_t(head), std::memory_order_relaxed);
+        newHead = (((head >> 32) + 1) << 32) | index;
+    }
+    while (!list.head.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+}
+
+bool requestBindlessDescriptors(const VkPhysicalDeviceVulkan12Features& supportedFeatures, VkPhysicalDeviceVulkan12Features& enabledFeatures)
+{
+    bindlessEnabled =
+        supportedFeatures.descriptorIndexing == VK_TRUE &&
+        supportedFeatures.runtimeDescriptorArray == VK_TRUE &&
+        supportedFeatures.descriptorBindingPartiallyBound == VK_TRUE &&
+        supportedFeatures.descriptorBindingUpdateUnusedWhilePending == VK_TRUE &&
+        supportedFeatures.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+        supportedFeatures.descriptorBindingStorageBufferUpdateAfterBind == VK_TRUE &&
+        supportedFeatures.shaderSampledImageArrayNonUniformIndexing == VK_TRUE;
+
+    if (!bindlessEnabled)
+    {
+        return false;
+    }
+
+    enabledFeatures.descriptorIndexing = VK_TRUE;
+    enabledFeatures.runtimeDescriptorArray = VK_TRUE;
+    enabledFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+    enabledFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    enabledFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    enabledFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    enabledFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    enabledFeatures.shaderStorageBufferArrayNonUniformIndexing = supportedFeatures.shaderStorageBufferArrayNonUniformIndexing;
+
+    return true;
+}
+
+bool isBindlessEnabled()
+{
+    return bindlessEnabled;
+}
+
+void createBindlessDescriptors(VkPhysicalDevice physicalDevice, VkDevice device)
+{
+    if (!bindlessEnabled)
+    {
+        return;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties;
+    descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    descriptorIndexingProperties.pNext = nullptr;
+
+    VkPhysicalDeviceProperties2 properties;
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &descriptorIndexingProperties;
+
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    const uint32_t sampledImageCount = std::min({ maxBindlessSampledImages,
+        descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+        descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages });
+
+    const uint32_t samplerCount = std::min({ maxBindlessSamplers,
+        descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+        descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers });
+
+    const uint32_t storageBufferCount = std::min({ maxBindlessStorageBuffers,
+        descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+        descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+
+    VkDescriptorSetLayoutBinding bindings[3];
+    bindings[0].binding = bindlessSampledImageBinding;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    bindings[0].descriptorCount = sampledImageCount;
+    bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+    bindings[0].pImmutableSamplers = nullptr;
+
+    bindings[1].binding = bindlessSamplerBinding;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    bindings[1].descriptorCount = samplerCount;
+    bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+    bindings[1].pImmutableSamplers = nullptr;
+
+    bindings[2].binding = bindlessStorageBufferBinding;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[2].descriptorCount = storageBufferCount;
+    bindings[2].stageFlags = VK_SHADER_STAGE_ALL;
+    bindings[2].pImmutableSamplers = nullptr;
+
+    const VkDescriptorBindingFlags bindingFlag =
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+    const VkDescriptorBindingFlags bindingFlags[3] = { bindingFlag, bindingFlag, bindingFlag };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo;
+    bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsCreateInfo.pNext = nullptr;
+    bindingFlagsCreateInfo.bindingCount = 3;
+    bindingFlagsCreateInfo.pBindingFlags = bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo;
+    descriptorSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptorSetLayoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+    descriptorSetLayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    descriptorSetLayoutCreateInfo.bindingCount = 3;
+    descriptorSetLayoutCreateInfo.pBindings = bindings;
+
+    VkResult result = vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCreateInfo, getHostAllocator(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT), &bindlessSetLayout);
+    CHECK_VKRESULT(result);
+
+    VkDescriptorPoolSize poolSizes[3];
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    poolSizes[0].descriptorCount = sampledImageCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+    poolSizes[1].descriptorCount = samplerCount;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[2].descriptorCount = storageBufferCount;
+
+    VkDescriptorPoolCreateInfo descriptorPoolCreateInfo;
+    descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolCreateInfo.pNext = nullptr;
+    descriptorPoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    descriptorPoolCreateInfo.maxSets = 1;
+    descriptorPoolCreateInfo.poolSizeCount = 3;
+    descriptorPoolCreateInfo.pPoolSizes = poolSizes;
+
+    result = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, getHostAllocator(VK_OBJECT_TYPE_DESCRIPTOR_POOL), &bindlessPool);
+    CHECK_VKRESULT(result);
+
+    VkDescriptorSetAllocateInfo descriptorSetAllocateInfo;
+    descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptorSetAllocateInfo.pNext = nullptr;
+    descriptorSetAllocateInfo.descriptorPool = bindlessPool;
+    descriptorSetAllocateInfo.descriptorSetCount = 1;
+    descriptorSetAllocateInfo.pSetLayouts = &bindlessSetLayout;
+
+    result = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &bindlessSet);
+    CHECK_VKRESULT(result);
+
+    initFreeList(sampledImageIndices, sampledImageCount);
+    initFreeList(samplerIndices, samplerCount);
+    initFreeList(storageBufferIndices, storageBufferCount);
+
+    bindlessDevice = device;
+
+    setReservedDescriptorSetLayout(bindlessDescriptorSet, bindlessSetLayout);
+}
+
+VkDescriptorSet getBindlessDescriptorSet()
+{
+    return bindlessSet;
+}
+
+static void writeDescriptor(uint32_t binding, uint32_t index, VkDescriptorType type, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo)
+{
+    VkWriteDescriptorSet writeDescriptorSet;
+    writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDescriptorSet.pNext = nullptr;
+    writeDescriptorSet.dstSet = bindlessSet;
+    writeDescriptorSet.dstBinding = binding;
+    writeDescriptorSet.dstArrayElement = index;
+    writeDescriptorSet.descriptorCount = 1;
+    writeDescriptorSet.descriptorType = type;
+    writeDescriptorSet.pImageInfo = imageInfo;
+    writeDescriptorSet.pBufferInfo = bufferInfo;
+    writeDescriptorSet.pTexelBufferView = nullptr;
+
+    std::lock_guard<std::mutex> lock(writeMutex);
+    vkUpdateDescriptorSets(bindlessDevice, 1, &writeDescriptorSet, 0, nullptr);
+}
+
+uint32_t registerSampledImage(VkImageView imageView, VkImageLayout imageLayout)
+{
+    const uint32_t index = popIndex(sampledImageIndices);
+    if (index == invalidBindlessIndex)
+    {
+        return invalidBindlessIndex;
+    }
+
+    VkDescriptorImageInfo imageInfo;
+    imageInfo.sampler = VK_NULL_HANDLE;
+    imageInfo.imageView = imageView;
+    imageInfo.imageLayout = imageLayout;
+
+    writeDescriptor(bindlessSampledImageBinding, index, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, &imageInfo, nullptr);
+    return index;
+}
+
+uint32_t registerSampler(VkSampler sampler)
+{
+    const uint32_t index = popIndex(samplerIndices);
+    if (index == invalidBindlessIndex)
+    {
+        return invalidBindlessIndex;
+    }
+
+    VkDescriptorImageInfo imageInfo;
+    imageInfo.sampler = sampler;
+    imageInfo.imageView = VK_NULL_HANDLE;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    writeDescriptor(bindlessSamplerBinding, index, VK_DESCRIPTOR_TYPE_SAMPLER, &imageInfo, nullptr);
+    return index;
+}
+
+uint32_t registerStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    const uint32_t index = popIndex(storageBufferIndices);
+    if (index == invalidBindlessIndex)
+    {
+        return invalidBindlessIndex;
+    }
+
+    VkDescriptorBufferInfo bufferInfo;
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = offset;
+    bufferInfo.range = range;
+
+    writeDescriptor(bindlessStorageBufferBinding, index, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &bufferInfo);
+    return index;
+}
+
+// Partially bound arrays allow stale descriptors as long as shaders don't access them
+void releaseSampledImage(uint32_t index)
+{
+    pushIndex(sampledImageIndices, index);
+}
+
+void releaseSampler(uint32_t index)
+{
+    pushIndex(samplerIndices, index);
+}
+
+void releaseStorageBuffer(uint32_t index)
+{
+    pushIndex(storageBufferIndices, index);
+}
+
+void destroyBindlessDescriptors(VkDevice device)
+{
+    if (!bindlessEnabled)
+    {
+        return;
+    }
+
+    setReservedDescriptorSetLayout(bindlessDescriptorSet, VK_NULL_HANDLE);
+
+    vkDestroyDescriptorPool(device, bindlessPool, getHostAllocator(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+    vkDestroyDescriptorSetLayout(device, bindlessSetLayout, getHostAllocator(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
+
+    destroyFreeList(sampledImageIndices);
+    destroyFreeList(samplerIndices);
+    destroyFreeList(storageBufferIndices);
+
+    bindlessPool = VK_NULL_HANDLE;
+    bindlessSetLayout = VK_NULL_HANDLE;
+    bindlessSet = VK_NULL_HANDLE;
+    bindlessDevice = VK_NULL_HANDLE;
+}
@@ -0,0 +1,67 @@
+// Vulkan Renderer - bindless_descriptors.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _BINDLESS_DESCRIPTORS_H_
+#define _BINDLESS_DESCRIPTORS_H_
+
+#include <cstdint>
+
+#include "vkdefines.h"
+
+// One global descriptor set, bound once per command buffer, that shaders index into:
+//
+// layout(set = 0, binding = 0) uniform texture2D textures[];
+// layout(set = 0, binding = 1) uniform sampler samplers[];
+// layout(set = 0, binding = 2) buffer Buffers { ... } buffers[];
+//
+// Every pipeline layout from the layout cache reserves the set, so it stays bound across pipeline changes.
+constexpr uint32_t bindlessDescriptorSet = 0;
+constexpr uint32_t bindlessSampledImageBinding = 0;
+constexpr uint32_t bindlessSamplerBinding = 1;
+constexpr uint32_t bindlessStorageBufferBinding = 2;
+
+constexpr uint32_t invalidBindlessIndex = ~0u;
+
+// Enables the descriptor indexing features the set needs, returns false if the device lacks any of them
+bool requestBindlessDescriptors(const VkPhysicalDeviceVulkan12Features& supportedFeatures, VkPhysicalDeviceVulkan12Features& enabledFeatures);
+
+bool isBindlessEnabled();
+
+void createBindlessDescriptors(VkPhysicalDevice physicalDevice, VkDevice device);
+
+VkDescriptorSet getBindlessDescriptorSet();
+
+// Registering is lock-free apart from the descriptor write itself and may happen while the set is in
+// use. Returns invalidBindlessIndex when the array is full.
+uint32_t registerSampledImage(VkImageView imageView, VkImageLayout imageLayout);
+uint32_t registerSampler(VkSampler sampler);
+uint32_t registerStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+
+// The index is handed out again right away, so only release it once the GPU is done with the resource
+void releaseSampledImage(uint32_t index);
+void releaseSampler(uint32_t index);
+void releaseStorageBuffer(uint32_t index);
+
+void destroyBindlessDescriptors(VkDevice device);
+
+#endif // !_BINDLESS_DESCRIPTORS_H_
@@ -0,0 +1,271 @@
+// Vulkan Renderer - command_recorder.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "command_recorder.h"
+#include "dynamic_state.h"
+
+void resetCommandStats(CommandStats& stats)
+{
+    for (uint32_t i = 0; i < RecordedCommandCount; i++)
+    {
+        stats.issued[i] = 0;
+        stats.elided[i] = 0;
+    }
+}
+
+void accumulateCommandStats(CommandStats& total, const CommandStats& stats)
+{
+    for (uint32_t i = 0; i < RecordedCommandCount; i++)
+    {
+        total.issued[i] += stats.issued[i];
+        total.elided[i] += stats.elided[i];
+    }
+}
+
+uint32_t getIssuedCommandCount(const CommandStats& stats)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < RecordedCommandCount; i++)
+    {
+        count += stats.issued[i];
+    }
+    return count;
+}
+
+uint32_t getElidedCommandCount(const CommandStats& stats)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < RecordedCommandCount; i++)
+    {
+        count += stats.elided[i];
+    }
+    return count;
+}
+
+void beginCommandRecording(CommandRecorder& recorder, VkCommandBuffer commandBuffer)
+{
+    recorder.commandBuffer = commandBuffer;
+    recorder.pipeline = VK_NULL_HANDLE;
+
+    for (uint32_t i = 0; i < maxBoundDescriptorSets; i++)
+    {
+        recorder.descriptorSetLayouts[i] = VK_NULL_HANDLE;
+        recorder.descriptorSets[i] = VK_NULL_HANDLE;
+    }
+
+    for (uint32_t i = 0; i < maxVertexBindings; i++)
+    {
+        recorder.vertexBuffers[i] = VK_NULL_HANDLE;
+        recorder.vertexBufferOffsets[i] = 0;
+    }
+
+    recorder.indexBuffer = VK_NULL_HANDLE;
+    recorder.indexBufferOffset = 0;
+    recorder.indexType = VK_INDEX_TYPE_UINT16;
+
+    resetPushConstantState(recorder.pushConstants);
+
+    recorder.viewportValid = false;
+    recorder.rasterizationStateValid = false;
+    recorder.depthStateValid = false;
+
+    resetCommandStats(recorder.stats);
+}
+
+void recordBindPipeline(CommandRecorder& recorder, VkPipeline pipeline)
+{
+    if (recorder.pipeline == pipeline)
+    {
+        recorder.stats.elided[RecordedCommandBindPipeline]++;
+        return;
+    }
+
+    vkCmdBindPipeline(recorder.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    recorder.pipeline = pipeline;
+    recorder.stats.issued[RecordedCommandBindPipeline]++;
+}
+
+void recordBindDescriptorSets(
+    CommandRecorder& recorder,
+    VkPipelineLayout layout,
+    uint32_t firstSet,
+    uint32_t setCount,
+    const VkDescriptorSet* sets,
+    uint32_t dynamicOffsetCount,
+    const uint32_t* dynamicOffsets)
+{
+    if (firstSet + setCount > maxBoundDescriptorSets)
+    {
+        __debugbreak(); // Raise maxBoundDescriptorSets
+        return;
+    }
+
+    bool redundant = dynamicOffsetCount == 0;
+    for (uint32_t i = 0; i < setCount && redundant; i++)
+    {
+        redundant = recorder.descriptorSetLayouts[firstSet + i] == layout && recorder.descriptorSets[firstSet + i] == sets[i];
+    }
+
+    if (redundant)
+    {
+        recorder.stats.elided[RecordedCommandBindDescriptorSets]++;
+        return;
+    }
+
+    vkCmdBindDescriptorSets(recorder.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, firstSet, setCount, sets, dynamicOffsetCount, dynamicOffsets);
+    recorder.stats.issued[RecordedCommandBindDescriptorSets]++;
+
+    // Binding with a different layout may disturb the sets above the range, so forget them instead of
+    // reasoning about layout compatibility. Sets with dynamic offsets are never considered bound.
+    for (uint32_t i = 0; i < maxBoundDescriptorSets; i++)
+    {
+        bool inRange = i >= firstSet && i < firstSet + setCount;
+        if (inRange)
+        {
+            recorder.descriptorSetLayouts[i] = dynamicOffsetCount == 0 ? layout : VK_NULL_HANDLE;
+            recorder.descriptorSets[i] = dynamicOffsetCount == 0 ? sets[i - firstSet] : VK_NULL_HANDLE;
+        }
+        else if (i > firstSet && recorder.descriptorSetLayouts[i] != layout)
+        {
+            recorder.descriptorSetLayouts[i] = VK_NULL_HANDLE;
+            recorder.descriptorSets[i] = VK_NULL_HANDLE;
+        }
+    }
+}
+
+void recordBindVertexBuffers(CommandRecorder& recorder, uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* buffers, const VkDeviceSize* offsets)
+{
+    if (firstBinding + bindingCount > maxVertexBindings)
+    {
+        __debugbreak(); // More bindings than any pipeline can have
+        return;
+    }
+
+    bool redundant = true;
+    for (uint32_t i = 0; i < bindingCount && redundant; i++)
+    {
+        redundant = recorder.vertexBuffers[firstBinding + i] == buffers[i] && recorder.vertexBufferOffsets[firstBinding + i] == offsets[i];
+    }
+
+    if (redundant)
+    {
+        recorder.stats.elided[RecordedCommandBindVertexBuffers]++;
+        return;
+    }
+
+    vkCmdBindVertexBuffers(recorder.commandBuffer, firstBinding, bindingCount, buffers, offsets);
+    recorder.stats.issued[RecordedCommandBindVertexBuffers]++;
+
+    for (uint32_t i = 0; i < bindingCount; i++)
+    {
+        recorder.vertexBuffers[firstBinding + i] = buffers[i];
+        recorder.vertexBufferOffsets[firstBinding + i] = offsets[i];
+    }
+}
+
+void recordBindIndexBuffer(CommandRecorder& recorder, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
+{
+    if (recorder.indexBuffer == buffer && recorder.indexBufferOffset == offset && recorder.indexType == indexType)
+    {
+        recorder.stats.elided[RecordedCommandBindIndexBuffer]++;
+        return;
+    }
+
+    vkCmdBindIndexBuffer(recorder.commandBuffer, buffer, offset, indexType);
+    recorder.indexBuffer = buffer;
+    recorder.indexBufferOffset = offset;
+    recorder.indexType = indexType;
+    recorder.stats.issued[RecordedCommandBindIndexBuffer]++;
+}
+
+void recordPushDrawConstants(CommandRecorder& recorder, VkPipelineLayout layout, VkShaderStageFlags stageFlags, const DrawPushConstants& constants)
+{
+    uint32_t pushCount = recorder.pushConstants.pushCount;
+    cmdPushDrawConstants(recorder.commandBuffer, recorder.pushConstants, layout, stageFlags, constants);
+
+    if (recorder.pushConstants.pushCount != pushCount)
+    {
+        recorder.stats.issued[RecordedCommandPushConstants]++;
+    }
+    else
+    {
+        recorder.stats.elided[RecordedCommandPushConstants]++;
+    }
+}
+
+void recordSetViewportAndScissor(CommandRecorder& recorder, VkExtent2D extent, float renderScale)
+{
+    if (recorder.viewportValid && recorder.viewportExtent.width == extent.width &&
+        recorder.viewportExtent.height == extent.height && recorder.renderScale == renderScale)
+    {
+        recorder.stats.elided[RecordedCommandSetViewportAndScissor]++;
+        return;
+    }
+
+    cmdSetViewportAndScissor(recorder.commandBuffer, extent, renderScale);
+    recorder.viewportValid = true;
+    recorder.viewportExtent = extent;
+    recorder.renderScale = renderScale;
+    recorder.stats.issued[RecordedCommandSetViewportAndScissor]++;
+}
+
+void recordSetRasterizationState(CommandRecorder& recorder, VkCullModeFlags cullMode, VkFrontFace frontFace)
+{
+    // Baked into the pipeline without extended dynamic state, there is nothing to issue or elide
+    if (!isExtendedDynamicStateEnabled())
+    {
+        return;
+    }
+
+    if (recorder.rasterizationStateValid && recorder.cullMode == cullMode && recorder.frontFace == frontFace)
+    {
+        recorder.stats.elided[RecordedCommandSetRasterizationState]++;
+        return;
+    }
+
+    cmdSetRasterizationState(recorder.commandBuffer, cullMode, frontFace);
+    recorder.rasterizationStateValid = true;
+    recorder.cullMode = cullMode;
+    recorder.frontFace = frontFace;
+    recorder.stats.issued[RecordedCommandSetRasterizationState]++;
+}
+
+void recordSetDepthState(CommandRecorder& recorder, VkBool32 depthTestEnable, VkBool32 depthWriteEnable, VkCompareOp depthCompareOp)
+{
+    if (!isExtendedDynamicStateEnabled())
+    {
+        return;
+    }
+
+    if (recorder.depthStateValid && recorder.depthTestEnable == depthTestEnable &&
+        recorder.depthWriteEnable == depthWriteEnable && recorder.depthCompareOp == depthCompareOp)
+    {
+        recorder.stats.elided[RecordedCommandSetDepthState]++;
+        return;
+    }
+
+    cmdSetDepthState(recorder.commandBuffer, depthTestEnable, depthWriteEnable, depthCompareOp);
+    recorder.depthStateValid = true;
+    recorder.depthTestEnable = depthTestEnable;
+    recorder.depthWriteEnable = depthWriteEnable;
+    recorder.depthCompareOp = depthCompareOp;
+    recorder.stats.issued[RecordedCommandSetDepthState]++;
+}
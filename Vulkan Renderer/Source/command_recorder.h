@@ -0,0 +1,124 @@
+// Vulkan Renderer - command_recorder.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _COMMAND_RECORDER_H_
+#define _COMMAND_RECORDER_H_
+
+#include <cstdint>
+
+#include "pipeline_state_cache.h"
+#include "push_constants.h"
+#include "vkdefines.h"
+
+constexpr uint32_t maxBoundDescriptorSets = 8;
+
+enum RecordedCommand : uint32_t
+{
+    RecordedCommandBindPipeline,
+    RecordedCommandBindDescriptorSets,
+    RecordedCommandBindVertexBuffers,
+    RecordedCommandBindIndexBuffer,
+    RecordedCommandPushConstants,
+    RecordedCommandSetViewportAndScissor,
+    RecordedCommandSetRasterizationState,
+    RecordedCommandSetDepthState,
+    RecordedCommandCount
+};
+
+struct CommandStats
+{
+    uint32_t issued[RecordedCommandCount];
+    uint32_t elided[RecordedCommandCount];
+};
+
+// Shadows the state bound in one command buffer and drops calls that would set it to what it already
+// is. All binds of the command buffer have to go through the recorder, otherwise the shadow goes stale.
+// Assumes every pipeline leaves the same states dynamic, which holds for pipelines from the state cache.
+struct CommandRecorder
+{
+    VkCommandBuffer   commandBuffer;
+
+    VkPipeline        pipeline;
+
+    VkPipelineLayout  descriptorSetLayouts[maxBoundDescriptorSets];
+    VkDescriptorSet   descriptorSets[maxBoundDescriptorSets];
+
+    VkBuffer          vertexBuffers[maxVertexBindings];
+    VkDeviceSize      vertexBufferOffsets[maxVertexBindings];
+
+    VkBuffer          indexBuffer;
+    VkDeviceSize      indexBufferOffset;
+    VkIndexType       indexType;
+
+    PushConstantState pushConstants;
+
+    bool              viewportValid;
+    VkExtent2D        viewportExtent;
+    float             renderScale;
+
+    bool              rasterizationStateValid;
+    VkCullModeFlags   cullMode;
+    VkFrontFace       frontFace;
+
+    bool              depthStateValid;
+    VkBool32          depthTestEnable;
+    VkBool32          depthWriteEnable;
+    VkCompareOp       depthCompareOp;
+
+    CommandStats      stats;
+};
+
+// Call after vkBeginCommandBuffer, nothing is assumed to be bound afterwards
+void beginCommandRecording(CommandRecorder& recorder, VkCommandBuffer commandBuffer);
+
+void recordBindPipeline(CommandRecorder& recorder, VkPipeline pipeline);
+
+// Sets bound with dynamic offsets are always rebound
+void recordBindDescriptorSets(
+    CommandRecorder& recorder,
+    VkPipelineLayout layout,
+    uint32_t firstSet,
+    uint32_t setCount,
+    const VkDescriptorSet* sets,
+    uint32_t dynamicOffsetCount = 0,
+    const uint32_t* dynamicOffsets = nullptr
+);
+
+void recordBindVertexBuffers(CommandRecorder& recorder, uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* buffers, const VkDeviceSize* offsets);
+void recordBindIndexBuffer(CommandRecorder& recorder, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+
+void recordPushDrawConstants(CommandRecorder& recorder, VkPipelineLayout layout, VkShaderStageFlags stageFlags, const DrawPushConstants& constants);
+
+void recordSetViewportAndScissor(CommandRecorder& recorder, VkExtent2D extent, float renderScale = 1.0f);
+void recordSetRasterizationState(CommandRecorder& recorder, VkCullModeFlags cullMode, VkFrontFace frontFace);
+void recordSetDepthState(CommandRecorder& recorder, VkBool32 depthTestEnable, VkBool32 depthWriteEnable, VkCompareOp depthCompareOp);
+
+void resetCommandStats(CommandStats& stats);
+
+// Adds the counts of one command buffer to the totals of a frame
+void accumulateCommandStats(CommandStats& total, const CommandStats& stats);
+
+uint32_t getIssuedCommandCount(const CommandStats& stats);
+uint32_t getElidedCommandCount(const CommandStats& stats);
+
+#endif // !_COMMAND_RECORDER_H_
@@ -0,0 +1,195 @@
+// Vulkan Renderer - deferred_destruction.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "bindless_descriptors.h"
+#include "deferred_destruction.h"
+#include "host_allocator.h"
+
+// Bindless array slots are queued as VK_OBJECT_TYPE_DESCRIPTOR_SET, they are elements of the bindless set.
+// Their handle packs the descriptor type above the index.
+struct DeferredObject
+{
+    uint64_t     handle;
+    uint64_t     submission;
+    VkObjectType objectType;
+};
+
+// Submissions only grow, so the queue stays sorted by them and retiring pops from the front
+static std::mutex                 deferredMutex;
+static std::deque<DeferredObject> deferredObjects;
+static uint64_t                   currentSubmission = 0;
+
+// Render thread only, reused every frame
+static std::vector<DeferredObject> retiredObjects;
+
+static void releaseBindlessIndex(uint64_t packed)
+{
+    const uint32_t index = uint32_t(packed);
+
+    switch (VkDescriptorType(packed >> 32))
+    {
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        releaseSampledImage(index);
+        break;
+    case VK_DESCRIPTOR_TYPE_SAMPLER:
+        releaseSampler(index);
+        break;
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        releaseStorageBuffer(index);
+        break;
+    default:
+        __debugbreak(); // No bindless array of this type
+        break;
+    }
+}
+
+static void destroyObject(VkDevice device, const DeferredObject& object)
+{
+    const VkAllocationCallbacks* allocator = getHostAllocator(object.objectType);
+
+    switch (object.objectType)
+    {
+    case VK_OBJECT_TYPE_BUFFER:
+        vkDestroyBuffer(device, (VkBuffer)object.handle, allocator);
+        break;
+    case VK_OBJECT_TYPE_BUFFER_VIEW:
+        vkDestroyBufferView(device, (VkBufferView)object.handle, allocator);
+        break;
+    case VK_OBJECT_TYPE_IMAGE:
+        vkDestroyImage(device, (VkImage)object.handle, allocator);
+        break;
+    case VK_OBJECT_TYPE_IMAGE_VIEW:
+        vkDestroyImageView(device, (VkImageView)object.handle, allocator);
+        break;
+    case VK_OBJECT_TYPE_DEVICE_MEMORY:
+        vkFreeMemory(device, (VkDeviceMemory)object.handle, allocator);
+        break;
+    case VK_OBJECT_TYPE_SAMPLER:
+        vkDestroySampler(device, (VkSampler)object.handle, allocator);
+        break;
+    case VK_OBJECT_TYPE_SHADER_MODULE:
+        vkDestroyShaderModule(device, (VkShaderModule)object.handle, allocator);
+        break;
+    case VK_OBJECT_TYPE_PIPELINE:
+        vkDestroyPipeline(device, (VkPipeline)object.handle, allocator);
+        break;
+    case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+        vkDestroyPipelineLayout(device, (VkPipelineLayout)object.handle, allocator);
+        break;
+    case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+        vkDestroyDescriptorPool(device, (VkDescriptorPool)object.handle, allocator);
+        break;
+    case VK_OBJECT_TYPE_FRAMEBUFFER:
+        vkDestroyFramebuffer(device, (VkFramebuffer)object.handle, allocator);
+        break;
+    case VK_OBJECT_TYPE_RENDER_PASS:
+        vkDestroyRenderPass(device, (VkRenderPass)object.handle, allocator);
+        break;
+    case VK_OBJECT_TYPE_QUERY_POOL:
+        vkDestroyQueryPool(device, (VkQueryPool)object.handle, allocator);
+        break;
+    case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+        vkDestroySwapchainKHR(device, (VkSwapchainKHR)object.handle, allocator);
+        break;
+    case VK_OBJECT_TYPE_DESCRIPTOR_SET:
+        releaseBindlessIndex(object.handle);
+        break;
+    default:
+        __debugbreak(); // Not meant to be destroyed while the device is running
+        break;
+    }
+}
+
+void deferDestruction(VkObjectType objectType, uint64_t handle)
+{
+    if (handle == 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(deferredMutex);
+
+    DeferredObject object;
+    object.handle = handle;
+    object.submission = currentSubmission;
+    object.objectType = objectType;
+    deferredObjects.push_back(object);
+}
+
+void deferBindlessRelease(VkDescriptorType descriptorType, uint32_t index)
+{
+    if (index == invalidBindlessIndex)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(deferredMutex);
+
+    // The sampler type is 0, so the packed handle may be 0 and can't go through deferDestruction
+    DeferredObject object;
+    object.handle = (uint64_t(descriptorType) << 32) | index;
+    object.submission = currentSubmission;
+    object.objectType = VK_OBJECT_TYPE_DESCRIPTOR_SET;
+    deferredObjects.push_back(object);
+}
+
+void advanceDeferredDestruction(VkDevice device, uint64_t recordingSubmission, uint64_t completedSubmissions)
+{
+    // Destroys outside the lock, releases from other threads don't wait for the driver
+    {
+        std::lock_guard<std::mutex> lock(deferredMutex);
+
+        currentSubmission = recordingSubmission;
+
+        while (!deferredObjects.empty() && deferredObjects.front().submission < completedSubmissions)
+        {
+            retiredObjects.push_back(deferredObjects.front());
+            deferredObjects.pop_front();
+        }
+    }
+
+    for (const DeferredObject& object : retiredObjects)
+    {
+        destroyObject(device, object);
+    }
+    retiredObjects.clear();
+}
+
+void flushDeferredDestruction(VkDevice device)
+{
+    std::lock_guard<std::mutex> lock(deferredMutex);
+
+    for (const DeferredObject& object : deferredObjects)
+    {
+        destroyObject(device, object);
+    }
+    deferredObjects.clear();
+}
+
+uint32_t getDeferredDestructionCount()
+{
+    std::lock_guard<std::mutex> lock(deferredMutex);
+    return uint32_t(deferredObjects.size());
+}
@@ -0,0 +1,52 @@
+// Vulkan Renderer - deferred_destruction.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _DEFERRED_DESTRUCTION_H_
+#define _DEFERRED_DESTRUCTION_H_
+
+#include <cstdint>
+
+#include "vkdefines.h"
+
+// Submissions are numbered by the render loop, starting at 0 for the first frame. An object released while
+// submission N is being recorded may still be used by N and everything before it, so it is destroyed once
+// more than N submissions completed. Destruction happens in release order, release a buffer before its memory.
+
+// Any thread. Handles are passed as uint64_t, non-dispatchable handles are no distinct types on 32-bit
+// platforms. Destroyed with the host allocator of their type.
+void deferDestruction(VkObjectType objectType, uint64_t handle);
+
+// Any thread. Hands a bindless array index back once the submissions that may still index it completed.
+// descriptorType picks the array: sampled image, sampler or storage buffer.
+void deferBindlessRelease(VkDescriptorType descriptorType, uint32_t index);
+
+// Render thread, once per frame after waiting for the frame's fence. Destroys everything released before
+// completedSubmissions, later releases are tagged with recordingSubmission.
+void advanceDeferredDestruction(VkDevice device, uint64_t recordingSubmission, uint64_t completedSubmissions);
+
+// After vkDeviceWaitIdle, destroys everything still queued
+void flushDeferredDestruction(VkDevice device);
+
+uint32_t getDeferredDestructionCount();
+
+#endif // !_DEFERRED_DESTRUCTION_H_
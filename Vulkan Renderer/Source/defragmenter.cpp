@@ -0,0 +1,239 @@
+// Vulkan Renderer - defragmenter.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "defragmenter.h"
+#include "gpu_buffer.h"
+#include "resource_pools.h"
+
+static std::vector<uint32_t>     passBlocks;
+static std::vector<BufferHandle> moves;
+static DefragmentationStats      stats;
+
+// Mapped buffers are copied on the CPU, a GPU copy would execute after this frame's writes to the new mapping
+// and overwrite them. Everything else has to be a transfer source.
+static bool isMovable(const GpuBuffer& buffer)
+{
+    return buffer.mapped != nullptr || (buffer.usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) != 0;
+}
+
+static void finishPass()
+{
+    for (uint32_t block : passBlocks)
+    {
+        setBlockDraining(block, false);
+    }
+
+    passBlocks.clear();
+
+    stats.after = getFragmentationReport();
+    stats.active = false;
+}
+
+void beginDefragmentation()
+{
+    if (stats.active)
+    {
+        return;
+    }
+
+    // The fullest sparse block stays open to take in the buffers of the others
+    passBlocks.clear();
+    findSparseBlocks(defragmentationOccupancy, passBlocks);
+    if (passBlocks.size() < 2)
+    {
+        passBlocks.clear();
+        return;
+    }
+
+    passBlocks.pop_back();
+
+    for (uint32_t block : passBlocks)
+    {
+        setBlockDraining(block, true);
+    }
+
+    stats.before = getFragmentationReport();
+    stats.passCount++;
+    stats.movedBuffers = 0;
+    stats.movedBytes = 0;
+    stats.active = true;
+}
+
+void stepDefragmentation(VkDevice device, VkCommandBuffer commandBuffer, std::chrono::microseconds timeBudget)
+{
+    if (!stats.active)
+    {
+        return;
+    }
+
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeBudget;
+
+    // Emptied blocks went back to the driver and drop out of the pass
+    uint32_t kept = 0;
+    for (uint32_t block : passBlocks)
+    {
+        if (isBlockDraining(block))
+        {
+            passBlocks[kept++] = block;
+        }
+    }
+
+    passBlocks.resize(kept);
+
+    moves.clear();
+    for (uint32_t block : passBlocks)
+    {
+        findBuffersInMemoryBlock(block, moves);
+    }
+
+    VkDeviceSize copiedBytes = 0;
+    bool movableFound = false;
+    bool copiesRecorded = false;
+
+    for (BufferHandle handle : moves)
+    {
+        if (copiedBytes >= maxDefragmentationBytesPerFrame || std::chrono::steady_clock::now() >= deadline)
+        {
+            movableFound = true;
+            break;
+        }
+
+        GpuBuffer source = resolveGpuBuffer(handle);
+        if (!isMovable(source))
+        {
+            continue;
+        }
+
+        movableFound = true;
+
+        // The blocks outside the pass are full, the next step retries once frees made room
+        GpuBuffer target;
+        if (!tryCreateSuballocatedGpuBuffer(device, source.size, source.usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, source.memoryType, target))
+        {
+            break;
+        }
+
+        if (source.mapped != nullptr)
+        {
+            std::memcpy(target.mapped, source.mapped, size_t(source.size));
+        }
+        else
+        {
+            // Earlier submissions may have written the buffer on the GPU
+            if (!copiesRecorded)
+            {
+                VkMemoryBarrier barrier;
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.pNext = nullptr;
+                barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+                copiesRecorded = true;
+            }
+
+            VkBufferCopy region;
+            region.srcOffset = 0;
+            region.dstOffset = 0;
+            region.size = source.size;
+
+            vkCmdCopyBuffer(commandBuffer, source.buffer, target.buffer, 1, &region);
+        }
+
+        // Releases the old range, it becomes free once the frames in flight are done with it. With the bindless
+        // array full the copy goes to waste and the buffer stays.
+        if (!replaceBuffer(handle, target))
+        {
+            releaseGpuBuffer(target);
+            break;
+        }
+
+        copiedBytes += source.size;
+        stats.movedBuffers++;
+        stats.movedBytes += source.size;
+    }
+
+    if (copiesRecorded)
+    {
+        VkMemoryBarrier barrier;
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.pNext = nullptr;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+            VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+        VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    if (movableFound)
+    {
+        return;
+    }
+
+    // Everything left is pinned by buffers that can't move, the report waits for the moved ranges to come back
+    for (uint32_t block : passBlocks)
+    {
+        if (isBlockReleasePending(block))
+        {
+            return;
+        }
+    }
+
+    finishPass();
+}
+
+const DefragmentationStats& getDefragmentationStats()
+{
+    return stats;
+}
+
+void printDefragmentationStats()
+{
+    if (stats.passCount == 0)
+    {
+        std::cout << "No defragmentation pass ran\n";
+        return;
+    }
+
+    const std::ios_base::fmtflags flags = std::cout.flags();
+    const std::streamsize precision = std::cout.precision();
+
+    std::cout << stats.passCount << " defragmentation passes, the last moved " << stats.movedBuffers << " buffers ("
+              << std::fixed << std::setprecision(1) << double(stats.movedBytes) / 1048576.0 << " MiB)"
+              << (stats.active ? " and is still running" : "") << '\n';
+
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+
+    printFragmentationReport("Before", stats.before);
+    if (!stats.active)
+    {
+        printFragmentationReport("After", stats.after);
+    }
+}
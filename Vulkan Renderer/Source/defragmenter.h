@@ -0,0 +1,61 @@
+// Vulkan Renderer - defragmenter.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _DEFRAGMENTER_H_
+#define _DEFRAGMENTER_H_
+
+#include <chrono>
+#include <cstdint>
+
+#include "memory_blocks.h"
+#include "vkdefines.h"
+
+// Blocks below this occupancy get emptied by a pass
+constexpr float defragmentationOccupancy = 0.5f;
+// Caps the copy work a single frame adds on the GPU, the time budget only covers the CPU side
+constexpr VkDeviceSize maxDefragmentationBytesPerFrame = VkDeviceSize(16) << 20;
+
+struct DefragmentationStats
+{
+    FragmentationReport before;      // When the last pass started
+    FragmentationReport after;       // Once the ranges of the last pass went back to their blocks
+    uint32_t            passCount;
+    uint32_t            movedBuffers;
+    VkDeviceSize        movedBytes;
+    bool                active;
+};
+
+// Render thread only. Starts a pass over the blocks below defragmentationOccupancy unless one is running.
+// Only pooled buffers move, everything else keeps its block alive. Registered buffers get a new bindless index.
+void beginDefragmentation();
+
+// Once per frame, after updateResidency. Moves pooled buffers out of the blocks of the pass into other blocks
+// until timeBudget elapsed or maxDefragmentationBytesPerFrame were copied. Handles keep resolving, to the new
+// buffer from this frame on, so anything bound through a resolved handle has to be recorded afterwards.
+// The copies are recorded into commandBuffer.
+void stepDefragmentation(VkDevice device, VkCommandBuffer commandBuffer, std::chrono::microseconds timeBudget);
+
+const DefragmentationStats& getDefragmentationStats();
+void printDefragmentationStats();
+
+#endif // !_DEFRAGMENTER_H_
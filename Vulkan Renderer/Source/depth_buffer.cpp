@@ -0,0 +1,149 @@
+// Vulkan Renderer - depth_buffer.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "depth_buffer.h"
+#include "gpu_buffer.h"
+#include "host_allocator.h"
+
+// In order of preference, pure depth formats first since the renderer has no use for stencil yet
+static const VkFormat depthFormatCandidates[] =
+{
+    VK_FORMAT_D32_SFLOAT,
+    VK_FORMAT_D32_SFLOAT_S8_UINT,
+    VK_FORMAT_D24_UNORM_S8_UINT,
+    VK_FORMAT_D16_UNORM
+};
+
+VkFormat selectDepthFormat(VkPhysicalDevice physicalDevice)
+{
+    for (VkFormat format : depthFormatCandidates)
+    {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+
+        if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+        {
+            return format;
+        }
+    }
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+bool hasStencilComponent(VkFormat format)
+{
+    return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
+}
+
+DepthBuffer createDepthBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkExtent2D extent, VkFormat format)
+{
+    DepthBuffer depthBuffer;
+    depthBuffer.image = VK_NULL_HANDLE;
+    depthBuffer.memory = VK_NULL_HANDLE;
+    depthBuffer.view = VK_NULL_HANDLE;
+    depthBuffer.format = format;
+
+    VkImageCreateInfo imageCreateInfo;
+    imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageCreateInfo.pNext = nullptr;
+    imageCreateInfo.flags = 0;
+    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageCreateInfo.format = format;
+    imageCreateInfo.extent = { extent.width, extent.height, 1 };
+    imageCreateInfo.mipLevels = 1;
+    imageCreateInfo.arrayLayers = 1;
+    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCreateInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageCreateInfo.queueFamilyIndexCount = 0;
+    imageCreateInfo.pQueueFamilyIndices = nullptr;
+    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VkResult result = vkCreateImage(device, &imageCreateInfo, getHostAllocator(VK_OBJECT_TYPE_IMAGE), &depthBuffer.image);
+    CHECK_VKRESULT(result);
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(device, depthBuffer.image, &memoryRequirements);
+
+    uint32_t memoryType = findMemoryType(
+        physicalDevice,
+        memoryRequirements.memoryTypeBits,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT
+    );
+    if (memoryType == invalidMemoryType)
+    {
+        __debugbreak(); // No device local memory for the depth buffer
+        return depthBuffer;
+    }
+
+    VkMemoryAllocateInfo memoryAllocateInfo;
+    memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memoryAllocateInfo.pNext = nullptr;
+    memoryAllocateInfo.allocationSize = memoryRequirements.size;
+    memoryAllocateInfo.memoryTypeIndex = memoryType;
+
+    result = vkAllocateMemory(device, &memoryAllocateInfo, getHostAllocator(VK_OBJECT_TYPE_DEVICE_MEMORY), &depthBuffer.memory);
+    CHECK_VKRESULT(result);
+
+    result = vkBindImageMemory(device, depthBuffer.image, depthBuffer.memory, 0);
+    CHECK_VKRESULT(result);
+
+    // Views of combined formats used as depth stencil attachments have to cover both aspects
+    VkImageViewCreateInfo imageViewCreateInfo;
+    imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    imageViewCreateInfo.pNext = nullptr;
+    imageViewCreateInfo.flags = 0;
+    imageViewCreateInfo.image = depthBuffer.image;
+    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    imageViewCreateInfo.format = format;
+    imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+    imageViewCreateInfo.subresourceRange.levelCount = 1;
+    imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+    imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+    if (hasStencilComponent(format))
+    {
+        imageViewCreateInfo.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+
+    result = vkCreateImageView(device, &imageViewCreateInfo, getHostAllocator(VK_OBJECT_TYPE_IMAGE_VIEW), &depthBuffer.view);
+    CHECK_VKRESULT(result);
+
+    return depthBuffer;
+}
+
+void destroyDepthBuffer(VkDevice device, DepthBuffer& depthBuffer)
+{
+    vkDestroyImageView(device, depthBuffer.view, getHostAllocator(VK_OBJECT_TYPE_IMAGE_VIEW));
+    vkDestroyImage(device, depthBuffer.image, getHostAllocator(VK_OBJECT_TYPE_IMAGE));
+    vkFreeMemory(device, depthBuffer.memory, getHostAllocator(VK_OBJECT_TYPE_DEVICE_MEMORY));
+
+    depthBuffer.image = VK_NULL_HANDLE;
+    depthBuffer.memory = VK_NULL_HANDLE;
+    depthBuffer.view = VK_NULL_HANDLE;
+}
@@ -0,0 +1,48 @@
+// Vulkan Renderer - depth_buffer.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _DEPTH_BUFFER_H_
+#define _DEPTH_BUFFER_H_
+
+#include "vkdefines.h"
+
+struct DepthBuffer
+{
+    VkImage        image;
+    VkDeviceMemory memory;
+    VkImageView    view;
+    VkFormat       format;
+};
+
+// First of D32, D32S8, D24S8 and D16 that can be an optimally tiled depth attachment.
+// Returns VK_FORMAT_UNDEFINED if the device supports none of them.
+VkFormat selectDepthFormat(VkPhysicalDevice physicalDevice);
+
+bool hasStencilComponent(VkFormat format);
+
+// The contents never leave the render pass, so the image is transient and uses lazily allocated memory where there is some
+DepthBuffer createDepthBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkExtent2D extent, VkFormat format);
+
+void destroyDepthBuffer(VkDevice device, DepthBuffer& depthBuffer);
+
+#endif // !_DEPTH_BUFFER_H_
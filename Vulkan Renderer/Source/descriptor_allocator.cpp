@@ -0,0 +1,256 @@
+// Vulkan Renderer - descriptor_allocator.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "descriptor_allocator.h"
+#include "host_allocator.h"
+
+constexpr uint32_t initialPoolSetCount = 64;
+constexpr uint32_t maxPoolSetCount = 4096;
+
+// Descriptors per set a pool is provisioned for, by type
+constexpr VkDescriptorPoolSize poolSizeRatios[] =
+{
+    { VK_DESCRIPTOR_TYPE_SAMPLER,                1 },
+    { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
+    { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,          4 },
+    { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          1 },
+    { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         2 },
+    { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         2 },
+};
+
+struct FramePools
+{
+    std::vector<VkDescriptorPool> pools;
+    uint32_t                      currentPool;
+    uint32_t                      nextPoolSetCount;
+    DescriptorFrameStats          stats;
+    DescriptorFrameStats          lastStats;
+};
+
+static std::vector<FramePools> frames;
+static std::unordered_map<VkDescriptorSetLayout, VkDescriptorUpdateTemplate> updateTemplates;
+
+void createDescriptorAllocator(uint32_t frameCount)
+{
+    frames.resize(frameCount);
+
+    for (FramePools& frame : frames)
+    {
+        frame.currentPool = 0;
+        frame.nextPoolSetCount = initialPoolSetCount;
+        frame.stats = {};
+        frame.lastStats = {};
+    }
+}
+
+static VkDescriptorPool createPool(VkDevice device, uint32_t setCount)
+{
+    constexpr uint32_t typeCount = sizeof(poolSizeRatios) / sizeof(VkDescriptorPoolSize);
+
+    VkDescriptorPoolSize poolSizes[typeCount];
+    for (uint32_t i = 0; i < typeCount; i++)
+    {
+        poolSizes[i].type = poolSizeRatios[i].type;
+        poolSizes[i].descriptorCount = poolSizeRatios[i].descriptorCount * setCount;
+    }
+
+    VkDescriptorPoolCreateInfo descriptorPoolCreateInfo;
+    descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolCreateInfo.pNext = nullptr;
+    descriptorPoolCreateInfo.flags = 0; // Sets are never freed individually
+    descriptorPoolCreateInfo.maxSets = setCount;
+    descriptorPoolCreateInfo.poolSizeCount = typeCount;
+    descriptorPoolCreateInfo.pPoolSizes = poolSizes;
+
+    VkDescriptorPool descriptorPool;
+    VkResult result = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, getHostAllocator(VK_OBJECT_TYPE_DESCRIPTOR_POOL), &descriptorPool);
+    CHECK_VKRESULT(result);
+
+    return descriptorPool;
+}
+
+void beginDescriptorFrame(VkDevice device, uint32_t frameIndex)
+{
+    FramePools& frame = frames[frameIndex];
+
+    // Pools past currentPool weren't touched since the last reset
+    for (uint32_t i = 0; i <= frame.currentPool && i < frame.pools.size(); i++)
+    {
+        VkResult result = vkResetDescriptorPool(device, frame.pools[i], 0);
+        CHECK_VKRESULT(result);
+    }
+
+    frame.lastStats = frame.stats;
+    frame.currentPool = 0;
+    frame.stats.setCount = 0;
+    frame.stats.poolCount = uint32_t(frame.pools.size());
+    frame.stats.poolsCreated = 0;
+}
+
+DescriptorFrameStats getDescriptorFrameStats(uint32_t frameIndex)
+{
+    return frames[frameIndex].lastStats;
+}
+
+VkDescriptorUpdateTemplate getDescriptorUpdateTemplate(
+    VkDevice device,
+    VkDescriptorSetLayout layout,
+    const VkDescriptorSetLayoutBinding* bindings,
+    uint32_t bindingCount)
+{
+    auto it = updateTemplates.find(layout);
+    if (it != updateTemplates.end())
+    {
+        return it->second;
+    }
+
+    std::vector<const VkDescriptorSetLayoutBinding*> sortedBindings(bindingCount);
+    for (uint32_t i = 0; i < bindingCount; i++)
+    {
+        sortedBindings[i] = &bindings[i];
+    }
+
+    std::sort(sortedBindings.begin(), sortedBindings.end(), [](const VkDescriptorSetLayoutBinding* a, const VkDescriptorSetLayoutBinding* b)
+    {
+        return a->binding < b->binding;
+    });
+
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    entries.reserve(bindingCount);
+
+    size_t descriptorIndex = 0;
+    for (const VkDescriptorSetLayoutBinding* binding : sortedBindings)
+    {
+        if (binding->descriptorCount == 0)
+        {
+            continue;
+        }
+
+        VkDescriptorUpdateTemplateEntry entry;
+        entry.dstBinding = binding->binding;
+        entry.dstArrayElement = 0;
+        entry.descriptorCount = binding->descriptorCount;
+        entry.descriptorType = binding->descriptorType;
+        entry.offset = descriptorIndex * sizeof(DescriptorUpdateData);
+        entry.stride = sizeof(DescriptorUpdateData);
+
+        entries.push_back(entry);
+        descriptorIndex += binding->descriptorCount;
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo updateTemplateCreateInfo;
+    updateTemplateCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    updateTemplateCreateInfo.pNext = nullptr;
+    updateTemplateCreateInfo.flags = 0;
+    updateTemplateCreateInfo.descriptorUpdateEntryCount = uint32_t(entries.size());
+    updateTemplateCreateInfo.pDescriptorUpdateEntries = entries.data();
+    updateTemplateCreateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    updateTemplateCreateInfo.descriptorSetLayout = layout;
+    updateTemplateCreateInfo.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS; // Ignored for descriptor set templates
+    updateTemplateCreateInfo.pipelineLayout = VK_NULL_HANDLE;
+    updateTemplateCreateInfo.set = 0;
+
+    VkDescriptorUpdateTemplate updateTemplate;
+    VkResult result = vkCreateDescriptorUpdateTemplate(device, &updateTemplateCreateInfo, getHostAllocator(VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE), &updateTemplate);
+    CHECK_VKRESULT(result);
+
+    updateTemplates.emplace(layout, updateTemplate);
+    return updateTemplate;
+}
+
+VkDescriptorSet allocateFrameDescriptorSet(VkDevice device, uint32_t frameIndex, VkDescriptorSetLayout layout)
+{
+    FramePools& frame = frames[frameIndex];
+
+    VkDescriptorSetAllocateInfo descriptorSetAllocateInfo;
+    descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptorSetAllocateInfo.pNext = nullptr;
+    descriptorSetAllocateInfo.descriptorSetCount = 1;
+    descriptorSetAllocateInfo.pSetLayouts = &layout;
+
+    while (true)
+    {
+        const bool newPool = frame.currentPool == frame.pools.size();
+        if (newPool)
+        {
+            // Each new pool is twice as large as the previous one, so a heavy frame settles on a few pools quickly
+            frame.pools.push_back(createPool(device, frame.nextPoolSetCount));
+            frame.nextPoolSetCount = std::min(frame.nextPoolSetCount * 2, maxPoolSetCount);
+            frame.stats.poolCount++;
+            frame.stats.poolsCreated++;
+        }
+
+        descriptorSetAllocateInfo.descriptorPool = frame.pools[frame.currentPool];
+
+        VkDescriptorSet descriptorSet;
+        VkResult result = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &descriptorSet);
+
+        if (result == VK_SUCCESS)
+        {
+            frame.stats.setCount++;
+            return descriptorSet;
+        }
+
+        // A fresh pool failing as well means the layout uses a type the pools aren't provisioned for
+        if (newPool || (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL))
+        {
+            __debugbreak();
+            return VK_NULL_HANDLE;
+        }
+
+        frame.currentPool++;
+    }
+}
+
+VkDescriptorSet allocateFrameDescriptorSet(
+    VkDevice device,
+    uint32_t frameIndex,
+    VkDescriptorSetLayout layout,
+    VkDescriptorUpdateTemplate updateTemplate,
+    const DescriptorUpdateData* data)
+{
+    VkDescriptorSet descriptorSet = allocateFrameDescriptorSet(device, frameIndex, layout);
+    vkUpdateDescriptorSetWithTemplate(device, descriptorSet, updateTemplate, data);
+    return descriptorSet;
+}
+
+void destroyDescriptorAllocator(VkDevice device)
+{
+    for (auto& entry : updateTemplates)
+    {
+        vkDestroyDescriptorUpdateTemplate(device, entry.second, getHostAllocator(VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE));
+    }
+
+    for (FramePools& frame : frames)
+    {
+        for (VkDescriptorPool descriptorPool : frame.pools)
+        {
+            vkDestroyDescriptorPool(device, descriptorPool, getHostAllocator(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+        }
+    }
+
+    updateTemplates.clear();
+    frames.clear();
+}
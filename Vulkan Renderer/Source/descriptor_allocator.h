@@ -0,0 +1,80 @@
+// Vulkan Renderer - descriptor_allocator.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _DESCRIPTOR_ALLOCATOR_H_
+#define _DESCRIPTOR_ALLOCATOR_H_
+
+#include <cstdint>
+
+#include "vkdefines.h"
+
+// Transient descriptor sets for everything that doesn't go through the bindless set. Sets are only
+// valid for the frame they were allocated in, all pools of a frame are reset at once when it retires.
+// Meant to be used from the thread recording the frame.
+
+// Per descriptor data read by the update templates. The array passed for a set holds one element per
+// descriptor, in binding order and then array element order.
+union DescriptorUpdateData
+{
+    VkDescriptorImageInfo  image;
+    VkDescriptorBufferInfo buffer;
+    VkBufferView           texelBufferView;
+};
+
+struct DescriptorFrameStats
+{
+    uint32_t setCount;
+    uint32_t poolCount;
+    uint32_t poolsCreated; // Pools the frame had to add because the existing ones ran out
+};
+
+void createDescriptorAllocator(uint32_t frameCount);
+
+// Call once the GPU is done with the frame, resets all of its pools
+void beginDescriptorFrame(VkDevice device, uint32_t frameIndex);
+
+// Stats of the most recent frame that went through beginDescriptorFrame again
+DescriptorFrameStats getDescriptorFrameStats(uint32_t frameIndex);
+
+// Templates are created on first use and cached per layout, bindings have to be the ones of the layout
+VkDescriptorUpdateTemplate getDescriptorUpdateTemplate(
+    VkDevice device,
+    VkDescriptorSetLayout layout,
+    const VkDescriptorSetLayoutBinding* bindings,
+    uint32_t bindingCount
+);
+
+VkDescriptorSet allocateFrameDescriptorSet(VkDevice device, uint32_t frameIndex, VkDescriptorSetLayout layout);
+
+// Allocates a set and fills it in one call through the template
+VkDescriptorSet allocateFrameDescriptorSet(
+    VkDevice device,
+    uint32_t frameIndex,
+    VkDescriptorSetLayout layout,
+    VkDescriptorUpdateTemplate updateTemplate,
+    const DescriptorUpdateData* data
+);
+
+void destroyDescriptorAllocator(VkDevice device);
+
+#endif // !_DESCRIPTOR_ALLOCATOR_H_
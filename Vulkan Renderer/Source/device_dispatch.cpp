@@ -0,0 +1,47 @@
+// Vulkan Renderer - device_dispatch.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <cstring>
+
+#include "device_dispatch.h"
+#include "platform.h"
+
+DeviceDispatch deviceDispatch;
+
+void loadDeviceDispatch(VkDevice device)
+{
+#define DEVICE_DISPATCH_LOAD(name) \
+    deviceDispatch.name = (PFN_##name)vkGetDeviceProcAddr(device, #name);
+
+    DEVICE_DISPATCH_FUNCTIONS(DEVICE_DISPATCH_LOAD)
+#undef DEVICE_DISPATCH_LOAD
+
+    // Functions of extensions the device was created without stay null, the core ones have to be there
+    if (deviceDispatch.vkQueueSubmit == nullptr)
+    {
+        __debugbreak();
+    }
+}
+
+void clearDeviceDispatch()
+{
+    std::memset(&deviceDispatch, 0, sizeof(deviceDispatch));
+}
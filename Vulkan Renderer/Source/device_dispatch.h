@@ -0,0 +1,111 @@
+// Vulkan Renderer - device_dispatch.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _DEVICE_DISPATCH_H_
+#define _DEVICE_DISPATCH_H_
+
+#include <vulkan/vulkan.hpp>
+
+// Device functions called every frame. The vulkan-1 exports of these are loader trampolines that look up the
+// device's dispatch table on every call, the pointers from vkGetDeviceProcAddr go straight into the driver.
+// Setup and teardown functions run a few times per object and stay on the loader.
+#define DEVICE_DISPATCH_FUNCTIONS(X) \
+    X(vkAcquireNextImageKHR) \
+    X(vkAllocateDescriptorSets) \
+    X(vkBeginCommandBuffer) \
+    X(vkCmdBeginRenderPass) \
+    X(vkCmdBindDescriptorSets) \
+    X(vkCmdBindIndexBuffer) \
+    X(vkCmdBindPipeline) \
+    X(vkCmdBindVertexBuffers) \
+    X(vkCmdCopyBuffer) \
+    X(vkCmdDispatch) \
+    X(vkCmdDraw) \
+    X(vkCmdDrawIndexedIndirectCount) \
+    X(vkCmdEndRenderPass) \
+    X(vkCmdFillBuffer) \
+    X(vkCmdNextSubpass) \
+    X(vkCmdPipelineBarrier) \
+    X(vkCmdPushConstants) \
+    X(vkCmdSetScissor) \
+    X(vkCmdSetViewport) \
+    X(vkEndCommandBuffer) \
+    X(vkGetFenceStatus) \
+    X(vkQueuePresentKHR) \
+    X(vkQueueSubmit) \
+    X(vkResetCommandPool) \
+    X(vkResetDescriptorPool) \
+    X(vkResetFences) \
+    X(vkUpdateDescriptorSets) \
+    X(vkUpdateDescriptorSetWithTemplate) \
+    X(vkWaitForFences)
+
+struct DeviceDispatch
+{
+#define DEVICE_DISPATCH_MEMBER(name) PFN_##name name;
+    DEVICE_DISPATCH_FUNCTIONS(DEVICE_DISPATCH_MEMBER)
+#undef DEVICE_DISPATCH_MEMBER
+};
+
+// Loaded for the one device of the renderer, read by every thread that records or submits
+extern DeviceDispatch deviceDispatch;
+
+// Right after vkCreateDevice, before any of the functions above is called
+void loadDeviceDispatch(VkDevice device);
+
+// Right after vkDestroyDevice, calls through stale pointers crash instead of reaching a destroyed device
+void clearDeviceDispatch();
+
+// Plain calls of the functions above go through the table. A call with the name in parentheses,
+// (vkCmdDraw)(...), still reaches the loader export.
+#define vkAcquireNextImageKHR(...)             deviceDispatch.vkAcquireNextImageKHR(__VA_ARGS__)
+#define vkAllocateDescriptorSets(...)          deviceDispatch.vkAllocateDescriptorSets(__VA_ARGS__)
+#define vkBeginCommandBuffer(...)              deviceDispatch.vkBeginCommandBuffer(__VA_ARGS__)
+#define vkCmdBeginRenderPass(...)              deviceDispatch.vkCmdBeginRenderPass(__VA_ARGS__)
+#define vkCmdBindDescriptorSets(...)           deviceDispatch.vkCmdBindDescriptorSets(__VA_ARGS__)
+#define vkCmdBindIndexBuffer(...)              deviceDispatch.vkCmdBindIndexBuffer(__VA_ARGS__)
+#define vkCmdBindPipeline(...)                 deviceDispatch.vkCmdBindPipeline(__VA_ARGS__)
+#define vkCmdBindVertexBuffers(...)            deviceDispatch.vkCmdBindVertexBuffers(__VA_ARGS__)
+#define vkCmdCopyBuffer(...)                   deviceDispatch.vkCmdCopyBuffer(__VA_ARGS__)
+#define vkCmdDispatch(...)                     deviceDispatch.vkCmdDispatch(__VA_ARGS__)
+#define vkCmdDraw(...)                         deviceDispatch.vkCmdDraw(__VA_ARGS__)
+#define vkCmdDrawIndexedIndirectCount(...)     deviceDispatch.vkCmdDrawIndexedIndirectCount(__VA_ARGS__)
+#define vkCmdEndRenderPass(...)                deviceDispatch.vkCmdEndRenderPass(__VA_ARGS__)
+#define vkCmdFillBuffer(...)                   deviceDispatch.vkCmdFillBuffer(__VA_ARGS__)
+#define vkCmdNextSubpass(...)                  deviceDispatch.vkCmdNextSubpass(__VA_ARGS__)
+#define vkCmdPipelineBarrier(...)              deviceDispatch.vkCmdPipelineBarrier(__VA_ARGS__)
+#define vkCmdPushConstants(...)                deviceDispatch.vkCmdPushConstants(__VA_ARGS__)
+#define vkCmdSetScissor(...)                   deviceDispatch.vkCmdSetScissor(__VA_ARGS__)
+#define vkCmdSetViewport(...)                  deviceDispatch.vkCmdSetViewport(__VA_ARGS__)
+#define vkEndCommandBuffer(...)                deviceDispatch.vkEndCommandBuffer(__VA_ARGS__)
+#define vkGetFenceStatus(...)                  deviceDispatch.vkGetFenceStatus(__VA_ARGS__)
+#define vkQueuePresentKHR(...)                 deviceDispatch.vkQueuePresentKHR(__VA_ARGS__)
+#define vkQueueSubmit(...)                     deviceDispatch.vkQueueSubmit(__VA_ARGS__)
+#define vkResetCommandPool(...)                deviceDispatch.vkResetCommandPool(__VA_ARGS__)
+#define vkResetDescriptorPool(...)             deviceDispatch.vkResetDescriptorPool(__VA_ARGS__)
+#define vkResetFences(...)                     deviceDispatch.vkResetFences(__VA_ARGS__)
+#define vkUpdateDescriptorSets(...)            deviceDispatch.vkUpdateDescriptorSets(__VA_ARGS__)
+#define vkUpdateDescriptorSetWithTemplate(...) deviceDispatch.vkUpdateDescriptorSetWithTemplate(__VA_ARGS__)
+#define vkWaitForFences(...)                   deviceDispatch.vkWaitForFences(__VA_ARGS__)
+
+#endif // !_DEVICE_DISPATCH_H_
@@ -0,0 +1,323 @@
+// Vulkan Renderer - draw_queue.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#include "draw_queue.h"
+
+constexpr uint32_t radixBits = 8;
+constexpr uint32_t radixSize = 1 << radixBits;
+constexpr uint32_t radixPassCount = 64 / radixBits;
+
+// Below this the thread startup costs more than the parallel histogram and scatter save
+constexpr size_t parallelSortThreshold = 32768;
+constexpr uint32_t maxSortThreads = 16;
+
+// One per thread and cache line aligned, so counting doesn't false share
+struct alignas(64) RadixHistogram
+{
+    uint32_t counts[radixSize];
+};
+
+struct SortBarrier
+{
+    std::atomic<uint32_t> waiting;
+    std::atomic<uint32_t> generation;
+    uint32_t              threadCount;
+};
+
+struct ParallelSortContext
+{
+    DrawPacket*     packets;
+    DrawPacket*     scratch;
+    size_t          packetCount;
+    uint32_t        threadCount;
+    RadixHistogram* histograms;
+    SortBarrier     barrier;
+    bool            resultInScratch;
+};
+
+static inline uint32_t getDigit(uint64_t key, uint32_t pass)
+{
+    return uint32_t(key >> (pass * radixBits)) & (radixSize - 1);
+}
+
+uint64_t makeSortKey(uint32_t layer, uint32_t pipeline, uint32_t material, float depth, bool backToFront)
+{
+    constexpr uint32_t depthMax = (1u << sortKeyDepthBits) - 1;
+
+    float clampedDepth = std::clamp(depth, 0.0f, 1.0f);
+    uint32_t quantizedDepth = uint32_t(clampedDepth * float(depthMax));
+    if (backToFront)
+    {
+        quantizedDepth = depthMax - quantizedDepth;
+    }
+
+    uint64_t key = 0;
+    key |= uint64_t(layer & ((1u << sortKeyLayerBits) - 1)) << sortKeyLayerShift;
+    key |= uint64_t(pipeline & ((1u << sortKeyPipelineBits) - 1)) << sortKeyPipelineShift;
+    key |= uint64_t(material & ((1u << sortKeyMaterialBits) - 1)) << sortKeyMaterialShift;
+    key |= uint64_t(quantizedDepth) << sortKeyDepthShift;
+    return key;
+}
+
+uint64_t makeInstancedSortKey(uint32_t layer, uint32_t pipeline, uint32_t material, uint32_t mesh)
+{
+    uint64_t key = makeSortKey(layer, pipeline, material, 0.0f);
+    key |= uint64_t(1) << sortKeyInstancedShift;
+    key |= uint64_t(mesh & ((1u << sortKeyDepthBits) - 1)) << sortKeyDepthShift;
+    return key;
+}
+
+void clearDrawQueue(DrawQueue& queue)
+{
+    queue.packets.clear();
+}
+
+void pushDrawPacket(DrawQueue& queue, uint64_t sortKey, uint32_t drawIndex)
+{
+    DrawPacket packet;
+    packet.sortKey = sortKey;
+    packet.drawIndex = drawIndex;
+    packet.reserved = 0;
+    queue.packets.push_back(packet);
+}
+
+static void waitBarrier(SortBarrier& barrier)
+{
+    uint32_t generation = barrier.generation.load(std::memory_order_acquire);
+    if (barrier.waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == barrier.threadCount)
+    {
+        barrier.waiting.store(0, std::memory_order_relaxed);
+        barrier.generation.fetch_add(1, std::memory_order_release);
+        return;
+    }
+
+    while (barrier.generation.load(std::memory_order_acquire) == generation)
+    {
+        std::this_thread::yield();
+    }
+}
+
+// Returns false if the pass can't reorder anything because every key falls into the same bucket
+static bool computeOffsets(const uint32_t* totals, size_t packetCount, uint32_t* offsets)
+{
+    uint32_t offset = 0;
+    for (uint32_t digit = 0; digit < radixSize; digit++)
+    {
+        if (totals[digit] == packetCount)
+        {
+            return false;
+        }
+
+        offsets[digit] = offset;
+        offset += totals[digit];
+    }
+    return true;
+}
+
+static bool sortSingleThreaded(DrawPacket* packets, DrawPacket* scratch, size_t packetCount)
+{
+    // All digit histograms come from a single read of the keys, the counts don't depend on the order
+    static thread_local uint32_t histograms[radixPassCount][radixSize];
+    std::memset(histograms, 0, sizeof(histograms));
+
+    for (size_t i = 0; i < packetCount; i++)
+    {
+        uint64_t key = packets[i].sortKey;
+        for (uint32_t pass = 0; pass < radixPassCount; pass++)
+        {
+            histograms[pass][getDigit(key, pass)]++;
+        }
+    }
+
+    DrawPacket* source = packets;
+    DrawPacket* destination = scratch;
+
+    for (uint32_t pass = 0; pass < radixPassCount; pass++)
+    {
+        uint32_t offsets[radixSize];
+        if (!computeOffsets(histograms[pass], packetCount, offsets))
+        {
+            continue;
+        }
+
+        for (size_t i = 0; i < packetCount; i++)
+        {
+            destination[offsets[getDigit(source[i].sortKey, pass)]++] = source[i];
+        }
+
+        std::swap(source, destination);
+    }
+
+    return source == scratch;
+}
+
+static void sortWorker(ParallelSortContext& context, uint32_t threadIndex)
+{
+    size_t chunkSize = (context.packetCount + context.threadCount - 1) / context.threadCount;
+    size_t begin = std::min(context.packetCount, chunkSize * threadIndex);
+    size_t end = std::min(context.packetCount, begin + chunkSize);
+
+    DrawPacket* source = context.packets;
+    DrawPacket* destination = context.scratch;
+
+    for (uint32_t pass = 0; pass < radixPassCount; pass++)
+    {
+        uint32_t* counts = context.histograms[threadIndex].counts;
+        std::memset(counts, 0, sizeof(uint32_t) * radixSize);
+        for (size_t i = begin; i < end; i++)
+        {
+            counts[getDigit(source[i].sortKey, pass)]++;
+        }
+
+        waitBarrier(context.barrier);
+
+        // Every thread derives the same totals, so all of them agree on skipping the pass.
+        // A thread's bucket starts after the whole bucket of all lower digits and after the part of
+        // its own digit counted by lower threads, which keeps the sort stable.
+        uint32_t totals[radixSize] = {};
+        uint32_t lowerThreadCounts[radixSize] = {};
+        for (uint32_t thread = 0; thread < context.threadCount; thread++)
+        {
+            const uint32_t* threadCounts = context.histograms[thread].counts;
+            for (uint32_t digit = 0; digit < radixSize; digit++)
+            {
+                totals[digit] += threadCounts[digit];
+                if (thread < threadIndex)
+                {
+                    lowerThreadCounts[digit] += threadCounts[digit];
+                }
+            }
+        }
+
+        uint32_t offsets[radixSize];
+        bool reorders = computeOffsets(totals, context.packetCount, offsets);
+        if (reorders)
+        {
+            for (uint32_t digit = 0; digit < radixSize; digit++)
+            {
+                offsets[digit] += lowerThreadCounts[digit];
+            }
+
+            for (size_t i = begin; i < end; i++)
+            {
+                destination[offsets[getDigit(source[i].sortKey, pass)]++] = source[i];
+            }
+        }
+
+        // Nobody may count the next pass before all threads are done reading this one's histograms
+        waitBarrier(context.barrier);
+
+        if (reorders)
+        {
+            std::swap(source, destination);
+        }
+    }
+
+    if (threadIndex == 0)
+    {
+        context.resultInScratch = source == context.scratch;
+    }
+}
+
+void sortDrawQueue(DrawQueue& queue, uint32_t threadCount)
+{
+    size_t packetCount = queue.packets.size();
+    if (packetCount < 2)
+    {
+        return;
+    }
+
+    queue.scratch.resize(packetCount);
+
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = std::min(threadCount, maxSortThreads);
+
+    bool resultInScratch = false;
+    if (threadCount == 1 || packetCount < parallelSortThreshold)
+    {
+        resultInScratch = sortSingleThreaded(queue.packets.data(), queue.scratch.data(), packetCount);
+    }
+    else
+    {
+        RadixHistogram histograms[maxSortThreads];
+
+        ParallelSortContext context;
+        context.packets = queue.packets.data();
+        context.scratch = queue.scratch.data();
+        context.packetCount = packetCount;
+        context.threadCount = threadCount;
+        context.histograms = histograms;
+        context.barrier.waiting = 0;
+        context.barrier.generation = 0;
+        context.barrier.threadCount = threadCount;
+        context.resultInScratch = false;
+
+        // The calling thread sorts the first chunk itself
+        std::thread workers[maxSortThreads - 1];
+        for (uint32_t i = 1; i < threadCount; i++)
+        {
+            workers[i - 1] = std::thread(sortWorker, std::ref(context), i);
+        }
+        sortWorker(context, 0);
+        for (uint32_t i = 1; i < threadCount; i++)
+        {
+            workers[i - 1].join();
+        }
+
+        resultInScratch = context.resultInScratch;
+    }
+
+    if (resultInScratch)
+    {
+        std::swap(queue.packets, queue.scratch);
+    }
+}
+
+void buildDrawBatches(const DrawQueue& queue, std::vector<DrawBatch>& batches)
+{
+    batches.clear();
+
+    uint32_t packetCount = uint32_t(queue.packets.size());
+    for (uint32_t i = 0; i < packetCount;)
+    {
+        DrawBatch batch;
+        batch.firstPacket = i;
+        batch.packetCount = 1;
+
+        // Equal plain keys only mean equal state and quantized depth, not the same mesh
+        uint64_t sortKey = queue.packets[i].sortKey;
+        while (isSortKeyInstanced(sortKey) && i + batch.packetCount < packetCount && queue.packets[i + batch.packetCount].sortKey == sortKey)
+        {
+            batch.packetCount++;
+        }
+
+        batches.push_back(batch);
+        i += batch.packetCount;
+    }
+}
@@ -0,0 +1,111 @@
+// Vulkan Renderer - draw_queue.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _DRAW_QUEUE_H_
+#define _DRAW_QUEUE_H_
+
+#include <cstdint>
+#include <vector>
+
+// Sort key layout from the most significant bit down: layer 8 | pipeline 16 | material 16 | instanced 1 | depth 23.
+// Sorting the keys ascending groups draws by layer first, then by pipeline and material to keep state
+// changes down, and orders each group by depth last. Instanced keys carry the mesh id in the depth field.
+constexpr uint32_t sortKeyLayerBits = 8;
+constexpr uint32_t sortKeyPipelineBits = 16;
+constexpr uint32_t sortKeyMaterialBits = 16;
+constexpr uint32_t sortKeyInstancedBits = 1;
+constexpr uint32_t sortKeyDepthBits = 23;
+
+constexpr uint32_t sortKeyDepthShift = 0;
+constexpr uint32_t sortKeyInstancedShift = sortKeyDepthShift + sortKeyDepthBits;
+constexpr uint32_t sortKeyMaterialShift = sortKeyInstancedShift + sortKeyInstancedBits;
+constexpr uint32_t sortKeyPipelineShift = sortKeyMaterialShift + sortKeyMaterialBits;
+constexpr uint32_t sortKeyLayerShift = sortKeyPipelineShift + sortKeyPipelineBits;
+
+static_assert(sortKeyLayerShift + sortKeyLayerBits == 64, "Sort key fields have to fill 64 bits");
+
+// Pipeline and material are small ids handed out by the caller, not handles, values outside the
+// field are truncated. depth is the view depth normalized to [0, 1]. Opaque layers sort front to back,
+// transparent ones have to pass backToFront.
+uint64_t makeSortKey(uint32_t layer, uint32_t pipeline, uint32_t material, float depth, bool backToFront = false);
+
+// Puts the mesh id where the depth would go, so all draws of one mesh and material end up next to each
+// other and form a single batch. Meant for opaque layers where batching beats front to back order.
+// Sets the instanced bit, only keys carrying it are merged into batches.
+uint64_t makeInstancedSortKey(uint32_t layer, uint32_t pipeline, uint32_t material, uint32_t mesh);
+
+inline bool isSortKeyInstanced(uint64_t key)
+{
+    return ((key >> sortKeyInstancedShift) & 1) != 0;
+}
+
+inline uint32_t getSortKeyLayer(uint64_t key)
+{
+    return uint32_t(key >> sortKeyLayerShift) & ((1u << sortKeyLayerBits) - 1);
+}
+
+inline uint32_t getSortKeyPipeline(uint64_t key)
+{
+    return uint32_t(key >> sortKeyPipelineShift) & ((1u << sortKeyPipelineBits) - 1);
+}
+
+inline uint32_t getSortKeyMaterial(uint64_t key)
+{
+    return uint32_t(key >> sortKeyMaterialShift) & ((1u << sortKeyMaterialBits) - 1);
+}
+
+struct DrawPacket
+{
+    uint64_t sortKey;
+    uint32_t drawIndex; // Into the caller's draw list
+    uint32_t reserved;
+};
+
+static_assert(sizeof(DrawPacket) == 16, "DrawPacket should stay 16 bytes to keep the sort scatter cheap");
+
+// Run of packets with equal instanced sort keys in a sorted queue, drawn as one instanced draw.
+// Packets with keys from makeSortKey always get a batch of their own.
+struct DrawBatch
+{
+    uint32_t firstPacket;
+    uint32_t packetCount;
+};
+
+struct DrawQueue
+{
+    std::vector<DrawPacket> packets;
+    std::vector<DrawPacket> scratch; // Ping-pong buffer for the sort, kept to avoid reallocating every frame
+};
+
+void clearDrawQueue(DrawQueue& queue);
+
+void pushDrawPacket(DrawQueue& queue, uint64_t sortKey, uint32_t drawIndex);
+
+// Stable LSD radix sort over the keys, 8 bits per pass. Passes where all keys share the digit are
+// skipped. Large queues are split across threadCount threads, 0 picks the hardware thread count.
+void sortDrawQueue(DrawQueue& queue, uint32_t threadCount = 0);
+
+// Splits a sorted queue into runs of identical instanced keys, every other packet is its own batch
+void buildDrawBatches(const DrawQueue& queue, std::vector<DrawBatch>& batches);
+
+#endif // !_DRAW_QUEUE_H_
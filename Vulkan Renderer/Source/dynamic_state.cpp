@@ -0,0 +1,171 @@
+// Vulkan Renderer - dynamic_state.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <cstring>
+
+#include "dynamic_state.h"
+
+static VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures;
+static bool extendedDynamicStateEnabled = false;
+
+static PFN_vkCmdSetCullModeEXT         cmdSetCullMode = nullptr;
+static PFN_vkCmdSetFrontFaceEXT        cmdSetFrontFace = nullptr;
+static PFN_vkCmdSetDepthTestEnableEXT  cmdSetDepthTestEnable = nullptr;
+static PFN_vkCmdSetDepthWriteEnableEXT cmdSetDepthWriteEnable = nullptr;
+static PFN_vkCmdSetDepthCompareOpEXT   cmdSetDepthCompareOp = nullptr;
+
+void requestExtendedDynamicState(
+    VkPhysicalDevice physicalDevice,
+    const VkExtensionProperties* extensions,
+    uint32_t extensionCount,
+    std::vector<const char*>& enabledExtensions,
+    void*& featureChain)
+{
+    extendedDynamicStateEnabled = false;
+
+    bool extensionPresent = false;
+    for (uint32_t i = 0; i < extensionCount; i++)
+    {
+        if (std::strcmp(extensions[i].extensionName, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME) == 0)
+        {
+            extensionPresent = true;
+            break;
+        }
+    }
+
+    if (!extensionPresent)
+    {
+        return;
+    }
+
+    extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    extendedDynamicStateFeatures.pNext = nullptr;
+    extendedDynamicStateFeatures.extendedDynamicState = VK_FALSE;
+
+    VkPhysicalDeviceFeatures2 features;
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &extendedDynamicStateFeatures;
+
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+    if (extendedDynamicStateFeatures.extendedDynamicState != VK_TRUE)
+    {
+        return;
+    }
+
+    extendedDynamicStateFeatures.pNext = featureChain;
+    featureChain = &extendedDynamicStateFeatures;
+
+    enabledExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+    extendedDynamicStateEnabled = true;
+}
+
+void loadDynamicStateFunctions(VkDevice device)
+{
+    if (!extendedDynamicStateEnabled)
+    {
+        return;
+    }
+
+    cmdSetCullMode = (PFN_vkCmdSetCullModeEXT)vkGetDeviceProcAddr(device, "vkCmdSetCullModeEXT");
+    cmdSetFrontFace = (PFN_vkCmdSetFrontFaceEXT)vkGetDeviceProcAddr(device, "vkCmdSetFrontFaceEXT");
+    cmdSetDepthTestEnable = (PFN_vkCmdSetDepthTestEnableEXT)vkGetDeviceProcAddr(device, "vkCmdSetDepthTestEnableEXT");
+    cmdSetDepthWriteEnable = (PFN_vkCmdSetDepthWriteEnableEXT)vkGetDeviceProcAddr(device, "vkCmdSetDepthWriteEnableEXT");
+    cmdSetDepthCompareOp = (PFN_vkCmdSetDepthCompareOpEXT)vkGetDeviceProcAddr(device, "vkCmdSetDepthCompareOpEXT");
+
+    if (cmdSetCullMode == nullptr || cmdSetFrontFace == nullptr || cmdSetDepthTestEnable == nullptr ||
+        cmdSetDepthWriteEnable == nullptr || cmdSetDepthCompareOp == nullptr)
+    {
+        __debugbreak(); // Extension was enabled but the driver doesn't expose its commands
+        extendedDynamicStateEnabled = false;
+    }
+}
+
+bool isExtendedDynamicStateEnabled()
+{
+    return extendedDynamicStateEnabled;
+}
+
+uint32_t getDynamicStates(VkDynamicState* dynamicStates, bool depthStencil)
+{
+    uint32_t count = 0;
+    dynamicStates[count++] = VK_DYNAMIC_STATE_VIEWPORT;
+    dynamicStates[count++] = VK_DYNAMIC_STATE_SCISSOR;
+
+    if (extendedDynamicStateEnabled)
+    {
+        dynamicStates[count++] = VK_DYNAMIC_STATE_CULL_MODE_EXT;
+        dynamicStates[count++] = VK_DYNAMIC_STATE_FRONT_FACE_EXT;
+
+        // Depth state is ignored without a depth stencil state, the validation layers complain about it anyway
+        if (depthStencil)
+        {
+            dynamicStates[count++] = VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT;
+            dynamicStates[count++] = VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT;
+            dynamicStates[count++] = VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT;
+        }
+    }
+
+    return count;
+}
+
+void cmdSetViewportAndScissor(VkCommandBuffer commandBuffer, VkExtent2D extent, float renderScale)
+{
+    VkViewport viewport;
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(extent.width) * renderScale;
+    viewport.height = static_cast<float>(extent.height) * renderScale;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor;
+    scissor.offset.x = 0;
+    scissor.offset.y = 0;
+    scissor.extent.width = static_cast<uint32_t>(viewport.width);
+    scissor.extent.height = static_cast<uint32_t>(viewport.height);
+
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void cmdSetRasterizationState(VkCommandBuffer commandBuffer, VkCullModeFlags cullMode, VkFrontFace frontFace)
+{
+    if (!extendedDynamicStateEnabled)
+    {
+        return;
+    }
+
+    cmdSetCullMode(commandBuffer, cullMode);
+    cmdSetFrontFace(commandBuffer, frontFace);
+}
+
+void cmdSetDepthState(VkCommandBuffer commandBuffer, VkBool32 depthTestEnable, VkBool32 depthWriteEnable, VkCompareOp depthCompareOp)
+{
+    if (!extendedDynamicStateEnabled)
+    {
+        return;
+    }
+
+    cmdSetDepthTestEnable(commandBuffer, depthTestEnable);
+    cmdSetDepthWriteEnable(commandBuffer, depthWriteEnable);
+    cmdSetDepthCompareOp(commandBuffer, depthCompareOp);
+}
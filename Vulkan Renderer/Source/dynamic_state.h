@@ -0,0 +1,57 @@
+// Vulkan Renderer - dynamic_state.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _DYNAMIC_STATE_H_
+#define _DYNAMIC_STATE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "vkdefines.h"
+
+constexpr uint32_t maxDynamicStates = 7;
+
+// Appends VK_EXT_extended_dynamic_state and links its feature struct into featureChain when the
+// physical device supports it. Has to be called before vkCreateDevice, the struct lives in this module.
+void requestExtendedDynamicState(
+    VkPhysicalDevice physicalDevice,
+    const VkExtensionProperties* extensions,
+    uint32_t extensionCount,
+    std::vector<const char*>& enabledExtensions,
+    void*& featureChain
+);
+
+void loadDynamicStateFunctions(VkDevice device);
+
+bool isExtendedDynamicStateEnabled();
+
+// Fills dynamicStates (at least maxDynamicStates entries) with every state pipelines leave dynamic
+uint32_t getDynamicStates(VkDynamicState* dynamicStates, bool depthStencil);
+
+void cmdSetViewportAndScissor(VkCommandBuffer commandBuffer, VkExtent2D extent, float renderScale = 1.0f);
+
+// The following only record anything with extended dynamic state, otherwise the values are baked into the pipeline
+void cmdSetRasterizationState(VkCommandBuffer commandBuffer, VkCullModeFlags cullMode, VkFrontFace frontFace);
+void cmdSetDepthState(VkCommandBuffer commandBuffer, VkBool32 depthTestEnable, VkBool32 depthWriteEnable, VkCompareOp depthCompareOp);
+
+#endif // !_DYNAMIC_STATE_H_
@@ -0,0 +1,81 @@
+// Vulkan Renderer - frame_constants.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <cstring>
+
+#include "descriptor_allocator.h"
+#include "frame_constants.h"
+#include "gpu_buffer.h"
+#include "pipeline_layout_cache.h"
+
+static GpuBuffer                  frameConstantsBuffer;
+static VkDeviceSize               frameConstantsStride = 0;
+static VkDescriptorSetLayout      frameSetLayout = VK_NULL_HANDLE;
+static VkDescriptorUpdateTemplate frameUpdateTemplate = VK_NULL_HANDLE;
+
+void createFrameConstants(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t frameCount)
+{
+    VkPhysicalDeviceProperties physicalDeviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+
+    // The alignment limit is a power of two
+    const VkDeviceSize alignment = physicalDeviceProperties.limits.minUniformBufferOffsetAlignment;
+    frameConstantsStride = (VkDeviceSize(sizeof(FrameConstants)) + alignment - 1) & ~(alignment - 1);
+
+    frameConstantsBuffer = createGpuBuffer(physicalDevice, device, frameConstantsStride * frameCount,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkDescriptorSetLayoutBinding binding;
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    binding.pImmutableSamplers = nullptr;
+
+    frameSetLayout = getDescriptorSetLayout(device, &binding, 1);
+    frameUpdateTemplate = getDescriptorUpdateTemplate(device, frameSetLayout, &binding, 1);
+
+    setReservedDescriptorSetLayout(frameDescriptorSet, frameSetLayout);
+}
+
+VkDescriptorSet updateFrameConstants(VkDevice device, uint32_t frameIndex, const FrameConstants& constants)
+{
+    const VkDeviceSize offset = frameConstantsStride * frameIndex;
+    std::memcpy(static_cast<uint8_t*>(frameConstantsBuffer.mapped) + offset, &constants, sizeof(FrameConstants));
+
+    DescriptorUpdateData data;
+    data.buffer.buffer = frameConstantsBuffer.buffer;
+    data.buffer.offset = offset;
+    data.buffer.range = sizeof(FrameConstants);
+
+    return allocateFrameDescriptorSet(device, frameIndex, frameSetLayout, frameUpdateTemplate, &data);
+}
+
+void destroyFrameConstants(VkDevice device)
+{
+    // The set layout and the template belong to the layout cache and the descriptor allocator
+    setReservedDescriptorSetLayout(frameDescriptorSet, VK_NULL_HANDLE);
+    destroyGpuBuffer(device, frameConstantsBuffer);
+
+    frameSetLayout = VK_NULL_HANDLE;
+    frameUpdateTemplate = VK_NULL_HANDLE;
+}
@@ -0,0 +1,52 @@
+// Vulkan Renderer - frame_constants.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _FRAME_CONSTANTS_H_
+#define _FRAME_CONSTANTS_H_
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "vkdefines.h"
+
+// Reserved in every pipeline layout from the layout cache, next to the bindless set
+constexpr uint32_t frameDescriptorSet = 1;
+
+// Per-frame data, mirrors the FrameConstants block of vertex_shader.vert
+struct FrameConstants
+{
+    glm::mat4 viewProjection;
+};
+
+// One host visible uniform buffer split into a region per frame in flight. Has to be called before
+// the first pipeline layout is created, the set layout is reserved from then on.
+void createFrameConstants(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t frameCount);
+
+// Writes the frame's region and returns a set pointing at it, allocated from the frame's descriptor
+// pools. Call after beginDescriptorFrame, the set is only valid until the frame retires.
+VkDescriptorSet updateFrameConstants(VkDevice device, uint32_t frameIndex, const FrameConstants& constants);
+
+void destroyFrameConstants(VkDevice device);
+
+#endif // !_FRAME_CONSTANTS_H_
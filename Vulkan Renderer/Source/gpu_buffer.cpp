@@ -0,0 +1,253 @@
+// Vulkan Renderer - gpu_buffer.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "deferred_destruction.h"
+#include "gpu_buffer.h"
+#include "host_allocator.h"
+#include "memory_blocks.h"
+
+uint32_t findMemoryType(
+    VkPhysicalDevice physicalDevice,
+    uint32_t memoryTypeBits,
+    VkMemoryPropertyFlags requiredFlags,
+    VkMemoryPropertyFlags preferredFlags)
+{
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    uint32_t fallback = invalidMemoryType;
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+        if ((memoryTypeBits & (1u << i)) == 0 || (flags & requiredFlags) != requiredFlags)
+        {
+            continue;
+        }
+
+        if ((flags & preferredFlags) == preferredFlags)
+        {
+            return i;
+        }
+
+        if (fallback == invalidMemoryType)
+        {
+            fallback = i;
+        }
+    }
+
+    return fallback;
+}
+
+static GpuBuffer createBufferObject(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryRequirements& memoryRequirements)
+{
+    GpuBuffer buffer;
+    buffer.buffer = VK_NULL_HANDLE;
+    buffer.memory = VK_NULL_HANDLE;
+    buffer.size = size;
+    buffer.mapped = nullptr;
+    buffer.usage = usage;
+    buffer.memoryType = invalidMemoryType;
+    buffer.memoryBlock = invalidMemoryBlock;
+    buffer.memoryOffset = 0;
+    buffer.memorySize = 0;
+
+    VkBufferCreateInfo bufferCreateInfo;
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.pNext = nullptr;
+    bufferCreateInfo.flags = 0;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = usage;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 0;
+    bufferCreateInfo.pQueueFamilyIndices = nullptr;
+
+    VkResult result = vkCreateBuffer(device, &bufferCreateInfo, getHostAllocator(VK_OBJECT_TYPE_BUFFER), &buffer.buffer);
+    CHECK_VKRESULT(result);
+
+    vkGetBufferMemoryRequirements(device, buffer.buffer, &memoryRequirements);
+    return buffer;
+}
+
+// Binds a range of a shared block, the block is mapped as a whole if it is host visible.
+// Returns false if the memory type is out of room, the buffer stays unbound then.
+static bool bindBlockMemory(VkDevice device, GpuBuffer& buffer, const VkMemoryRequirements& memoryRequirements, uint32_t memoryType)
+{
+    MemoryAllocation allocation;
+    if (!allocateBlockMemory(device, memoryRequirements, memoryType, allocation))
+    {
+        return false;
+    }
+
+    buffer.memory = allocation.memory;
+    buffer.mapped = allocation.mapped;
+    buffer.memoryType = memoryType;
+    buffer.memoryBlock = allocation.block;
+    buffer.memoryOffset = allocation.offset;
+    buffer.memorySize = allocation.size;
+
+    VkResult result = vkBindBufferMemory(device, buffer.buffer, buffer.memory, buffer.memoryOffset);
+    CHECK_VKRESULT(result);
+    return true;
+}
+
+GpuBuffer createGpuBuffer(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags requiredFlags,
+    VkMemoryPropertyFlags preferredFlags)
+{
+    VkMemoryRequirements memoryRequirements;
+    GpuBuffer buffer = createBufferObject(device, size, usage, memoryRequirements);
+
+    uint32_t memoryType = findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, requiredFlags, preferredFlags);
+    if (memoryType == invalidMemoryType)
+    {
+        __debugbreak(); // No memory type with the required properties
+        return buffer;
+    }
+
+    buffer.memoryType = memoryType;
+    buffer.memorySize = memoryRequirements.size;
+
+    VkMemoryAllocateInfo memoryAllocateInfo;
+    memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memoryAllocateInfo.pNext = nullptr;
+    memoryAllocateInfo.allocationSize = memoryRequirements.size;
+    memoryAllocateInfo.memoryTypeIndex = memoryType;
+
+    VkResult result = vkAllocateMemory(device, &memoryAllocateInfo, getHostAllocator(VK_OBJECT_TYPE_DEVICE_MEMORY), &buffer.memory);
+    CHECK_VKRESULT(result);
+
+    result = vkBindBufferMemory(device, buffer.buffer, buffer.memory, 0);
+    CHECK_VKRESULT(result);
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        result = vkMapMemory(device, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.mapped);
+        CHECK_VKRESULT(result);
+    }
+
+    return buffer;
+}
+
+GpuBuffer createSuballocatedGpuBuffer(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags requiredFlags,
+    VkMemoryPropertyFlags preferredFlags)
+{
+    VkMemoryRequirements memoryRequirements;
+    GpuBuffer buffer = createBufferObject(device, size, usage, memoryRequirements);
+
+    uint32_t memoryType = findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, requiredFlags, preferredFlags);
+    if (memoryType == invalidMemoryType)
+    {
+        __debugbreak(); // No memory type with the required properties
+        return buffer;
+    }
+
+    if (!bindBlockMemory(device, buffer, memoryRequirements, memoryType))
+    {
+        __debugbreak(); // Out of device memory
+    }
+
+    return buffer;
+}
+
+GpuBuffer createSuballocatedGpuBuffer(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t memoryType)
+{
+    VkMemoryRequirements memoryRequirements;
+    GpuBuffer buffer = createBufferObject(device, size, usage, memoryRequirements);
+
+    if ((memoryRequirements.memoryTypeBits & (1u << memoryType)) == 0)
+    {
+        __debugbreak(); // The buffer can't live in this memory type
+        return buffer;
+    }
+
+    if (!bindBlockMemory(device, buffer, memoryRequirements, memoryType))
+    {
+        __debugbreak(); // Out of device memory
+    }
+
+    return buffer;
+}
+
+bool tryCreateSuballocatedGpuBuffer(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t memoryType, GpuBuffer& buffer)
+{
+    VkMemoryRequirements memoryRequirements;
+    buffer = createBufferObject(device, size, usage, memoryRequirements);
+
+    if ((memoryRequirements.memoryTypeBits & (1u << memoryType)) == 0 || !bindBlockMemory(device, buffer, memoryRequirements, memoryType))
+    {
+        // Never bound or used, so it can go right away
+        vkDestroyBuffer(device, buffer.buffer, getHostAllocator(VK_OBJECT_TYPE_BUFFER));
+        buffer.buffer = VK_NULL_HANDLE;
+        return false;
+    }
+
+    return true;
+}
+
+void destroyGpuBuffer(VkDevice device, GpuBuffer& buffer)
+{
+    // Freeing the memory implicitly unmaps it. Block ranges stay reserved until the frames in flight completed,
+    // the renderer only destroys buffers after waiting for the device anyway.
+    vkDestroyBuffer(device, buffer.buffer, getHostAllocator(VK_OBJECT_TYPE_BUFFER));
+
+    if (buffer.memoryBlock != invalidMemoryBlock)
+    {
+        releaseBlockMemory(buffer.memoryBlock, buffer.memoryOffset, buffer.memorySize);
+    }
+    else
+    {
+        vkFreeMemory(device, buffer.memory, getHostAllocator(VK_OBJECT_TYPE_DEVICE_MEMORY));
+    }
+
+    buffer.buffer = VK_NULL_HANDLE;
+    buffer.memory = VK_NULL_HANDLE;
+    buffer.mapped = nullptr;
+}
+
+void releaseGpuBuffer(GpuBuffer& buffer)
+{
+    deferDestruction(VK_OBJECT_TYPE_BUFFER, uint64_t(buffer.buffer));
+
+    if (buffer.memoryBlock != invalidMemoryBlock)
+    {
+        releaseBlockMemory(buffer.memoryBlock, buffer.memoryOffset, buffer.memorySize);
+    }
+    else
+    {
+        deferDestruction(VK_OBJECT_TYPE_DEVICE_MEMORY, uint64_t(buffer.memory));
+    }
+
+    buffer.buffer = VK_NULL_HANDLE;
+    buffer.memory = VK_NULL_HANDLE;
+    buffer.mapped = nullptr;
+}
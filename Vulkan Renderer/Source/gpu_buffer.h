@@ -0,0 +1,89 @@
+// Vulkan Renderer - gpu_buffer.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _GPU_BUFFER_H_
+#define _GPU_BUFFER_H_
+
+#include <cstdint>
+
+#include "memory_blocks.h"
+#include "vkdefines.h"
+
+constexpr uint32_t invalidMemoryType = ~0u;
+
+struct GpuBuffer
+{
+    VkBuffer           buffer;
+    VkDeviceMemory     memory;
+    VkDeviceSize       size;
+    void*              mapped; // Persistently mapped if the memory is host visible, nullptr otherwise
+    VkBufferUsageFlags usage;
+    uint32_t           memoryType;
+    uint32_t           memoryBlock; // invalidMemoryBlock for dedicated allocations
+    VkDeviceSize       memoryOffset;
+    VkDeviceSize       memorySize;
+};
+
+// Picks a type with all required flags, preferring one that also has the preferred flags.
+// Returns invalidMemoryType if no type qualifies.
+uint32_t findMemoryType(
+    VkPhysicalDevice physicalDevice,
+    uint32_t memoryTypeBits,
+    VkMemoryPropertyFlags requiredFlags,
+    VkMemoryPropertyFlags preferredFlags = 0
+);
+
+// One dedicated allocation per buffer, meant for the few large long-lived buffers of the renderer
+GpuBuffer createGpuBuffer(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags requiredFlags,
+    VkMemoryPropertyFlags preferredFlags = 0
+);
+
+// Shares memory blocks with other buffers of the same memory type, meant for the many small and short-lived
+// buffers of streamed assets. The defragmenter moves them if they are pooled.
+GpuBuffer createSuballocatedGpuBuffer(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags requiredFlags,
+    VkMemoryPropertyFlags preferredFlags = 0
+);
+
+GpuBuffer createSuballocatedGpuBuffer(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t memoryType);
+
+// Same as above, but returns false instead of breaking if the memory type has no room left or can't hold the buffer.
+// Nothing is created in that case.
+bool tryCreateSuballocatedGpuBuffer(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t memoryType, GpuBuffer& buffer);
+
+void destroyGpuBuffer(VkDevice device, GpuBuffer& buffer);
+
+// For buffers replaced while rendering, destroys the buffer once the frames that may still read it completed.
+// The mapping stays valid until then, but writing it races the GPU.
+void releaseGpuBuffer(GpuBuffer& buffer);
+
+#endif // !_GPU_BUFFER_H_
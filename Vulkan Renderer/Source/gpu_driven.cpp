@@ -0,0 +1,332 @@
+// Vulkan Renderer - gpu_driven.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "bindless_descriptors.h"
+#include "gpu_buffer.h"
+#include "gpu_driven.h"
+#include "host_allocator.h"
+#include "pipeline_layout_cache.h"
+#include "resource_pools.h"
+
+// Has to match local_size_x of cull_instances.comp
+constexpr uint32_t cullGroupSize = 64;
+constexpr uint32_t maxGpuMeshes = 1024;
+
+static bool             gpuDrivenEnabled = false;
+
+static VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+static PipelineHandle   cullPipeline;
+
+static GpuBuffer        boundsBuffer;
+static GpuBuffer        instanceBuffer;
+static GpuBuffer        meshBuffer;
+static GpuBuffer        indexBuffer;
+static GpuBuffer        drawBuffer;
+static GpuBuffer        countBuffer;
+
+static uint32_t         boundsBufferIndex = invalidBindlessIndex;
+static uint32_t         instanceBufferIndex = invalidBindlessIndex;
+static uint32_t         meshBufferIndex = invalidBindlessIndex;
+static uint32_t         drawBufferIndex = invalidBindlessIndex;
+static uint32_t         countBufferIndex = invalidBindlessIndex;
+
+static uint32_t         instanceCapacity = 0;
+static uint32_t         indexCapacity = 0;
+static uint32_t         instanceCount = 0;
+static uint32_t         meshCount = 0;
+static uint32_t         indexCount = 0;
+
+bool requestGpuDrivenRendering(
+    const VkPhysicalDeviceFeatures& supportedFeatures,
+    const VkPhysicalDeviceVulkan12Features& supportedVulkan12Features,
+    VkPhysicalDeviceFeatures& enabledFeatures,
+    VkPhysicalDeviceVulkan12Features& enabledVulkan12Features)
+{
+    gpuDrivenEnabled = supportedVulkan12Features.drawIndirectCount && supportedFeatures.multiDrawIndirect &&
+        supportedFeatures.drawIndirectFirstInstance;
+
+    if (!gpuDrivenEnabled)
+    {
+        return false;
+    }
+
+    enabledVulkan12Features.drawIndirectCount = VK_TRUE;
+    enabledFeatures.multiDrawIndirect = VK_TRUE;
+    enabledFeatures.drawIndirectFirstInstance = VK_TRUE; // The vertex shader finds its instance through firstInstance
+    return true;
+}
+
+bool isGpuDrivenRenderingEnabled()
+{
+    return gpuDrivenEnabled && isBindlessEnabled();
+}
+
+static GpuBuffer createStorageBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, bool hostVisible, uint32_t& bindlessIndex)
+{
+    // Host visible buffers are written by the CPU and read by the GPU every frame, so prefer memory
+    // that is both where available. To-Do: Upload through a staging buffer once instances get streamed.
+    GpuBuffer buffer;
+    if (hostVisible)
+    {
+        buffer = createGpuBuffer(physicalDevice, device, size, usage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+    else
+    {
+        buffer = createGpuBuffer(physicalDevice, device, size, usage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    bindlessIndex = registerStorageBuffer(buffer.buffer, 0, VK_WHOLE_SIZE);
+    if (bindlessIndex == invalidBindlessIndex)
+    {
+        __debugbreak(); // Bindless storage buffer array is full
+    }
+    return buffer;
+}
+
+void createGpuDrivenRendering(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    VkShaderModule cullShader,
+    const ShaderReflection& cullReflection,
+    uint32_t maxInstances,
+    uint32_t maxIndices)
+{
+    if (!isGpuDrivenRenderingEnabled())
+    {
+        return;
+    }
+
+    VkPhysicalDeviceProperties physicalDeviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+
+    if (maxInstances > physicalDeviceProperties.limits.maxDrawIndirectCount)
+    {
+        __debugbreak(); // One draw per visible instance can exceed what a single indirect call may issue
+        maxInstances = physicalDeviceProperties.limits.maxDrawIndirectCount;
+    }
+
+    instanceCapacity = maxInstances;
+    indexCapacity = maxIndices;
+    instanceCount = 0;
+    meshCount = 0;
+    indexCount = 0;
+
+    boundsBuffer = createStorageBuffer(physicalDevice, device, sizeof(glm::vec4) * maxInstances, 0, true, boundsBufferIndex);
+    instanceBuffer = createStorageBuffer(physicalDevice, device, sizeof(GpuInstance) * maxInstances, 0, true, instanceBufferIndex);
+    meshBuffer = createStorageBuffer(physicalDevice, device, sizeof(GpuMesh) * maxGpuMeshes, 0, true, meshBufferIndex);
+    drawBuffer = createStorageBuffer(physicalDevice, device, sizeof(VkDrawIndexedIndirectCommand) * maxInstances,
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, false, drawBufferIndex);
+    countBuffer = createStorageBuffer(physicalDevice, device, sizeof(uint32_t),
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false, countBufferIndex);
+
+    indexBuffer = createGpuBuffer(physicalDevice, device, sizeof(uint32_t) * maxIndices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    cullPipelineLayout = getPipelineLayout(device, &cullReflection, 1);
+
+    VkPipelineShaderStageCreateInfo shaderStageCreateInfo;
+    shaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStageCreateInfo.pNext = nullptr;
+    shaderStageCreateInfo.flags = 0;
+    shaderStageCreateInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    shaderStageCreateInfo.module = cullShader;
+    shaderStageCreateInfo.pName = "main";
+    shaderStageCreateInfo.pSpecializationInfo = nullptr;
+
+    VkComputePipelineCreateInfo computePipelineCreateInfo;
+    computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    computePipelineCreateInfo.pNext = nullptr;
+    computePipelineCreateInfo.flags = 0;
+    computePipelineCreateInfo.stage = shaderStageCreateInfo;
+    computePipelineCreateInfo.layout = cullPipelineLayout;
+    computePipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+    computePipelineCreateInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, getHostAllocator(VK_OBJECT_TYPE_PIPELINE), &pipeline);
+    CHECK_VKRESULT(result);
+
+    cullPipeline = addPipeline(pipeline, VK_PIPELINE_BIND_POINT_COMPUTE);
+}
+
+uint32_t addGpuMesh(const uint32_t* indices, uint32_t meshIndexCount, int32_t vertexOffset)
+{
+    if (meshCount == maxGpuMeshes || indexCount + meshIndexCount > indexCapacity)
+    {
+        __debugbreak(); // Out of mesh or index space
+        return 0;
+    }
+
+    uint32_t* mappedIndices = static_cast<uint32_t*>(indexBuffer.mapped);
+    for (uint32_t i = 0; i < meshIndexCount; i++)
+    {
+        mappedIndices[indexCount + i] = indices[i];
+    }
+
+    GpuMesh mesh;
+    mesh.indexCount = meshIndexCount;
+    mesh.firstIndex = indexCount;
+    mesh.vertexOffset = vertexOffset;
+    mesh.reserved = 0;
+    static_cast<GpuMesh*>(meshBuffer.mapped)[meshCount] = mesh;
+
+    indexCount += meshIndexCount;
+    return meshCount++;
+}
+
+uint32_t addGpuInstance(const glm::mat4& transform, const glm::vec4& boundingSphere, uint32_t meshIndex, uint32_t materialIndex)
+{
+    if (instanceCount == instanceCapacity)
+    {
+        __debugbreak(); // Raise maxInstances
+        return 0;
+    }
+
+    GpuInstance instance;
+    instance.transform = transform;
+    instance.meshIndex = meshIndex;
+    instance.materialIndex = materialIndex;
+    instance.reserved[0] = 0;
+    instance.reserved[1] = 0;
+
+    static_cast<GpuInstance*>(instanceBuffer.mapped)[instanceCount] = instance;
+    static_cast<glm::vec4*>(boundsBuffer.mapped)[instanceCount] = boundingSphere;
+
+    return instanceCount++;
+}
+
+uint32_t getGpuInstanceCount()
+{
+    return instanceCount;
+}
+
+uint32_t getGpuInstanceBufferIndex()
+{
+    return instanceBufferIndex;
+}
+
+void extractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4* planes)
+{
+    // glm is column major, so row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+    glm::vec4 rows[4];
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    planes[0] = rows[3] + rows[0]; // Left
+    planes[1] = rows[3] - rows[0]; // Right
+    planes[2] = rows[3] + rows[1]; // Top in Vulkan clip space, y points down
+    planes[3] = rows[3] - rows[1]; // Bottom
+    planes[4] = rows[2];           // Near, clip space depth starts at 0
+    planes[5] = rows[3] - rows[2]; // Far
+
+    // Normalized so the distance to a sphere center can be compared against its radius
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+
+void cmdCullInstances(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection)
+{
+    // The previous frame may still read the draws and count through the indirect stage
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+    vkCmdFillBuffer(commandBuffer, countBuffer.buffer, 0, sizeof(uint32_t), 0);
+
+    VkBufferMemoryBarrier countBarrier;
+    countBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    countBarrier.pNext = nullptr;
+    countBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    countBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    countBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    countBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    countBarrier.buffer = countBuffer.buffer;
+    countBarrier.offset = 0;
+    countBarrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &countBarrier, 0, nullptr);
+
+    CullPushConstants constants;
+    extractFrustumPlanes(viewProjection, constants.frustumPlanes);
+    constants.instanceCount = instanceCount;
+    constants.boundsBuffer = boundsBufferIndex;
+    constants.instanceBuffer = instanceBufferIndex;
+    constants.meshBuffer = meshBufferIndex;
+    constants.drawBuffer = drawBufferIndex;
+    constants.countBuffer = countBufferIndex;
+
+    VkDescriptorSet bindlessSet = getBindlessDescriptorSet();
+    vkCmdBindPipeline(commandBuffer, resolvePipelineBindPoint(cullPipeline), resolvePipeline(cullPipeline));
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, bindlessDescriptorSet, 1, &bindlessSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &constants);
+    vkCmdDispatch(commandBuffer, (instanceCount + cullGroupSize - 1) / cullGroupSize, 1, 1);
+
+    VkBufferMemoryBarrier drawBarriers[2];
+    for (VkBufferMemoryBarrier& barrier : drawBarriers)
+    {
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.pNext = nullptr;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+    }
+    drawBarriers[0].buffer = drawBuffer.buffer;
+    drawBarriers[1].buffer = countBuffer.buffer;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 0, nullptr, 2, drawBarriers, 0, nullptr);
+}
+
+void cmdDrawCulledInstances(CommandRecorder& recorder)
+{
+    recordBindIndexBuffer(recorder, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdDrawIndexedIndirectCount(recorder.commandBuffer, drawBuffer.buffer, 0, countBuffer.buffer, 0, instanceCount, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void destroyGpuDrivenRendering(VkDevice device)
+{
+    if (cullPipeline.value == 0)
+    {
+        return;
+    }
+
+    // The pipeline layout belongs to the layout cache, the pipeline goes to the deferred destruction queue
+    releasePipeline(cullPipeline);
+
+    releaseStorageBuffer(boundsBufferIndex);
+    releaseStorageBuffer(instanceBufferIndex);
+    releaseStorageBuffer(meshBufferIndex);
+    releaseStorageBuffer(drawBufferIndex);
+    releaseStorageBuffer(countBufferIndex);
+
+    destroyGpuBuffer(device, boundsBuffer);
+    destroyGpuBuffer(device, instanceBuffer);
+    destroyGpuBuffer(device, meshBuffer);
+    destroyGpuBuffer(device, indexBuffer);
+    destroyGpuBuffer(device, drawBuffer);
+    destroyGpuBuffer(device, countBuffer);
+}
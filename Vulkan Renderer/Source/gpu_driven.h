@@ -0,0 +1,117 @@
+// Vulkan Renderer - gpu_driven.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _GPU_DRIVEN_H_
+#define _GPU_DRIVEN_H_
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "command_recorder.h"
+#include "spirv_reflection.h"
+#include "vkdefines.h"
+
+// GPU-driven path: instances live in storage buffers, cull_instances.comp frustum culls them and
+// writes one indexed indirect draw per visible instance plus the draw count. Recording cost doesn't
+// depend on the instance count. Buffers are reached through the bindless set, so this needs bindless
+// descriptors as well as drawIndirectCount.
+
+// Mirrors Instance in cull_instances.comp and the GPU_DRIVEN path of vertex_shader.vert (std430)
+struct GpuInstance
+{
+    glm::mat4 transform;
+    uint32_t  meshIndex;
+    uint32_t  materialIndex;
+    uint32_t  reserved[2];
+};
+
+struct GpuMesh
+{
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t  vertexOffset;
+    uint32_t reserved;
+};
+
+// Mirrors CullConstants in cull_instances.comp, the last five members are bindless buffer indices
+struct CullPushConstants
+{
+    glm::vec4 frustumPlanes[6];
+    uint32_t  instanceCount;
+    uint32_t  boundsBuffer;
+    uint32_t  instanceBuffer;
+    uint32_t  meshBuffer;
+    uint32_t  drawBuffer;
+    uint32_t  countBuffer;
+};
+
+static_assert(sizeof(GpuInstance) == 80, "GpuInstance has to match the std430 layout of the shaders");
+static_assert(sizeof(CullPushConstants) <= 128, "CullPushConstants exceeds the guaranteed push constant size");
+
+// Enables drawIndirectCount, multiDrawIndirect and drawIndirectFirstInstance, returns false if the
+// device lacks any of them. Bindless descriptors have to be enabled as well for the path to be usable.
+bool requestGpuDrivenRendering(
+    const VkPhysicalDeviceFeatures& supportedFeatures,
+    const VkPhysicalDeviceVulkan12Features& supportedVulkan12Features,
+    VkPhysicalDeviceFeatures& enabledFeatures,
+    VkPhysicalDeviceVulkan12Features& enabledVulkan12Features
+);
+
+bool isGpuDrivenRenderingEnabled();
+
+// Buffers are sized for maxInstances and maxIndices up front
+void createGpuDrivenRendering(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    VkShaderModule cullShader,
+    const ShaderReflection& cullReflection,
+    uint32_t maxInstances,
+    uint32_t maxIndices
+);
+
+// Appends the indices to the shared index buffer, returns the mesh index
+uint32_t addGpuMesh(const uint32_t* indices, uint32_t indexCount, int32_t vertexOffset);
+
+// boundingSphere is in world space, xyz center and w radius. Returns the instance index.
+// Instances are written straight into mapped memory, so only add them while no frame reads the buffers.
+uint32_t addGpuInstance(const glm::mat4& transform, const glm::vec4& boundingSphere, uint32_t meshIndex, uint32_t materialIndex);
+
+uint32_t getGpuInstanceCount();
+
+// Bindless index of the instance buffer, the vertex shader reads transforms from there
+uint32_t getGpuInstanceBufferIndex();
+
+// Plane normals point inwards, for Vulkan clip space with depth in [0, 1]
+void extractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4* planes);
+
+// Has to be recorded outside of a render pass, before cmdDrawCulledInstances
+void cmdCullInstances(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection);
+
+// Pipeline, descriptor sets and push constants have to be bound already
+void cmdDrawCulledInstances(CommandRecorder& recorder);
+
+// Before flushDeferredDestruction, the cull pipeline is released through the pipeline pool
+void destroyGpuDrivenRendering(VkDevice device);
+
+#endif // !_GPU_DRIVEN_H_
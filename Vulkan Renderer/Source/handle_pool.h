@@ -0,0 +1,149 @@
+// Vulkan Renderer - handle_pool.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _HANDLE_POOL_H_
+#define _HANDLE_POOL_H_
+
+#include <cstdint>
+
+// The low bits of a handle are its slot, the high bits the generation of the slot when the handle was handed out.
+// Releasing bumps the generation, so every copy of the old handle stops resolving. Generations wrap after 4095
+// releases of the same slot, a handle that stale resolves again.
+constexpr uint32_t handleSlotBits = 20;
+constexpr uint32_t handleSlotMask = (1u << handleSlotBits) - 1;
+constexpr uint32_t handleGenerationMask = (1u << (32 - handleSlotBits)) - 1;
+constexpr uint32_t invalidDenseIndex = ~0u;
+
+// The tag only makes handles of different pools distinct types. 0 is never valid, generations start at 1.
+template<typename Tag>
+struct ResourceHandle
+{
+    uint32_t value;
+};
+
+template<typename Tag>
+bool operator==(ResourceHandle<Tag> a, ResourceHandle<Tag> b)
+{
+    return a.value == b.value;
+}
+
+template<typename Tag>
+bool operator!=(ResourceHandle<Tag> a, ResourceHandle<Tag> b)
+{
+    return a.value != b.value;
+}
+
+// Maps handles to positions in dense arrays the owner of the pool keeps next to it, one array per field. The
+// live entries always occupy the first count positions, releasing moves the last one into the gap.
+template<uint32_t Capacity>
+struct HandlePool
+{
+    static_assert(Capacity <= handleSlotMask + 1, "HandlePool capacity exceeds the slot bits of a handle");
+
+    uint32_t generations[Capacity];  // Per slot
+    uint32_t denseIndices[Capacity]; // Slot to dense position
+    uint32_t slots[Capacity];        // Dense position to slot
+    uint32_t freeSlots[Capacity];
+    uint32_t freeSlotCount = 0;
+    uint32_t slotCount = 0;          // Slots handed out at least once
+    uint32_t count = 0;              // Live handles
+};
+
+// Returns the dense position to fill in, or invalidDenseIndex if the pool is full
+template<typename Tag, uint32_t Capacity>
+uint32_t allocateHandle(HandlePool<Capacity>& pool, ResourceHandle<Tag>& handle)
+{
+    uint32_t slot;
+    if (pool.freeSlotCount != 0)
+    {
+        slot = pool.freeSlots[--pool.freeSlotCount];
+    }
+    else if (pool.slotCount < Capacity)
+    {
+        slot = pool.slotCount++;
+        pool.generations[slot] = 1;
+    }
+    else
+    {
+        handle.value = 0;
+        return invalidDenseIndex;
+    }
+
+    uint32_t denseIndex = pool.count++;
+    pool.denseIndices[slot] = denseIndex;
+    pool.slots[denseIndex] = slot;
+
+    handle.value = (pool.generations[slot] << handleSlotBits) | slot;
+    return denseIndex;
+}
+
+// Returns invalidDenseIndex for released and null handles
+template<typename Tag, uint32_t Capacity>
+uint32_t findDenseIndex(const HandlePool<Capacity>& pool, ResourceHandle<Tag> handle)
+{
+    uint32_t slot = handle.value & handleSlotMask;
+    uint32_t generation = handle.value >> handleSlotBits;
+
+    if (handle.value == 0 || slot >= pool.slotCount || pool.generations[slot] != generation)
+    {
+        return invalidDenseIndex;
+    }
+
+    return pool.denseIndices[slot];
+}
+
+// The handle of the entry at a dense position, for walks over the dense arrays
+template<typename Tag, uint32_t Capacity>
+void getHandle(const HandlePool<Capacity>& pool, uint32_t denseIndex, ResourceHandle<Tag>& handle)
+{
+    uint32_t slot = pool.slots[denseIndex];
+    handle.value = (pool.generations[slot] << handleSlotBits) | slot;
+}
+
+// Returns the dense position the handle occupied, the caller moves the entry at movedFrom there.
+// movedFrom equals the returned position if the released entry was the last one. Returns invalidDenseIndex
+// for stale handles and leaves the pool untouched.
+template<typename Tag, uint32_t Capacity>
+uint32_t releaseHandle(HandlePool<Capacity>& pool, ResourceHandle<Tag> handle, uint32_t& movedFrom)
+{
+    uint32_t denseIndex = findDenseIndex(pool, handle);
+    if (denseIndex == invalidDenseIndex)
+    {
+        return invalidDenseIndex;
+    }
+
+    uint32_t slot = handle.value & handleSlotMask;
+
+    movedFrom = --pool.count;
+    uint32_t movedSlot = pool.slots[movedFrom];
+    pool.slots[denseIndex] = movedSlot;
+    pool.denseIndices[movedSlot] = denseIndex;
+
+    uint32_t generation = (pool.generations[slot] + 1) & handleGenerationMask;
+    pool.generations[slot] = generation == 0 ? 1 : generation;
+    pool.freeSlots[pool.freeSlotCount++] = slot;
+
+    return denseIndex;
+}
+
+#endif // !_HANDLE_POOL_H_
@@ -0,0 +1,449 @@
+// Vulkan Renderer - host_allocator.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+#include "host_allocator.h"
+
+// Sits right in front of every allocation, the block starts offset bytes before the pointer handed out
+struct HostAllocationHeader
+{
+    uint64_t size;
+    uint32_t offset;
+    uint8_t  sizeClass; // hostSizeClassCount for blocks from the global heap
+    uint8_t  scope;
+    uint8_t  objectTypeIndex;
+    uint8_t  reserved;
+};
+
+constexpr size_t hostHeaderSize = sizeof(HostAllocationHeader);
+static_assert(hostHeaderSize == 16, "Blocks are 16 byte aligned, the header has to keep them that way");
+
+struct HostFreeBlock
+{
+    HostFreeBlock* next;
+};
+
+struct HostPool
+{
+    std::mutex     mutex;
+    HostFreeBlock* freeBlocks = nullptr;
+};
+
+struct HostThreadCache
+{
+    HostFreeBlock* freeBlocks[hostSizeClassCount] = {};
+    uint32_t       freeBlockCounts[hostSizeClassCount] = {};
+
+    ~HostThreadCache();
+};
+
+struct HostCounters
+{
+    std::atomic<int64_t>  liveBytes{ 0 };
+    std::atomic<int64_t>  liveAllocations{ 0 };
+    std::atomic<uint64_t> totalAllocations{ 0 };
+    std::atomic<int64_t>  internalBytes{ 0 };
+};
+
+// Chunks are never returned to the system, the driver reaches its high-water mark early and stays there
+static HostPool pools[hostSizeClassCount];
+static thread_local HostThreadCache threadCache;
+
+static HostCounters counters[hostObjectTypeCount][hostScopeCount];
+static bool hostAllocatorEnabled = true;
+
+static size_t getBlockSize(uint32_t sizeClass)
+{
+    return hostMinBlockSize << sizeClass;
+}
+
+static uint32_t getSizeClass(size_t blockSize)
+{
+    uint32_t sizeClass = 0;
+    while (sizeClass < hostSizeClassCount && getBlockSize(sizeClass) < blockSize)
+    {
+        sizeClass++;
+    }
+    return sizeClass;
+}
+
+// Small classes cache many blocks, the largest ones still a few so a create/destroy pair never hits the lock
+static uint32_t getThreadCacheLimit(uint32_t sizeClass)
+{
+    return uint32_t(std::max<size_t>(4, hostThreadCacheSize / getBlockSize(sizeClass)));
+}
+
+static uint32_t getObjectTypeIndex(VkObjectType objectType)
+{
+    if (uint32_t(objectType) <= VK_OBJECT_TYPE_COMMAND_POOL)
+    {
+        return uint32_t(objectType);
+    }
+
+    switch (objectType)
+    {
+    case VK_OBJECT_TYPE_SURFACE_KHR:
+        return VK_OBJECT_TYPE_COMMAND_POOL + 1;
+    case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+        return VK_OBJECT_TYPE_COMMAND_POOL + 2;
+    case VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE:
+        return VK_OBJECT_TYPE_COMMAND_POOL + 3;
+    default:
+        return VK_OBJECT_TYPE_UNKNOWN;
+    }
+}
+
+static const char* getObjectTypeName(uint32_t objectTypeIndex)
+{
+    static const char* names[hostObjectTypeCount] =
+    {
+        "unknown", "instance", "physical device", "device", "queue", "semaphore", "command buffer", "fence",
+        "device memory", "buffer", "image", "event", "query pool", "buffer view", "image view", "shader module",
+        "pipeline cache", "pipeline layout", "render pass", "pipeline", "descriptor set layout", "sampler",
+        "descriptor pool", "descriptor set", "framebuffer", "command pool", "surface", "swapchain",
+        "descriptor update template"
+    };
+    return names[objectTypeIndex];
+}
+
+static const char* getScopeName(uint32_t scope)
+{
+    static const char* names[hostScopeCount] = { "command", "object", "cache", "device", "instance" };
+    return names[scope];
+}
+
+// Moves up to half a cache worth of blocks into the thread cache, carving a new chunk if the pool ran dry
+static void refillThreadCache(uint32_t sizeClass)
+{
+    HostPool& pool = pools[sizeClass];
+    const size_t blockSize = getBlockSize(sizeClass);
+    const uint32_t batchSize = getThreadCacheLimit(sizeClass) / 2;
+
+    std::lock_guard<std::mutex> lock(pool.mutex);
+
+    if (pool.freeBlocks == nullptr)
+    {
+        char* chunk = (char*)std::malloc(hostChunkSize);
+        if (chunk == nullptr)
+        {
+            return;
+        }
+
+        for (size_t offset = hostChunkSize; offset >= blockSize; offset -= blockSize)
+        {
+            HostFreeBlock* block = (HostFreeBlock*)(chunk + offset - blockSize);
+            block->next = pool.freeBlocks;
+            pool.freeBlocks = block;
+        }
+    }
+
+    for (uint32_t i = 0; i < batchSize && pool.freeBlocks != nullptr; i++)
+    {
+        HostFreeBlock* block = pool.freeBlocks;
+        pool.freeBlocks = block->next;
+
+        block->next = threadCache.freeBlocks[sizeClass];
+        threadCache.freeBlocks[sizeClass] = block;
+        threadCache.freeBlockCounts[sizeClass]++;
+    }
+}
+
+static void flushThreadCache(HostThreadCache& cache, uint32_t sizeClass, uint32_t keepCount)
+{
+    if (cache.freeBlockCounts[sizeClass] <= keepCount)
+    {
+        return;
+    }
+
+    // Detaches everything past the first keepCount blocks in one piece
+    HostFreeBlock* first = cache.freeBlocks[sizeClass];
+    HostFreeBlock* kept = nullptr;
+    for (uint32_t i = 0; i < keepCount; i++)
+    {
+        kept = first;
+        first = first->next;
+    }
+
+    HostFreeBlock* last = first;
+    while (last->next != nullptr)
+    {
+        last = last->next;
+    }
+
+    if (kept != nullptr)
+    {
+        kept->next = nullptr;
+    }
+    else
+    {
+        cache.freeBlocks[sizeClass] = nullptr;
+    }
+    cache.freeBlockCounts[sizeClass] = keepCount;
+
+    HostPool& pool = pools[sizeClass];
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    last->next = pool.freeBlocks;
+    pool.freeBlocks = first;
+}
+
+HostThreadCache::~HostThreadCache()
+{
+    for (uint32_t sizeClass = 0; sizeClass < hostSizeClassCount; sizeClass++)
+    {
+        flushThreadCache(*this, sizeClass, 0);
+    }
+}
+
+static char* allocateBlock(uint32_t sizeClass, size_t blockSize)
+{
+    if (sizeClass == hostSizeClassCount)
+    {
+        return (char*)std::malloc(blockSize);
+    }
+
+    if (threadCache.freeBlocks[sizeClass] == nullptr)
+    {
+        refillThreadCache(sizeClass);
+        if (threadCache.freeBlocks[sizeClass] == nullptr)
+        {
+            return nullptr;
+        }
+    }
+
+    HostFreeBlock* block = threadCache.freeBlocks[sizeClass];
+    threadCache.freeBlocks[sizeClass] = block->next;
+    threadCache.freeBlockCounts[sizeClass]--;
+    return (char*)block;
+}
+
+static void releaseBlock(uint32_t sizeClass, char* block)
+{
+    if (sizeClass == hostSizeClassCount)
+    {
+        std::free(block);
+        return;
+    }
+
+    // Blocks freed on another thread than they were allocated on simply move over to this thread's cache
+    HostFreeBlock* freeBlock = (HostFreeBlock*)block;
+    freeBlock->next = threadCache.freeBlocks[sizeClass];
+    threadCache.freeBlocks[sizeClass] = freeBlock;
+    threadCache.freeBlockCounts[sizeClass]++;
+
+    const uint32_t limit = getThreadCacheLimit(sizeClass);
+    if (threadCache.freeBlockCounts[sizeClass] > limit)
+    {
+        flushThreadCache(threadCache, sizeClass, limit / 2);
+    }
+}
+
+static HostAllocationHeader* getHeader(void* memory)
+{
+    return (HostAllocationHeader*)memory - 1;
+}
+
+static void countAllocation(const HostAllocationHeader& header)
+{
+    HostCounters& counter = counters[header.objectTypeIndex][header.scope];
+    counter.liveBytes.fetch_add(int64_t(header.size), std::memory_order_relaxed);
+    counter.liveAllocations.fetch_add(1, std::memory_order_relaxed);
+    counter.totalAllocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void countFree(const HostAllocationHeader& header)
+{
+    HostCounters& counter = counters[header.objectTypeIndex][header.scope];
+    counter.liveBytes.fetch_sub(int64_t(header.size), std::memory_order_relaxed);
+    counter.liveAllocations.fetch_sub(1, std::memory_order_relaxed);
+}
+
+static void* VKAPI_PTR allocateHostMemory(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    // Blocks are 16 byte aligned, stricter alignments pad the front of the block
+    const size_t padding = alignment > hostHeaderSize ? alignment - hostHeaderSize : 0;
+    const size_t blockSize = size + hostHeaderSize + padding;
+    const uint32_t sizeClass = getSizeClass(blockSize);
+
+    char* block = allocateBlock(sizeClass, blockSize);
+    if (block == nullptr)
+    {
+        return nullptr;
+    }
+
+    uintptr_t memory = uintptr_t(block) + hostHeaderSize;
+    if (alignment > hostHeaderSize)
+    {
+        memory = (memory + alignment - 1) & ~uintptr_t(alignment - 1);
+    }
+
+    HostAllocationHeader* header = getHeader((void*)memory);
+    header->size = size;
+    header->offset = uint32_t(memory - uintptr_t(block));
+    header->sizeClass = uint8_t(sizeClass);
+    header->scope = uint8_t(scope);
+    header->objectTypeIndex = uint8_t(uintptr_t(userData));
+    header->reserved = 0;
+
+    countAllocation(*header);
+    return (void*)memory;
+}
+
+static void VKAPI_PTR freeHostMemory(void*, void* memory)
+{
+    if (memory == nullptr)
+    {
+        return;
+    }
+
+    HostAllocationHeader* header = getHeader(memory);
+    countFree(*header);
+    releaseBlock(header->sizeClass, (char*)memory - header->offset);
+}
+
+static void* VKAPI_PTR reallocateHostMemory(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    if (original == nullptr)
+    {
+        return allocateHostMemory(userData, size, alignment, scope);
+    }
+
+    if (size == 0)
+    {
+        freeHostMemory(userData, original);
+        return nullptr;
+    }
+
+    // The alignment has to match the original one, so a block with enough room after the pointer can stay
+    HostAllocationHeader* header = getHeader(original);
+    if (header->sizeClass < hostSizeClassCount && header->offset + size <= getBlockSize(header->sizeClass))
+    {
+        countFree(*header);
+        header->size = size;
+        header->scope = uint8_t(scope);
+        countAllocation(*header);
+        return original;
+    }
+
+    void* memory = allocateHostMemory(userData, size, alignment, scope);
+    if (memory == nullptr)
+    {
+        return nullptr;
+    }
+
+    std::memcpy(memory, original, std::min<size_t>(size, header->size));
+    freeHostMemory(userData, original);
+    return memory;
+}
+
+static void VKAPI_PTR notifyInternalAllocation(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+{
+    counters[uintptr_t(userData)][scope].internalBytes.fetch_add(int64_t(size), std::memory_order_relaxed);
+}
+
+static void VKAPI_PTR notifyInternalFree(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+{
+    counters[uintptr_t(userData)][scope].internalBytes.fetch_sub(int64_t(size), std::memory_order_relaxed);
+}
+
+struct HostAllocatorCallbacks
+{
+    VkAllocationCallbacks callbacks[hostObjectTypeCount];
+
+    HostAllocatorCallbacks()
+    {
+        for (uint32_t i = 0; i < hostObjectTypeCount; i++)
+        {
+            callbacks[i].pUserData = (void*)uintptr_t(i);
+            callbacks[i].pfnAllocation = allocateHostMemory;
+            callbacks[i].pfnReallocation = reallocateHostMemory;
+            callbacks[i].pfnFree = freeHostMemory;
+            callbacks[i].pfnInternalAllocation = notifyInternalAllocation;
+            callbacks[i].pfnInternalFree = notifyInternalFree;
+        }
+    }
+};
+
+static const HostAllocatorCallbacks hostAllocatorCallbacks;
+
+void setHostAllocatorEnabled(bool enabled)
+{
+    hostAllocatorEnabled = enabled;
+}
+
+const VkAllocationCallbacks* getHostAllocator(VkObjectType objectType)
+{
+    if (!hostAllocatorEnabled)
+    {
+        return nullptr;
+    }
+
+    return &hostAllocatorCallbacks.callbacks[getObjectTypeIndex(objectType)];
+}
+
+HostAllocationStats getHostAllocationStats(VkObjectType objectType, VkSystemAllocationScope scope)
+{
+    const HostCounters& counter = counters[getObjectTypeIndex(objectType)][scope];
+
+    HostAllocationStats stats;
+    stats.liveBytes = uint64_t(counter.liveBytes.load(std::memory_order_relaxed));
+    stats.liveAllocations = uint64_t(counter.liveAllocations.load(std::memory_order_relaxed));
+    stats.totalAllocations = counter.totalAllocations.load(std::memory_order_relaxed);
+    stats.internalBytes = uint64_t(counter.internalBytes.load(std::memory_order_relaxed));
+    return stats;
+}
+
+void printHostAllocationStats()
+{
+    const std::ios_base::fmtflags flags = std::cout.flags();
+
+    std::cout << std::left << std::setw(28) << "Object type" << ' ' << std::setw(9) << "Scope" << std::right
+              << ' ' << std::setw(12) << "Live (B)" << ' ' << std::setw(12) << "Live" << ' ' << std::setw(12) << "Total"
+              << ' ' << std::setw(14) << "Internal (B)" << '\n';
+
+    for (uint32_t type = 0; type < hostObjectTypeCount; type++)
+    {
+        for (uint32_t scope = 0; scope < hostScopeCount; scope++)
+        {
+            const HostCounters& counter = counters[type][scope];
+
+            const uint64_t totalAllocations = counter.totalAllocations.load(std::memory_order_relaxed);
+            const int64_t internalBytes = counter.internalBytes.load(std::memory_order_relaxed);
+            if (totalAllocations == 0 && internalBytes == 0)
+            {
+                continue;
+            }
+
+            std::cout << std::left << std::setw(28) << getObjectTypeName(type) << ' ' << std::setw(9) << getScopeName(scope) << std::right
+                      << ' ' << std::setw(12) << counter.liveBytes.load(std::memory_order_relaxed)
+                      << ' ' << std::setw(12) << counter.liveAllocations.load(std::memory_order_relaxed)
+                      << ' ' << std::setw(12) << totalAllocations << ' ' << std::setw(14) << internalBytes << '\n';
+        }
+    }
+
+    std::cout.flags(flags);
+}
@@ -0,0 +1,64 @@
+// Vulkan Renderer - host_allocator.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _HOST_ALLOCATOR_H_
+#define _HOST_ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vkdefines.h"
+
+// Blocks of 32 B up to 32 KiB including the allocation header, larger requests go to the global heap
+constexpr uint32_t hostSizeClassCount = 11;
+constexpr size_t   hostMinBlockSize = 32;
+
+// Every thread keeps about this many bytes of free blocks per size class before handing them back
+constexpr size_t   hostThreadCacheSize = 64 * 1024;
+constexpr size_t   hostChunkSize = 256 * 1024;
+
+// Object types with counters of their own, every other type is counted as VK_OBJECT_TYPE_UNKNOWN
+constexpr uint32_t hostObjectTypeCount = VK_OBJECT_TYPE_COMMAND_POOL + 4;
+constexpr uint32_t hostScopeCount = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+struct HostAllocationStats
+{
+    uint64_t liveBytes;
+    uint64_t liveAllocations;
+    uint64_t totalAllocations; // Including the freed ones, the churn since startup
+    uint64_t internalBytes;    // Driver allocations it only notifies us about, executable memory for example
+};
+
+// Must not change after the instance was created, the driver frees with the callbacks it allocated with
+void setHostAllocatorEnabled(bool enabled);
+
+// Pass to every vkCreate* and the matching vkDestroy* of that object type. The callbacks carry the object type,
+// so the statistics can tell a pipeline's host memory from a command pool's. Returns nullptr when disabled.
+const VkAllocationCallbacks* getHostAllocator(VkObjectType objectType);
+
+HostAllocationStats getHostAllocationStats(VkObjectType objectType, VkSystemAllocationScope scope);
+
+// One row per object type and scope that allocated anything
+void printHostAllocationStats();
+
+#endif // !_HOST_ALLOCATOR_H_
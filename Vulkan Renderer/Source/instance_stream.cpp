@@ -0,0 +1,81 @@
+// Vulkan Renderer - instance_stream.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <vector>
+
+#include "gpu_buffer.h"
+#include "instance_stream.h"
+
+static GpuBuffer             instanceBuffer;
+static uint32_t              instancesPerFrame = 0;
+static std::vector<uint32_t> frameInstanceCounts;
+
+void createInstanceStream(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t frameCount, uint32_t maxInstancesPerFrame)
+{
+    instancesPerFrame = maxInstancesPerFrame;
+    frameInstanceCounts.assign(frameCount, 0);
+
+    // Written once and read once per frame, so device local host visible memory is best where it exists
+    instanceBuffer = createGpuBuffer(physicalDevice, device, VkDeviceSize(sizeof(InstanceData)) * maxInstancesPerFrame * frameCount,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void beginInstanceFrame(uint32_t frameIndex)
+{
+    frameInstanceCounts[frameIndex] = 0;
+}
+
+InstanceData* allocateInstances(uint32_t frameIndex, uint32_t count, uint32_t& firstInstance)
+{
+    uint32_t& frameInstanceCount = frameInstanceCounts[frameIndex];
+    if (frameInstanceCount + count > instancesPerFrame)
+    {
+        return nullptr;
+    }
+
+    firstInstance = frameInstanceCount;
+    frameInstanceCount += count;
+
+    InstanceData* frameInstances = static_cast<InstanceData*>(instanceBuffer.mapped) + size_t(frameIndex) * instancesPerFrame;
+    return frameInstances + firstInstance;
+}
+
+VkBuffer getInstanceBuffer()
+{
+    return instanceBuffer.buffer;
+}
+
+VkDeviceSize getInstanceBufferOffset(uint32_t frameIndex)
+{
+    return VkDeviceSize(sizeof(InstanceData)) * instancesPerFrame * frameIndex;
+}
+
+uint32_t getStreamedInstanceCount(uint32_t frameIndex)
+{
+    return frameInstanceCounts[frameIndex];
+}
+
+void destroyInstanceStream(VkDevice device)
+{
+    destroyGpuBuffer(device, instanceBuffer);
+    frameInstanceCounts.clear();
+}
@@ -0,0 +1,61 @@
+// Vulkan Renderer - instance_stream.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _INSTANCE_STREAM_H_
+#define _INSTANCE_STREAM_H_
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "vkdefines.h"
+
+// Per-instance vertex inputs of vertex_shader.vert, tightly packed in location order the way
+// getVertexInputDescription lays out the instance binding
+struct InstanceData
+{
+    glm::mat4 transform;
+};
+
+static_assert(sizeof(InstanceData) == 64, "InstanceData has to match the packed instance binding of the vertex shader");
+
+// One host visible buffer split into a region per frame in flight. Instances are written every frame
+// while recording, the region of a frame is only reused once its fence signalled.
+void createInstanceStream(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t frameCount, uint32_t maxInstancesPerFrame);
+
+void beginInstanceFrame(uint32_t frameIndex);
+
+// Returns mapped memory for count instances and their index relative to the frame's region,
+// nullptr if the region is full
+InstanceData* allocateInstances(uint32_t frameIndex, uint32_t count, uint32_t& firstInstance);
+
+VkBuffer getInstanceBuffer();
+
+// Bind the buffer at this offset, firstInstance of the draws is relative to it
+VkDeviceSize getInstanceBufferOffset(uint32_t frameIndex);
+
+uint32_t getStreamedInstanceCount(uint32_t frameIndex);
+
+void destroyInstanceStream(VkDevice device);
+
+#endif // !_INSTANCE_STREAM_H_
@@ -19,21 +19,80 @@
 // WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
 // SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
+#include <algorithm>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <limits>
 #include <thread>
 #include <vector>
 
-#include "windefines.h"
+#include "bindless_descriptors.h"
+#include "command_recorder.h"
+#include "deferred_destruction.h"
+#include "defragmenter.h"
+#include "depth_buffer.h"
+#include "descriptor_allocator.h"
+#include "device_dispatch.h"
+#include "draw_queue.h"
+#include "dynamic_state.h"
+#include "frame_constants.h"
+#include "gpu_buffer.h"
+#include "gpu_driven.h"
+#include "host_allocator.h"
+#include "instance_stream.h"
+#include "memory_blocks.h"
+#include "pipeline_layout_cache.h"
+#include "pipeline_library.h"
+#include "pipeline_state_cache.h"
+#include "present_policy.h"
 #include "print_device_info.h"
+#include "push_constants.h"
+#include "residency.h"
+#include "resource_pools.h"
+#include "shader_bundle.h"
+#include "shader_variant.h"
+#include "spirv_reflection.h"
 #include "utility.h"
 #include "vkdefines.h"
+#include "window.h"
+#include "window_events.h"
 
+#ifdef _MSC_VER
 #pragma comment(lib, "vulkan-1.lib")
+#endif
+
+constexpr uint32_t initialWindowWidth = 800;
+constexpr uint32_t initialWindowHeight = 600;
+
+constexpr uint32_t maxFramesInFlight = 2;
+
+// Specialization constant IDs of fragment_shader.frag
+constexpr uint32_t encodeSrgbConstantId = 0;
+
+constexpr uint32_t opaqueLayer = 0;
+
+constexpr uint32_t maxGpuInstances = 262144;
+constexpr uint32_t maxGpuIndices = 1048576;
+constexpr uint32_t maxInstancesPerFrame = 65536;
 
-constexpr uint32_t windowWidth = 800;
-constexpr uint32_t windowHeight = 600;
+// A pass only starts if there are sparse blocks and spreads its copies over as many frames as it needs
+constexpr uint64_t defragmentationInterval = 1024;
+constexpr std::chrono::microseconds defragmentationBudget(250);
+
+struct SceneDraw
+{
+    const PipelineCacheEntry* pipeline; // Loaded while recording, the background compiler may swap in an optimized pipeline
+    const PipelineCacheEntry* depthPipeline; // Used by the depth prepass
+    uint32_t   pipelineId; // Sort id of the pipeline, not the handle
+    uint32_t   layer;
+    uint32_t   meshId;
+    uint32_t   vertexCount;
+    uint32_t   materialIndex;
+    float      depth;
+    glm::mat4  transform;
+};
 
 VkInstance         instance;
 uint32_t           physicalDeviceCount;
@@ -41,29 +100,89 @@ VkPhysicalDevice*  physicalDevices;
 VkDevice           device;
 VkQueue            queue;
                    
-HINSTANCE          windowClass;
-HWND               windowHandle;
-const TCHAR*       windowClassName = TEXT("Vulkan Renderer Window");
-const TCHAR*       windowTitle = TEXT("Vulkan Renderer Window");
+const char*        windowTitle = "Vulkan Renderer Window";
+PresentProfile     presentProfile = PresentProfileLowestLatency;
+
+// Written by the window backend on the main thread, everything else in here belongs to the render thread
+WindowEventQueue   windowEvents;
+uint32_t           windowWidth = initialWindowWidth;
+uint32_t           windowHeight = initialWindowHeight;
+bool               windowMinimized = false;
+bool               keysDown[maxKeyCode];
+int32_t            mouseX = 0;
+int32_t            mouseY = 0;
                    
 VkSurfaceKHR       surface;
-VkSwapchainKHR     swapchain;
+VkSwapchainKHR     swapchain = VK_NULL_HANDLE;
+VkExtent2D         swapchainExtent;
+SwapchainConfiguration swapchainConfiguration;
 uint32_t           imageViewCount;
 VkImageView*       imageViews;
 VkFramebuffer*     framebuffers;
+VkFormat           depthFormat;
+ImageHandle        depthImage;
+bool               swapchainOutdated = false;
                    
 VkShaderModule     vertexShader;
 VkShaderModule     fragmentShader;
+ShaderReflection   vertexShaderReflection;
+ShaderReflection   fragmentShaderReflection;
+
+VkShaderModule     depthVertexShader = VK_NULL_HANDLE;
+VkShaderModule     gpuDrivenDepthVertexShader = VK_NULL_HANDLE;
+ShaderReflection   depthVertexShaderReflection;
+ShaderReflection   gpuDrivenDepthVertexShaderReflection;
+
+VkShaderModule     gpuDrivenVertexShader = VK_NULL_HANDLE;
+VkShaderModule     cullShader = VK_NULL_HANDLE;
+ShaderReflection   gpuDrivenVertexShaderReflection;
+ShaderReflection   cullShaderReflection;
                    
 VkPipelineLayout   pipelineLayout;
-VkPipeline         pipeline;
+VkShaderStageFlags pushConstantStages;
+const PipelineCacheEntry* pipeline;
+const PipelineCacheEntry* gpuDrivenPipeline = nullptr;
+VkPipelineLayout   gpuDrivenPipelineLayout;
+const PipelineCacheEntry* depthPipeline = nullptr;
+const PipelineCacheEntry* gpuDrivenDepthPipeline = nullptr;
 VkRenderPass       renderPass;
+PipelineStateDescription pipelineState;
+PipelineStateDescription depthPipelineState;
+
+// Lays down the depth of the scene in a subpass of its own so the color pass only shades the visible fragment
+// of every pixel. Pays off once fragment shading costs more than transforming the geometry a second time.
+// Has to be set before createPipeline, it changes the layout of the render pass.
+bool               depthPrepassEnabled = true;
+uint32_t           colorSubpass = 0;
+
+BufferHandle       trianglePositions;
+BufferHandle       triangleColors;
+
+float              renderScale = 1.0f;
+glm::mat4          viewProjection = glm::mat4(1.0f);
+
+std::vector<SceneDraw> sceneDraws;
+DrawQueue          drawQueue;
+std::vector<DrawBatch> drawBatches;
+std::vector<uint32_t>  batchFirstInstances;
                    
-VkCommandPool      commandPool;
-VkCommandBuffer*   commandBuffers;
+VkCommandPool      commandPools[maxFramesInFlight];
+VkCommandBuffer    commandBuffers[maxFramesInFlight];
+CommandStats       commandStats; // Totals over all recorded frames
                    
-VkSemaphore        imageAvailable;
-VkSemaphore        renderingComplete;
+VkSemaphore        imageAvailable[maxFramesInFlight];
+VkSemaphore        renderingComplete[maxFramesInFlight];
+VkFence            frameFences[maxFramesInFlight];
+uint32_t           frameIndex = 0;
+uint64_t           frameCount = 0; // Frames submitted so far
+
+// The render thread stops after this many frames and prints the average frame time, 0 draws until the window
+// closes. Headless builds have no window that could close. Set with --frames.
+#ifdef WINDOW_BACKEND_HEADLESS
+uint64_t           frameLimit = 2000;
+#else
+uint64_t           frameLimit = 0;
+#endif
 
 void createGraphics()
 {
@@ -90,8 +209,7 @@ void createGraphics()
 #endif
 
     std::vector<const char*> enabledExtensionNames;
-    enabledExtensionNames.push_back("VK_KHR_surface");
-    enabledExtensionNames.push_back("VK_KHR_win32_surface");
+    getWindowInstanceExtensions(enabledExtensionNames);
 
     uint32_t extensionPropertyCount = 0;
     result = vkEnumerateInstanceExtensionProperties(nullptr, &extensionPropertyCount, nullptr);
@@ -111,7 +229,7 @@ void createGraphics()
     instanceCreateInfo.enabledExtensionCount = uint32_t(enabledExtensionNames.size());
     instanceCreateInfo.ppEnabledExtensionNames = enabledExtensionNames.data();
 
-    result = vkCreateInstance(&instanceCreateInfo, nullptr, &instance);
+    result = vkCreateInstance(&instanceCreateInfo, getHostAllocator(VK_OBJECT_TYPE_INSTANCE), &instance);
     CHECK_VKRESULT(result);
 
     result = vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, nullptr);
@@ -139,11 +257,43 @@ void createGraphics()
 
     VkPhysicalDeviceFeatures enabledDeviceFeatures = {};
 
+    uint32_t deviceExtensionCount = 0;
+    result = vkEnumerateDeviceExtensionProperties(physicalDevices[0], nullptr, &deviceExtensionCount, nullptr);
+    CHECK_VKRESULT(result);
+
+    VkExtensionProperties* deviceExtensionProperties = new VkExtensionProperties[deviceExtensionCount];
+    result = vkEnumerateDeviceExtensionProperties(physicalDevices[0], nullptr, &deviceExtensionCount, deviceExtensionProperties);
+    CHECK_VKRESULT(result);
+
     std::vector<const char*> deviceExtensions = { "VK_KHR_swapchain" };
 
+    // Optional extensions link their feature structs in here
+    void* deviceFeatureChain = nullptr;
+
+    VkPhysicalDeviceVulkan12Features supportedVulkan12Features = {};
+    supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    supportedVulkan12Features.pNext = nullptr;
+
+    VkPhysicalDeviceFeatures2 supportedFeatures;
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures.pNext = &supportedVulkan12Features;
+
+    vkGetPhysicalDeviceFeatures2(physicalDevices[0], &supportedFeatures);
+
+    VkPhysicalDeviceVulkan12Features enabledVulkan12Features = {};
+    enabledVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    enabledVulkan12Features.pNext = deviceFeatureChain;
+    deviceFeatureChain = &enabledVulkan12Features;
+
+    requestBindlessDescriptors(supportedVulkan12Features, enabledVulkan12Features);
+    requestGpuDrivenRendering(supportedFeatures.features, supportedVulkan12Features, enabledDeviceFeatures, enabledVulkan12Features);
+    requestExtendedDynamicState(physicalDevices[0], deviceExtensionProperties, deviceExtensionCount, deviceExtensions, deviceFeatureChain);
+    requestGraphicsPipelineLibrary(physicalDevices[0], deviceExtensionProperties, deviceExtensionCount, deviceExtensions, deviceFeatureChain);
+    requestMemoryBudget(deviceExtensionProperties, deviceExtensionCount, deviceExtensions);
+
     VkDeviceCreateInfo deviceCreateInfo;
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    deviceCreateInfo.pNext = nullptr;
+    deviceCreateInfo.pNext = deviceFeatureChain;
     deviceCreateInfo.flags = 0;
     deviceCreateInfo.queueCreateInfoCount = 1; // To-Do: Enable optimal amount of queues
     deviceCreateInfo.pQueueCreateInfos = &deviceQueueCreateInfo;
@@ -153,99 +303,35 @@ void createGraphics()
     deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
     deviceCreateInfo.pEnabledFeatures = &enabledDeviceFeatures;
 
-    result = vkCreateDevice(physicalDevices[0], &deviceCreateInfo, nullptr, &device);
+    result = vkCreateDevice(physicalDevices[0], &deviceCreateInfo, getHostAllocator(VK_OBJECT_TYPE_DEVICE), &device);
     CHECK_VKRESULT(result);
 
+    loadDeviceDispatch(device);
+    createResidencyManager(physicalDevices[0]);
+    createMemoryBlocks(physicalDevices[0]);
     vkGetDeviceQueue(device, 0, 0, &queue);
 
+    loadDynamicStateFunctions(device);
+    createBindlessDescriptors(physicalDevices[0], device);
+    createFrameConstants(physicalDevices[0], device, maxFramesInFlight);
+
     printPhysicalDeviceInfo(physicalDevices, physicalDeviceCount);
     printDeviceQueueFamilyProperties(queueFamilyProperties, queueFamilyCount);
     printLayerProperties(instanceLayers, layerPropertyCount);
     printExtensionProperties(instanceExtensions, extensionPropertyCount);
 
     delete[] queueFamilyProperties;
+    delete[] deviceExtensionProperties;
     delete[] instanceLayers;
     delete[] instanceExtensions;
 }
 
-LRESULT WINAPI processMessage(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
-{
-    switch (msg)
-    {
-    case WM_CLOSE:
-    {
-        if (MessageBox(hwnd, L"Close application?", L"Vulkan Renderer Application", MB_OKCANCEL | MB_ICONQUESTION) == IDOK)
-        {
-            PostQuitMessage(0);
-        }
-        return 0;
-    }
-    default:
-        return DefWindowProc(hwnd, msg, wparam, lparam);
-    }
-}
-
-void createWindow()
-{
-    windowClass = GetModuleHandle(nullptr);
-
-    WNDCLASSEX wndClass;
-    ZeroMemory(&wndClass, sizeof(WNDCLASSEX));
-    wndClass.cbSize = sizeof(WNDCLASSEX);
-    wndClass.style = CS_OWNDC;
-    wndClass.lpfnWndProc = processMessage;
-    wndClass.cbClsExtra = 0;
-    wndClass.cbWndExtra = 0;
-    wndClass.hInstance = windowClass;
-    wndClass.hIcon = nullptr;
-    wndClass.hCursor = nullptr;
-    wndClass.lpszMenuName = nullptr;
-    wndClass.lpszClassName = windowClassName;
-    wndClass.hIconSm = nullptr;
-
-    RegisterClassEx(&wndClass);
-
-    LONG windowStyle = WS_CAPTION | WS_MINIMIZEBOX | WS_SYSMENU;
-    RECT clientSize = { 0, 0, LONG(windowWidth), LONG(windowHeight) };
-    AdjustWindowRect(&clientSize, windowStyle, FALSE);
-
-    windowHandle = CreateWindow(
-        windowClassName,
-        windowTitle,
-        windowStyle,
-        CW_USEDEFAULT,
-        CW_USEDEFAULT,
-        clientSize.right - clientSize.left,
-        clientSize.bottom - clientSize.top,
-        NULL,
-        NULL,
-        windowClass,
-        nullptr
-    );
-
-    HRESULT hresult = GetLastError();
-    if (hresult != S_OK)
-    {
-        __debugbreak();
-    }
-
-    ShowWindow(windowHandle, SW_SHOWDEFAULT);
-}
-
 void createSurface()
 {
-    VkWin32SurfaceCreateInfoKHR surfaceCreateInfo;
-    surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
-    surfaceCreateInfo.pNext = nullptr;
-    surfaceCreateInfo.flags = 0;
-    surfaceCreateInfo.hinstance = windowClass;
-    surfaceCreateInfo.hwnd = windowHandle;
-
-    VkResult result = vkCreateWin32SurfaceKHR(instance, &surfaceCreateInfo, nullptr, &surface);
-    CHECK_VKRESULT(result);
+    surface = createWindowSurface(instance);
 
     VkSurfaceCapabilitiesKHR surfaceCapabilities;
-    result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevices[0], surface, &surfaceCapabilities);
+    VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevices[0], surface, &surfaceCapabilities);
     CHECK_VKRESULT(result);
 
     printSurfaceCapabilities(surfaceCapabilities);
@@ -258,34 +344,51 @@ void createSurface()
     result = vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevices[0], surface, &supportedFormatCount, surfaceFormats);
     CHECK_VKRESULT(result);
 
-    delete[] surfaceFormats;
-}
-
-void createSwapchain()
-{
     uint32_t presentModeCount = 0;
-    VkResult result = vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevices[0], surface, &presentModeCount, nullptr);
+    result = vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevices[0], surface, &presentModeCount, nullptr);
     CHECK_VKRESULT(result);
 
     VkPresentModeKHR* presentModes = new VkPresentModeKHR[presentModeCount];
     result = vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevices[0], surface, &presentModeCount, presentModes);
     CHECK_VKRESULT(result);
 
+    // Picked once, the render pass and pipelines are built for this format. Recreations keep the configuration.
+    swapchainConfiguration = selectSwapchainConfiguration(presentProfile, surfaceCapabilities, surfaceFormats, supportedFormatCount, presentModes, presentModeCount);
+
+    std::cout << "Present profile " << getPresentProfileName(presentProfile) << ": " << getPresentModeName(swapchainConfiguration.presentMode)
+        << ", " << swapchainConfiguration.imageCount << " images, format " << swapchainConfiguration.surfaceFormat.format << std::endl;
+
+    delete[] presentModes;
+    delete[] surfaceFormats;
+}
+
+void createSwapchain()
+{
     VkBool32 surfaceSupport = VK_FALSE;
-    result = vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevices[0], 0, surface, &surfaceSupport);
+    VkResult result = vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevices[0], 0, surface, &surfaceSupport);
+    CHECK_VKRESULT(result);
+
+    VkSurfaceCapabilitiesKHR surfaceCapabilities;
+    result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevices[0], surface, &surfaceCapabilities);
     CHECK_VKRESULT(result);
 
-    VkExtent2D imageExtent = { windowWidth, windowHeight };
+    // The surface either dictates the extent or leaves it to us with 0xFFFFFFFF
+    swapchainExtent = surfaceCapabilities.currentExtent;
+    if (swapchainExtent.width == 0xFFFFFFFF)
+    {
+        swapchainExtent.width = std::clamp(windowWidth, surfaceCapabilities.minImageExtent.width, surfaceCapabilities.maxImageExtent.width);
+        swapchainExtent.height = std::clamp(windowHeight, surfaceCapabilities.minImageExtent.height, surfaceCapabilities.maxImageExtent.height);
+    }
 
     VkSwapchainCreateInfoKHR swapchainCreateInfo;
     swapchainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
     swapchainCreateInfo.pNext = nullptr;
     swapchainCreateInfo.flags = 0;
     swapchainCreateInfo.surface = surface;
-    swapchainCreateInfo.minImageCount = 2; // To-Do: Find optimal image count
-    swapchainCreateInfo.imageFormat = VK_FORMAT_B8G8R8A8_UNORM; // To-Do: Find optimal image format
-    swapchainCreateInfo.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR; // To-Do: Find optimal color space
-    swapchainCreateInfo.imageExtent = imageExtent;
+    swapchainCreateInfo.minImageCount = swapchainConfiguration.imageCount;
+    swapchainCreateInfo.imageFormat = swapchainConfiguration.surfaceFormat.format;
+    swapchainCreateInfo.imageColorSpace = swapchainConfiguration.surfaceFormat.colorSpace;
+    swapchainCreateInfo.imageExtent = swapchainExtent;
     swapchainCreateInfo.imageArrayLayers = 1;
     swapchainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
     swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
@@ -293,11 +396,11 @@ void createSwapchain()
     swapchainCreateInfo.pQueueFamilyIndices = nullptr;
     swapchainCreateInfo.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
     swapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    swapchainCreateInfo.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    swapchainCreateInfo.presentMode = swapchainConfiguration.presentMode;
     swapchainCreateInfo.clipped = VK_TRUE;
-    swapchainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+    swapchainCreateInfo.oldSwapchain = swapchain; // Lets the presentation engine hand over without a gap
 
-    result = vkCreateSwapchainKHR(device, &swapchainCreateInfo, nullptr, &swapchain);
+    result = vkCreateSwapchainKHR(device, &swapchainCreateInfo, getHostAllocator(VK_OBJECT_TYPE_SWAPCHAIN_KHR), &swapchain);
     CHECK_VKRESULT(result);
 
     result = vkGetSwapchainImagesKHR(device, swapchain, &imageViewCount, nullptr);
@@ -317,7 +420,7 @@ void createSwapchain()
         imageViewCreateInfo.flags = 0;
         imageViewCreateInfo.image = images[i];
         imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        imageViewCreateInfo.format = VK_FORMAT_B8G8R8A8_UNORM; // To-Do: Find optimal image format
+        imageViewCreateInfo.format = swapchainConfiguration.surfaceFormat.format;
         imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
         imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
         imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
@@ -328,450 +431,932 @@ void createSwapchain()
         imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
         imageViewCreateInfo.subresourceRange.layerCount = 1;
 
-        result = vkCreateImageView(device, &imageViewCreateInfo, nullptr, &imageViews[i]);
+        result = vkCreateImageView(device, &imageViewCreateInfo, getHostAllocator(VK_OBJECT_TYPE_IMAGE_VIEW), &imageViews[i]);
         CHECK_VKRESULT(result);
     }
 
-    delete[] presentModes;
     delete[] images;
 }
 
+void createShaderModule(const char* name, VkShaderModule& shaderModule, ShaderReflection& reflection)
+{
+    size_t codeSize = 0;
+    const uint32_t* code = findBundledShader(name, codeSize);
+
+    if (code == nullptr)
+    {
+        std::cout << "Shader " << name << " is missing from the bundle, add it to shader_permutations.h" << std::endl;
+        __debugbreak();
+        std::exit(EXIT_FAILURE);
+    }
+
+    VkShaderModuleCreateInfo shaderModuleCreateInfo;
+    shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderModuleCreateInfo.pNext = nullptr;
+    shaderModuleCreateInfo.flags = 0;
+    shaderModuleCreateInfo.codeSize = codeSize;
+    shaderModuleCreateInfo.pCode = code;
+
+    VkResult result = vkCreateShaderModule(device, &shaderModuleCreateInfo, getHostAllocator(VK_OBJECT_TYPE_SHADER_MODULE), &shaderModule);
+    CHECK_VKRESULT(result);
+
+    reflection = reflectShader(shaderModuleCreateInfo.pCode, shaderModuleCreateInfo.codeSize);
+}
+
 void createShaders()
 {
-    std::vector<char> vertexShaderCode = loadFile("Source\\Shaders\\vertex_shader.spv");
+    // The bundle is the only source of SPIR-V, it is rebuilt from the shader sources with every build
+    if (!openShaderBundle("Source/Shaders/shaders.spvbundle"))
+    {
+        std::cout << "Shader bundle Source/Shaders/shaders.spvbundle not found, build the shaders target" << std::endl;
+        __debugbreak();
+        std::exit(EXIT_FAILURE);
+    }
 
-    VkShaderModuleCreateInfo vertexShaderModuleCreateInfo;
-    vertexShaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    vertexShaderModuleCreateInfo.pNext = nullptr;
-    vertexShaderModuleCreateInfo.flags = 0;
-    vertexShaderModuleCreateInfo.codeSize = vertexShaderCode.size();
-    vertexShaderModuleCreateInfo.pCode = (uint32_t*)vertexShaderCode.data();
+    createShaderModule("vertex_shader", vertexShader, vertexShaderReflection);
+    createShaderModule("fragment_shader", fragmentShader, fragmentShaderReflection);
 
-    vkCreateShaderModule(device, &vertexShaderModuleCreateInfo, nullptr, &vertexShader);
+    if (isGpuDrivenRenderingEnabled())
+    {
+        createShaderModule("vertex_shader_gpu_driven", gpuDrivenVertexShader, gpuDrivenVertexShaderReflection);
+        createShaderModule("cull_instances", cullShader, cullShaderReflection);
+    }
 
-    std::vector<char> fragmentShaderCode = loadFile("Source\\Shaders\\fragment_shader.spv");
+    if (depthPrepassEnabled)
+    {
+        createShaderModule("vertex_shader_depth", depthVertexShader, depthVertexShaderReflection);
 
-    VkShaderModuleCreateInfo fragmentShaderModuleCreateInfo;
-    fragmentShaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    fragmentShaderModuleCreateInfo.pNext = nullptr;
-    fragmentShaderModuleCreateInfo.flags = 0;
-    fragmentShaderModuleCreateInfo.codeSize = fragmentShaderCode.size();
-    fragmentShaderModuleCreateInfo.pCode = (uint32_t*)fragmentShaderCode.data();
+        if (isGpuDrivenRenderingEnabled())
+        {
+            createShaderModule("vertex_shader_gpu_driven_depth", gpuDrivenDepthVertexShader, gpuDrivenDepthVertexShaderReflection);
+        }
+    }
 
-    vkCreateShaderModule(device, &fragmentShaderModuleCreateInfo, nullptr, &fragmentShader);
+    closeShaderBundle();
 }
 
 void createPipeline()
 {
-    VkPipelineShaderStageCreateInfo shaderStages[2];
-
-    VkPipelineShaderStageCreateInfo& vertexStateCreateInfo = shaderStages[0];
-    vertexStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertexStateCreateInfo.pNext = nullptr;
-    vertexStateCreateInfo.flags = 0;
-    vertexStateCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertexStateCreateInfo.module = vertexShader;
-    vertexStateCreateInfo.pName = "main";
-    vertexStateCreateInfo.pSpecializationInfo = nullptr;
-
-    VkPipelineShaderStageCreateInfo& fragmentStateCreateInfo = shaderStages[1];
-    fragmentStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragmentStateCreateInfo.pNext = nullptr;
-    fragmentStateCreateInfo.flags = 0;
-    fragmentStateCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragmentStateCreateInfo.module = fragmentShader;
-    fragmentStateCreateInfo.pName = "main";
-    fragmentStateCreateInfo.pSpecializationInfo = nullptr;
-
-    VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo;
-    vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputCreateInfo.pNext = nullptr;
-    vertexInputCreateInfo.flags = 0;
-    vertexInputCreateInfo.vertexBindingDescriptionCount = 0;
-    vertexInputCreateInfo.pVertexBindingDescriptions = nullptr;
-    vertexInputCreateInfo.vertexAttributeDescriptionCount = 0;
-    vertexInputCreateInfo.pVertexAttributeDescriptions = nullptr;
-
-    VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo;
-    inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssemblyCreateInfo.pNext = nullptr;
-    inputAssemblyCreateInfo.flags = 0;
-    inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
-
-    VkViewport viewport;
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(windowWidth);
-    viewport.height = static_cast<float>(windowHeight);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor;
-    scissor.offset.x = 0;
-    scissor.offset.y = 0;
-    scissor.extent.width = windowWidth;
-    scissor.extent.height = windowHeight;
-
-    VkPipelineViewportStateCreateInfo viewportStateCreateInfo;
-    viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportStateCreateInfo.pNext = nullptr;
-    viewportStateCreateInfo.flags = 0;
-    viewportStateCreateInfo.viewportCount = 1;
-    viewportStateCreateInfo.pViewports = &viewport;
-    viewportStateCreateInfo.scissorCount = 1;
-    viewportStateCreateInfo.pScissors = &scissor;
-
-    VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo;
-    rasterizationStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizationStateCreateInfo.pNext = nullptr;
-    rasterizationStateCreateInfo.flags = 0;
-    rasterizationStateCreateInfo.depthClampEnable = VK_FALSE;
-    rasterizationStateCreateInfo.rasterizerDiscardEnable = VK_FALSE;
-    rasterizationStateCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizationStateCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizationStateCreateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    rasterizationStateCreateInfo.depthBiasEnable = VK_FALSE;
-    rasterizationStateCreateInfo.depthBiasConstantFactor = 0.0f;
-    rasterizationStateCreateInfo.depthBiasClamp = 0.0f;
-    rasterizationStateCreateInfo.depthBiasSlopeFactor = 0.0f;
-    rasterizationStateCreateInfo.lineWidth = 1.0f;
-
-    VkPipelineMultisampleStateCreateInfo multisampleStateCreateInfo;
-    multisampleStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampleStateCreateInfo.pNext = nullptr;
-    multisampleStateCreateInfo.flags = 0;
-    multisampleStateCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    multisampleStateCreateInfo.sampleShadingEnable = VK_FALSE;
-    multisampleStateCreateInfo.minSampleShading = 1.0f;
-    multisampleStateCreateInfo.pSampleMask = nullptr;
-    multisampleStateCreateInfo.alphaToCoverageEnable = VK_FALSE;
-    multisampleStateCreateInfo.alphaToOneEnable = VK_FALSE;
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachmentState;
-    colorBlendAttachmentState.blendEnable = VK_TRUE;
-    colorBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-    colorBlendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-    colorBlendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-
-    VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo;
-    colorBlendStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlendStateCreateInfo.pNext = nullptr;
-    colorBlendStateCreateInfo.flags = 0;
-    colorBlendStateCreateInfo.logicOpEnable = VK_FALSE;
-    colorBlendStateCreateInfo.logicOp = VK_LOGIC_OP_NO_OP;
-    colorBlendStateCreateInfo.attachmentCount = 1;
-    colorBlendStateCreateInfo.pAttachments = &colorBlendAttachmentState;
-    colorBlendStateCreateInfo.blendConstants[0] = 0.0f;
-    colorBlendStateCreateInfo.blendConstants[1] = 0.0f;
-    colorBlendStateCreateInfo.blendConstants[2] = 0.0f;
-    colorBlendStateCreateInfo.blendConstants[3] = 0.0f;
-
-    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo;
-    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutCreateInfo.pNext = nullptr;
-    pipelineLayoutCreateInfo.flags = 0;
-    pipelineLayoutCreateInfo.setLayoutCount = 0;
-    pipelineLayoutCreateInfo.pSetLayouts = nullptr;
-    pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-    pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
-
-    VkResult result = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout);
-    CHECK_VKRESULT(result);
+    const ShaderReflection shaderReflections[] = { vertexShaderReflection, fragmentShaderReflection };
+    pipelineLayout = getPipelineLayout(device, shaderReflections, 2);
+
+    VkPhysicalDeviceProperties physicalDeviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevices[0], &physicalDeviceProperties);
 
-    VkAttachmentDescription attachmentDescription;
-    attachmentDescription.flags = 0;
-    attachmentDescription.format = VK_FORMAT_B8G8R8A8_UNORM;
-    attachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
-    attachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    attachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    attachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    attachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference attachmentReference;
-    attachmentReference.attachment = 0;
-    attachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpassDescription;
-    subpassDescription.flags = 0;
-    subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpassDescription.inputAttachmentCount = 0;
-    subpassDescription.pInputAttachments = nullptr;
-    subpassDescription.colorAttachmentCount = 1;
-    subpassDescription.pColorAttachments = &attachmentReference;
-    subpassDescription.pResolveAttachments = nullptr;
-    subpassDescription.pDepthStencilAttachment = nullptr;
-    subpassDescription.preserveAttachmentCount = 0;
-    subpassDescription.pPreserveAttachments = nullptr;
-
-    VkSubpassDependency subpassDependency;
-    subpassDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    subpassDependency.dstSubpass = 0;
-    subpassDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependency.srcAccessMask = 0;
-    subpassDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    subpassDependency.dependencyFlags = 0;
+    if (!validatePushConstants(shaderReflections, 2, sizeof(DrawPushConstants), physicalDeviceProperties.limits.maxPushConstantsSize))
+    {
+        __debugbreak();
+    }
+
+    // Has to match the stage flags of the merged range in the pipeline layout
+    pushConstantStages = 0;
+    for (const ShaderReflection& reflection : shaderReflections)
+    {
+        for (const VkPushConstantRange& range : reflection.pushConstantRanges)
+        {
+            pushConstantStages |= range.stageFlags;
+        }
+    }
+
+    depthFormat = selectDepthFormat(physicalDevices[0]);
+    if (depthFormat == VK_FORMAT_UNDEFINED)
+    {
+        __debugbreak(); // No usable depth format
+    }
+
+    VkAttachmentDescription attachmentDescriptions[2];
+    attachmentDescriptions[0].flags = 0;
+    attachmentDescriptions[0].format = swapchainConfiguration.surfaceFormat.format;
+    attachmentDescriptions[0].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachmentDescriptions[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachmentDescriptions[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachmentDescriptions[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachmentDescriptions[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachmentDescriptions[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachmentDescriptions[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    // Depth is only needed within the render pass, so it is never stored
+    attachmentDescriptions[1].flags = 0;
+    attachmentDescriptions[1].format = depthFormat;
+    attachmentDescriptions[1].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachmentDescriptions[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachmentDescriptions[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachmentDescriptions[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachmentDescriptions[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachmentDescriptions[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachmentDescriptions[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorAttachmentReference;
+    colorAttachmentReference.attachment = 0;
+    colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depthAttachmentReference;
+    depthAttachmentReference.attachment = 1;
+    depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    // With the prepass, subpass 0 only writes depth and subpass 1 shades against it
+    colorSubpass = depthPrepassEnabled ? 1 : 0;
+
+    VkSubpassDescription subpassDescriptions[2];
+    for (VkSubpassDescription& subpassDescription : subpassDescriptions)
+    {
+        subpassDescription.flags = 0;
+        subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpassDescription.inputAttachmentCount = 0;
+        subpassDescription.pInputAttachments = nullptr;
+        subpassDescription.colorAttachmentCount = 0;
+        subpassDescription.pColorAttachments = nullptr;
+        subpassDescription.pResolveAttachments = nullptr;
+        subpassDescription.pDepthStencilAttachment = &depthAttachmentReference;
+        subpassDescription.preserveAttachmentCount = 0;
+        subpassDescription.pPreserveAttachments = nullptr;
+    }
+
+    subpassDescriptions[colorSubpass].colorAttachmentCount = 1;
+    subpassDescriptions[colorSubpass].pColorAttachments = &colorAttachmentReference;
+
+    std::vector<VkSubpassDependency> subpassDependencies;
+
+    VkSubpassDependency colorDependency;
+    colorDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    colorDependency.dstSubpass = colorSubpass;
+    colorDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    colorDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    colorDependency.srcAccessMask = 0;
+    colorDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    colorDependency.dependencyFlags = 0;
+    subpassDependencies.push_back(colorDependency);
+
+    // All frames in flight share the depth buffer, the clear has to wait for the previous frame's depth writes
+    VkSubpassDependency depthDependency;
+    depthDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    depthDependency.dstSubpass = 0;
+    depthDependency.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    depthDependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    depthDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    depthDependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    depthDependency.dependencyFlags = 0;
+    subpassDependencies.push_back(depthDependency);
+
+    if (depthPrepassEnabled)
+    {
+        VkSubpassDependency prepassDependency;
+        prepassDependency.srcSubpass = 0;
+        prepassDependency.dstSubpass = colorSubpass;
+        prepassDependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        prepassDependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        prepassDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        prepassDependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        prepassDependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+        subpassDependencies.push_back(prepassDependency);
+    }
 
     VkRenderPassCreateInfo renderPassCreateInfo;
     renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
     renderPassCreateInfo.pNext = nullptr;
     renderPassCreateInfo.flags = 0;
-    renderPassCreateInfo.attachmentCount = 1;
-    renderPassCreateInfo.pAttachments = &attachmentDescription;
-    renderPassCreateInfo.subpassCount = 1;
-    renderPassCreateInfo.pSubpasses = &subpassDescription;
-    renderPassCreateInfo.dependencyCount = 1;
-    renderPassCreateInfo.pDependencies = &subpassDependency;
-
-    result = vkCreateRenderPass(device, &renderPassCreateInfo, nullptr, &renderPass);
+    renderPassCreateInfo.attachmentCount = 2;
+    renderPassCreateInfo.pAttachments = attachmentDescriptions;
+    renderPassCreateInfo.subpassCount = colorSubpass + 1;
+    renderPassCreateInfo.pSubpasses = subpassDescriptions;
+    renderPassCreateInfo.dependencyCount = uint32_t(subpassDependencies.size());
+    renderPassCreateInfo.pDependencies = subpassDependencies.data();
+
+    VkResult result = vkCreateRenderPass(device, &renderPassCreateInfo, getHostAllocator(VK_OBJECT_TYPE_RENDER_PASS), &renderPass);
     CHECK_VKRESULT(result);
 
-    VkGraphicsPipelineCreateInfo pipelineCreateInfo;
-    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineCreateInfo.pNext = nullptr;
-    pipelineCreateInfo.flags = 0;
-    pipelineCreateInfo.stageCount = 2;
-    pipelineCreateInfo.pStages = shaderStages;
-    pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
-    pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
-    pipelineCreateInfo.pTessellationState = nullptr;
-    pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
-    pipelineCreateInfo.pRasterizationState = &rasterizationStateCreateInfo;
-    pipelineCreateInfo.pMultisampleState = &multisampleStateCreateInfo;
-    pipelineCreateInfo.pDepthStencilState = nullptr;
-    pipelineCreateInfo.pColorBlendState = &colorBlendStateCreateInfo;
-    pipelineCreateInfo.pDynamicState = nullptr;
-    pipelineCreateInfo.layout = pipelineLayout;
-    pipelineCreateInfo.renderPass = renderPass;
-    pipelineCreateInfo.subpass = 0;
-    pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
-    pipelineCreateInfo.basePipelineIndex = -1;
-
-    result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
-    CHECK_VKRESULT(result);
+    std::vector<VkVertexInputBindingDescription> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+    getVertexInputDescription(vertexShaderReflection, vertexBindings, vertexAttributes);
+
+    // After a prepass the depth is final, the color pass only shades the fragments that match it
+    initPipelineState(pipelineState);
+    pipelineState.vertexShader = vertexShader;
+    pipelineState.fragmentShader = fragmentShader;
+    pipelineState.layout = pipelineLayout;
+    pipelineState.colorFormat = swapchainConfiguration.surfaceFormat.format;
+    pipelineState.depthFormat = depthFormat;
+    pipelineState.subpass = colorSubpass;
+    pipelineState.depthTestEnable = VK_TRUE;
+    pipelineState.depthWriteEnable = depthPrepassEnabled ? VK_FALSE : VK_TRUE;
+    pipelineState.depthCompareOp = depthPrepassEnabled ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS;
+    setVertexInputState(pipelineState, vertexBindings, vertexAttributes);
+    setSpecializationConstant(pipelineState.fragmentConstants, encodeSrgbConstantId, !isSrgbFormat(swapchainConfiguration.surfaceFormat.format));
+
+    if (!validateSpecializationConstants(pipelineState.vertexConstants, vertexShaderReflection) ||
+        !validateSpecializationConstants(pipelineState.fragmentConstants, fragmentShaderReflection))
+    {
+        __debugbreak();
+    }
+
+    pipeline = getPipelineEntry(device, pipelineState, renderPass);
+
+    // The depth-only vertex shader declares a subset of the resources, so it fits the color pipeline's layout
+    depthPipelineState = pipelineState;
+    if (depthPrepassEnabled)
+    {
+        getVertexInputDescription(depthVertexShaderReflection, vertexBindings, vertexAttributes);
+
+        depthPipelineState.vertexShader = depthVertexShader;
+        depthPipelineState.fragmentShader = VK_NULL_HANDLE;
+        initSpecializationConstants(depthPipelineState.fragmentConstants);
+        depthPipelineState.colorFormat = VK_FORMAT_UNDEFINED;
+        depthPipelineState.subpass = 0;
+        depthPipelineState.depthWriteEnable = VK_TRUE;
+        depthPipelineState.depthCompareOp = VK_COMPARE_OP_LESS;
+        setVertexInputState(depthPipelineState, vertexBindings, vertexAttributes);
+        depthPipeline = getPipelineEntry(device, depthPipelineState, renderPass);
+    }
+
+    if (isGpuDrivenRenderingEnabled())
+    {
+        const ShaderReflection gpuDrivenReflections[] = { gpuDrivenVertexShaderReflection, fragmentShaderReflection };
+        gpuDrivenPipelineLayout = getPipelineLayout(device, gpuDrivenReflections, 2);
+
+        // Instances come from the storage buffer, so this permutation has no instance binding
+        getVertexInputDescription(gpuDrivenVertexShaderReflection, vertexBindings, vertexAttributes);
+
+        PipelineStateDescription gpuDrivenPipelineState = pipelineState;
+        gpuDrivenPipelineState.vertexShader = gpuDrivenVertexShader;
+        gpuDrivenPipelineState.layout = gpuDrivenPipelineLayout;
+        setVertexInputState(gpuDrivenPipelineState, vertexBindings, vertexAttributes);
+        gpuDrivenPipeline = getPipelineEntry(device, gpuDrivenPipelineState, renderPass);
+
+        if (depthPrepassEnabled)
+        {
+            getVertexInputDescription(gpuDrivenDepthVertexShaderReflection, vertexBindings, vertexAttributes);
+
+            PipelineStateDescription gpuDrivenDepthPipelineState = depthPipelineState;
+            gpuDrivenDepthPipelineState.vertexShader = gpuDrivenDepthVertexShader;
+            gpuDrivenDepthPipelineState.layout = gpuDrivenPipelineLayout;
+            setVertexInputState(gpuDrivenDepthPipelineState, vertexBindings, vertexAttributes);
+            gpuDrivenDepthPipeline = getPipelineEntry(device, gpuDrivenDepthPipelineState, renderPass);
+        }
+
+        createGpuDrivenRendering(physicalDevices[0], device, cullShader, cullShaderReflection, maxGpuInstances, maxGpuIndices);
+    }
 }
 
 void createFramebuffers()
 {
+    // The external dependency of the render pass orders the frames in flight on the queue, so all framebuffers share one depth buffer
+    DepthBuffer depthBuffer = createDepthBuffer(physicalDevices[0], device, swapchainExtent, depthFormat);
+    depthImage = addImage(depthBuffer.image, depthBuffer.memory, depthBuffer.view, depthBuffer.format, swapchainExtent);
+
     framebuffers = new VkFramebuffer[imageViewCount];
 
     for (uint32_t i = 0; i < imageViewCount; i++)
     {
+        VkImageView attachments[] = { imageViews[i], resolveImageView(depthImage) };
+
         VkFramebufferCreateInfo framebufferCreateInfo;
         framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebufferCreateInfo.pNext = nullptr;
         framebufferCreateInfo.flags = 0;
         framebufferCreateInfo.renderPass = renderPass;
-        framebufferCreateInfo.attachmentCount = 1;
-        framebufferCreateInfo.pAttachments = &imageViews[i];
-        framebufferCreateInfo.width = windowWidth;
-        framebufferCreateInfo.height = windowHeight;
+        framebufferCreateInfo.attachmentCount = 2;
+        framebufferCreateInfo.pAttachments = attachments;
+        framebufferCreateInfo.width = swapchainExtent.width;
+        framebufferCreateInfo.height = swapchainExtent.height;
         framebufferCreateInfo.layers = 1;
 
-        VkResult result = vkCreateFramebuffer(device, &framebufferCreateInfo, nullptr, &framebuffers[i]);
+        VkResult result = vkCreateFramebuffer(device, &framebufferCreateInfo, getHostAllocator(VK_OBJECT_TYPE_FRAMEBUFFER), &framebuffers[i]);
         CHECK_VKRESULT(result);
     }
 }
 
-void createCommandPool()
+// Frames in flight may still render into or present the old images, the swapchain and everything that depends
+// on its images or size is destroyed once they retired
+void retireSwapchain()
 {
+    for (uint32_t i = 0; i < imageViewCount; i++)
+    {
+        deferDestruction(VK_OBJECT_TYPE_FRAMEBUFFER, uint64_t(framebuffers[i]));
+        deferDestruction(VK_OBJECT_TYPE_IMAGE_VIEW, uint64_t(imageViews[i]));
+    }
+
+    releaseImage(depthImage);
+    deferDestruction(VK_OBJECT_TYPE_SWAPCHAIN_KHR, uint64_t(swapchain));
+
+    delete[] framebuffers;
+    delete[] imageViews;
+}
+
+// Only the swapchain and what depends on its size are rebuilt. The render pass and pipelines stay, the viewport
+// is dynamic. Returns false while the surface has no area, the swapchain stays outdated until then.
+bool recreateSwapchain()
+{
+    VkSurfaceCapabilitiesKHR surfaceCapabilities;
+    VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevices[0], surface, &surfaceCapabilities);
+    CHECK_VKRESULT(result);
+
+    if (windowMinimized || surfaceCapabilities.currentExtent.width == 0 || surfaceCapabilities.currentExtent.height == 0)
+    {
+        return false;
+    }
+
+    retireSwapchain();
+    createSwapchain();
+    createFramebuffers();
+
+    swapchainOutdated = false;
+    return true;
+}
+
+void createCommandPools()
+{
+    // Command buffers are recorded every frame, each frame in flight resets its own pool once its fence signalled
     VkCommandPoolCreateInfo commandPoolCreateInfo;
     commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     commandPoolCreateInfo.pNext = nullptr;
-    commandPoolCreateInfo.flags = 0;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
     commandPoolCreateInfo.queueFamilyIndex = 0; // To-Do: Choose optimal queue index
 
-    VkResult result = vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool);
-    CHECK_VKRESULT(result);
+    for (uint32_t i = 0; i < maxFramesInFlight; i++)
+    {
+        VkResult result = vkCreateCommandPool(device, &commandPoolCreateInfo, getHostAllocator(VK_OBJECT_TYPE_COMMAND_POOL), &commandPools[i]);
+        CHECK_VKRESULT(result);
+    }
 }
 
 void createCommandBuffers()
 {
-    commandBuffers = new VkCommandBuffer[imageViewCount];
+    for (uint32_t i = 0; i < maxFramesInFlight; i++)
+    {
+        VkCommandBufferAllocateInfo commandBufferAllocateInfo;
+        commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        commandBufferAllocateInfo.pNext = nullptr;
+        commandBufferAllocateInfo.commandPool = commandPools[i];
+        commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        commandBufferAllocateInfo.commandBufferCount = 1;
+
+        VkResult result = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &commandBuffers[i]);
+        CHECK_VKRESULT(result);
+    }
+}
+
+void createScene()
+{
+    const glm::vec3 positions[] =
+    {
+        glm::vec3(-0.5f, 0.5f, 0.0f),
+        glm::vec3(0.5f, 0.5f, 0.0f),
+        glm::vec3(0.0f, -0.5f, 0.0f)
+    };
 
-    VkCommandBufferAllocateInfo commandBufferAllocateInfo;
-    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    commandBufferAllocateInfo.pNext = nullptr;
-    commandBufferAllocateInfo.commandPool = commandPool;
-    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    commandBufferAllocateInfo.commandBufferCount = imageViewCount;
+    const glm::vec3 colors[] =
+    {
+        glm::vec3(1.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 1.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 1.0f)
+    };
+
+    // Positions and the remaining attributes live in separate streams, see positionInputBinding
+    // Mesh data is what gets demoted first once streamed assets oversubscribe the heap
+    const VkBufferUsageFlags vertexBufferUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    trianglePositions = addStreamableBuffer(createSuballocatedGpuBuffer(physicalDevices[0], device, sizeof(positions), vertexBufferUsage,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), ResidencyPolicyDemote);
+    triangleColors = addStreamableBuffer(createSuballocatedGpuBuffer(physicalDevices[0], device, sizeof(colors), vertexBufferUsage,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), ResidencyPolicyDemote);
+
+    std::memcpy(resolveBufferMapping(trianglePositions), positions, sizeof(positions));
+    std::memcpy(resolveBufferMapping(triangleColors), colors, sizeof(colors));
+
+    if (isGpuDrivenRenderingEnabled())
+    {
+        const uint32_t triangleIndices[] = { 0, 1, 2 };
+        uint32_t triangleMesh = addGpuMesh(triangleIndices, 3, 0);
+        addGpuInstance(glm::mat4(1.0f), glm::vec4(0.0f, 0.0f, 0.0f, 0.75f), triangleMesh, 0);
+        return;
+    }
 
-    vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, commandBuffers);
+    createInstanceStream(physicalDevices[0], device, maxFramesInFlight, maxInstancesPerFrame);
+
+    SceneDraw triangle;
+    triangle.pipeline = pipeline;
+    triangle.depthPipeline = depthPipeline;
+    triangle.pipelineId = 0;
+    triangle.layer = opaqueLayer;
+    triangle.meshId = 0;
+    triangle.vertexCount = 3;
+    triangle.materialIndex = 0;
+    triangle.depth = 0.0f;
+    triangle.transform = glm::mat4(1.0f);
+    sceneDraws.push_back(triangle);
 }
 
-void recordCommandBuffers()
+void buildDrawQueue()
+{
+    clearDrawQueue(drawQueue);
+
+    for (uint32_t i = 0; i < uint32_t(sceneDraws.size()); i++)
+    {
+        const SceneDraw& draw = sceneDraws[i];
+
+        // Opaque draws of the same mesh and material collapse into one instanced draw,
+        // everything else keeps its depth order
+        uint64_t sortKey = draw.layer == opaqueLayer ?
+            makeInstancedSortKey(draw.layer, draw.pipelineId, draw.materialIndex, draw.meshId) :
+            makeSortKey(draw.layer, draw.pipelineId, draw.materialIndex, draw.depth, true);
+        pushDrawPacket(drawQueue, sortKey, i);
+    }
+
+    sortDrawQueue(drawQueue);
+    buildDrawBatches(drawQueue, drawBatches);
+}
+
+// Streams the transforms of every batch into this frame's region of the instance buffer. Both passes draw from it.
+void streamInstances()
+{
+    batchFirstInstances.clear();
+
+    for (const DrawBatch& batch : drawBatches)
+    {
+        uint32_t firstInstance = 0;
+        InstanceData* instances = allocateInstances(frameIndex, batch.packetCount, firstInstance);
+        if (instances == nullptr)
+        {
+            __debugbreak(); // Raise maxInstancesPerFrame
+            break;
+        }
+
+        for (uint32_t i = 0; i < batch.packetCount; i++)
+        {
+            instances[i].transform = sceneDraws[drawQueue.packets[batch.firstPacket + i].drawIndex].transform;
+        }
+
+        batchFirstInstances.push_back(firstInstance);
+    }
+}
+
+void recordScenePass(CommandRecorder& recorder, bool depthOnly, VkDescriptorSet frameSet)
+{
+    const PipelineStateDescription& passState = depthOnly ? depthPipelineState : pipelineState;
+
+    // Same few calls no matter how many instances there are, both passes draw the result of the same cull
+    if (isGpuDrivenRenderingEnabled())
+    {
+        recordBindPipeline(recorder, loadPipeline(depthOnly ? gpuDrivenDepthPipeline : gpuDrivenPipeline));
+        recordSetViewportAndScissor(recorder, swapchainExtent, renderScale);
+        recordSetRasterizationState(recorder, passState.cullMode, VkFrontFace(passState.frontFace));
+        recordSetDepthState(recorder, passState.depthTestEnable, passState.depthWriteEnable, VkCompareOp(passState.depthCompareOp));
+
+        VkDescriptorSet bindlessSet = getBindlessDescriptorSet();
+        recordBindDescriptorSets(recorder, gpuDrivenPipelineLayout, bindlessDescriptorSet, 1, &bindlessSet);
+        recordBindDescriptorSets(recorder, gpuDrivenPipelineLayout, frameDescriptorSet, 1, &frameSet);
+
+        // The instances carry their full transforms
+        DrawPushConstants drawConstants;
+        drawConstants.transform = glm::mat4(1.0f);
+        drawConstants.objectIndex = getGpuInstanceBufferIndex();
+        drawConstants.materialIndex = 0;
+        recordPushDrawConstants(recorder, gpuDrivenPipelineLayout, pushConstantStages, drawConstants);
+
+        cmdDrawCulledInstances(recorder);
+    }
+
+    // One instanced draw per batch. The queue is sorted by pipeline and material, so most per-batch state repeats and is elided.
+    for (uint32_t b = 0; b < uint32_t(batchFirstInstances.size()); b++)
+    {
+        const DrawBatch& batch = drawBatches[b];
+        const SceneDraw& draw = sceneDraws[drawQueue.packets[batch.firstPacket].drawIndex];
+
+        recordBindPipeline(recorder, loadPipeline(depthOnly ? draw.depthPipeline : draw.pipeline));
+        recordSetViewportAndScissor(recorder, swapchainExtent, renderScale); // To-Do: Upscale the scaled region once there is an offscreen target
+        recordSetRasterizationState(recorder, passState.cullMode, VkFrontFace(passState.frontFace));
+        recordSetDepthState(recorder, passState.depthTestEnable, passState.depthWriteEnable, VkCompareOp(passState.depthCompareOp));
+
+        if (isBindlessEnabled())
+        {
+            VkDescriptorSet bindlessSet = getBindlessDescriptorSet();
+            recordBindDescriptorSets(recorder, pipelineLayout, bindlessDescriptorSet, 1, &bindlessSet);
+        }
+
+        recordBindDescriptorSets(recorder, pipelineLayout, frameDescriptorSet, 1, &frameSet);
+
+        VkBuffer instanceBuffer = getInstanceBuffer();
+        VkDeviceSize instanceBufferOffset = getInstanceBufferOffset(frameIndex);
+        recordBindVertexBuffers(recorder, instanceInputBinding, 1, &instanceBuffer, &instanceBufferOffset);
+
+        DrawPushConstants drawConstants;
+        drawConstants.transform = glm::mat4(1.0f);
+        drawConstants.objectIndex = 0;
+        drawConstants.materialIndex = draw.materialIndex;
+        recordPushDrawConstants(recorder, pipelineLayout, pushConstantStages, drawConstants);
+
+        vkCmdDraw(recorder.commandBuffer, draw.vertexCount, batch.packetCount, 0, batchFirstInstances[b]);
+    }
+}
+
+void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint64_t completedFrames)
 {
     VkCommandBufferBeginInfo commandBufferBeginInfo;
     commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     commandBufferBeginInfo.pNext = nullptr;
-    commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     commandBufferBeginInfo.pInheritanceInfo = nullptr;
 
-    for (uint32_t i = 0; i < imageViewCount; i++)
+    VkResult result = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+    CHECK_VKRESULT(result);
+
+    // Demotions and defragmentation replace buffers, so this goes before anything resolves them
+    markBufferUsed(trianglePositions, frameCount);
+    markBufferUsed(triangleColors, frameCount);
+    updateResidency(device, commandBuffer, frameCount, completedFrames);
+
+    if (frameCount % defragmentationInterval == 0)
     {
-        VkResult result = vkBeginCommandBuffer(commandBuffers[i], &commandBufferBeginInfo);
-        CHECK_VKRESULT(result);
+        beginDefragmentation();
+    }
 
-        VkClearValue clearValue = { 0.0f, 0.0f, 0.0f, 0.0f };
+    stepDefragmentation(device, commandBuffer, defragmentationBudget);
 
-        VkRenderPassBeginInfo renderPassBeginInfo;
-        renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassBeginInfo.pNext = nullptr;
-        renderPassBeginInfo.renderPass = renderPass;
-        renderPassBeginInfo.framebuffer = framebuffers[i];
-        renderPassBeginInfo.renderArea = { 0, 0, windowWidth, windowHeight };
-        renderPassBeginInfo.clearValueCount = 1;
-        renderPassBeginInfo.pClearValues = &clearValue;
+    VkClearValue clearValues[2];
+    clearValues[0].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+    clearValues[1].depthStencil = { 1.0f, 0 };
 
-        vkCmdBeginRenderPass(commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    VkRenderPassBeginInfo renderPassBeginInfo;
+    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassBeginInfo.pNext = nullptr;
+    renderPassBeginInfo.renderPass = renderPass;
+    renderPassBeginInfo.framebuffer = framebuffers[imageIndex];
+    renderPassBeginInfo.renderArea = { 0, 0, swapchainExtent.width, swapchainExtent.height };
+    renderPassBeginInfo.clearValueCount = 2;
+    renderPassBeginInfo.pClearValues = clearValues;
 
-        vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-        vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
+    if (isGpuDrivenRenderingEnabled())
+    {
+        cmdCullInstances(commandBuffer, viewProjection);
+    }
+    else
+    {
+        streamInstances();
+    }
 
-        vkCmdEndRenderPass(commandBuffers[i]);
+    FrameConstants frameConstants;
+    frameConstants.viewProjection = viewProjection;
+    VkDescriptorSet frameSet = updateFrameConstants(device, frameIndex, frameConstants);
 
-        result = vkEndCommandBuffer(commandBuffers[i]);
-        CHECK_VKRESULT(result);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    CommandRecorder recorder;
+    beginCommandRecording(recorder, commandBuffer);
+
+    // To-Do: Per-mesh vertex streams, the scene only has the triangle so far
+    VkBuffer vertexBuffers[] = { resolveBuffer(trianglePositions), resolveBuffer(triangleColors) };
+    VkDeviceSize vertexBufferOffsets[] = { 0, 0 };
+    recordBindVertexBuffers(recorder, positionInputBinding, 1, &vertexBuffers[0], &vertexBufferOffsets[0]);
+    recordBindVertexBuffers(recorder, attributeInputBinding, 1, &vertexBuffers[1], &vertexBufferOffsets[1]);
+
+    if (depthPrepassEnabled)
+    {
+        recordScenePass(recorder, true, frameSet);
+        vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
     }
+
+    recordScenePass(recorder, false, frameSet);
+
+    vkCmdEndRenderPass(commandBuffer);
+
+    accumulateCommandStats(commandStats, recorder.stats);
+
+    result = vkEndCommandBuffer(commandBuffer);
+    CHECK_VKRESULT(result);
 }
 
-void createSemaphores()
+// Only the viewport changes, so no pipeline has to be recompiled. Takes effect with the next recorded frame.
+void setRenderScale(float scale)
+{
+    renderScale = scale;
+}
+
+void createSynchronization()
 {
     VkSemaphoreCreateInfo semaphoreCreateInfo;
     semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
     semaphoreCreateInfo.pNext = nullptr;
     semaphoreCreateInfo.flags = 0;
 
-    VkResult result = vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &imageAvailable);
-    CHECK_VKRESULT(result);
+    // Signaled so the first wait on every frame returns right away
+    VkFenceCreateInfo fenceCreateInfo;
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceCreateInfo.pNext = nullptr;
+    fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    result = vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &renderingComplete);
-    CHECK_VKRESULT(result);
+    for (uint32_t i = 0; i < maxFramesInFlight; i++)
+    {
+        VkResult result = vkCreateSemaphore(device, &semaphoreCreateInfo, getHostAllocator(VK_OBJECT_TYPE_SEMAPHORE), &imageAvailable[i]);
+        CHECK_VKRESULT(result);
+
+        result = vkCreateSemaphore(device, &semaphoreCreateInfo, getHostAllocator(VK_OBJECT_TYPE_SEMAPHORE), &renderingComplete[i]);
+        CHECK_VKRESULT(result);
+
+        result = vkCreateFence(device, &fenceCreateInfo, getHostAllocator(VK_OBJECT_TYPE_FENCE), &frameFences[i]);
+        CHECK_VKRESULT(result);
+    }
+
+    createDescriptorAllocator(maxFramesInFlight);
 }
 
 void destroyGraphics()
 {
     vkDeviceWaitIdle(device);
 
-    vkDestroySemaphore(device, imageAvailable, nullptr);
-    vkDestroySemaphore(device, renderingComplete, nullptr);
+    for (uint32_t i = 0; i < maxFramesInFlight; i++)
+    {
+        vkDestroySemaphore(device, imageAvailable[i], getHostAllocator(VK_OBJECT_TYPE_SEMAPHORE));
+        vkDestroySemaphore(device, renderingComplete[i], getHostAllocator(VK_OBJECT_TYPE_SEMAPHORE));
+        vkDestroyFence(device, frameFences[i], getHostAllocator(VK_OBJECT_TYPE_FENCE));
+    }
 
-    vkFreeCommandBuffers(device, commandPool, imageViewCount, commandBuffers);
-    vkDestroyCommandPool(device, commandPool, nullptr);
+    destroyFrameConstants(device);
+    destroyDescriptorAllocator(device);
 
-    for (uint32_t i = 0; i < imageViewCount; i++)
+    for (uint32_t i = 0; i < maxFramesInFlight; i++)
     {
-        vkDestroyFramebuffer(device, framebuffers[i], nullptr);
+        vkFreeCommandBuffers(device, commandPools[i], 1, &commandBuffers[i]);
+        vkDestroyCommandPool(device, commandPools[i], getHostAllocator(VK_OBJECT_TYPE_COMMAND_POOL));
     }
 
-    vkDestroyPipeline(device, pipeline, nullptr);
-    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-    vkDestroyRenderPass(device, renderPass, nullptr);
+    if (!isGpuDrivenRenderingEnabled())
+    {
+        destroyInstanceStream(device);
+    }
 
-    vkDestroyShaderModule(device, vertexShader, nullptr);
-    vkDestroyShaderModule(device, fragmentShader, nullptr);
+    releaseStreamableBuffer(trianglePositions);
+    releaseStreamableBuffer(triangleColors);
+    destroyResidencyManager();
 
-    vkDestroySwapchainKHR(device, swapchain, nullptr);
-    vkDestroySurfaceKHR(instance, surface, nullptr);
+    // Stops the background compiler, which may still queue replaced pipelines for destruction
+    destroyPipelineStateCache(device);
+    destroyGpuDrivenRendering(device);
 
-    for (uint32_t i = 0; i < imageViewCount; i++)
-    {
-        vkDestroyImageView(device, imageViews[i], nullptr);
-    }
+    retireSwapchain();
+    flushDeferredDestruction(device);
+    destroyMemoryBlocks(device);
 
-    vkDestroyDevice(device, nullptr);
-    vkDestroyInstance(instance, nullptr);
+    destroyPipelineLayoutCache(device);
+    destroyBindlessDescriptors(device);
+    vkDestroyRenderPass(device, renderPass, getHostAllocator(VK_OBJECT_TYPE_RENDER_PASS));
 
-    delete[] commandBuffers;
-    delete[] framebuffers;
-    delete[] imageViews;
-    delete[] physicalDevices;
-}
+    vkDestroyShaderModule(device, vertexShader, getHostAllocator(VK_OBJECT_TYPE_SHADER_MODULE));
+    vkDestroyShaderModule(device, fragmentShader, getHostAllocator(VK_OBJECT_TYPE_SHADER_MODULE));
+    vkDestroyShaderModule(device, gpuDrivenVertexShader, getHostAllocator(VK_OBJECT_TYPE_SHADER_MODULE));
+    vkDestroyShaderModule(device, depthVertexShader, getHostAllocator(VK_OBJECT_TYPE_SHADER_MODULE));
+    vkDestroyShaderModule(device, gpuDrivenDepthVertexShader, getHostAllocator(VK_OBJECT_TYPE_SHADER_MODULE));
+    vkDestroyShaderModule(device, cullShader, getHostAllocator(VK_OBJECT_TYPE_SHADER_MODULE));
 
-void destroyWindow()
-{
-    DestroyWindow(windowHandle);
-    UnregisterClass(windowClassName, windowClass);
+    vkDestroySurfaceKHR(instance, surface, getHostAllocator(VK_OBJECT_TYPE_SURFACE_KHR));
+
+    vkDestroyDevice(device, getHostAllocator(VK_OBJECT_TYPE_DEVICE));
+    clearDeviceDispatch();
+    vkDestroyInstance(instance, getHostAllocator(VK_OBJECT_TYPE_INSTANCE));
+
+    delete[] physicalDevices;
 }
 
 void draw()
 {
-    vkDeviceWaitIdle(device);
+    // Once the fence of this frame slot signals, everything the slot used last time is free again
+    VkResult result = vkWaitForFences(device, 1, &frameFences[frameIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+    CHECK_VKRESULT(result);
+
+    // Waiting for this slot's fence completed frame frameCount - maxFramesInFlight, and every one before it
+    uint64_t completedFrames = frameCount + 1 >= maxFramesInFlight ? frameCount + 1 - maxFramesInFlight : 0;
+    advanceDeferredDestruction(device, frameCount, completedFrames);
+    advanceMemoryBlocks(device, frameCount, completedFrames);
+
+    if (swapchainOutdated && !recreateSwapchain())
+    {
+        return;
+    }
 
     uint32_t imageIndex = 0;
-    VkResult result = vkAcquireNextImageKHR(device, swapchain, std::numeric_limits<uint64_t>::max(), imageAvailable, VK_NULL_HANDLE, &imageIndex);
+    result = vkAcquireNextImageKHR(device, swapchain, std::numeric_limits<uint64_t>::max(), imageAvailable[frameIndex], VK_NULL_HANDLE, &imageIndex);
+
+    // Nothing was acquired and the semaphore stays unsignaled, the fence is still signaled so the next call
+    // can go straight to recreating. A suboptimal image is still presentable, the recreation waits until after this frame.
+    if (result == VK_ERROR_OUT_OF_DATE_KHR)
+    {
+        swapchainOutdated = true;
+        return;
+    }
+    else if (result == VK_SUBOPTIMAL_KHR)
+    {
+        swapchainOutdated = true;
+    }
+    else
+    {
+        CHECK_VKRESULT(result);
+    }
+
+    beginDescriptorFrame(device, frameIndex);
+
+    result = vkResetCommandPool(device, commandPools[frameIndex], 0);
     CHECK_VKRESULT(result);
 
+    if (!isGpuDrivenRenderingEnabled())
+    {
+        beginInstanceFrame(frameIndex);
+        buildDrawQueue();
+    }
+
+    recordCommandBuffer(commandBuffers[frameIndex], imageIndex, completedFrames);
+
     VkPipelineStageFlags pipelineStageFlags[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 
     VkSubmitInfo submitInfo;
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.pNext = nullptr;
     submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &imageAvailable;
+    submitInfo.pWaitSemaphores = &imageAvailable[frameIndex];
     submitInfo.pWaitDstStageMask = pipelineStageFlags;
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+    submitInfo.pCommandBuffers = &commandBuffers[frameIndex];
     submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &renderingComplete;
+    submitInfo.pSignalSemaphores = &renderingComplete[frameIndex];
+
+    result = vkResetFences(device, 1, &frameFences[frameIndex]);
+    CHECK_VKRESULT(result);
 
-    result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    result = vkQueueSubmit(queue, 1, &submitInfo, frameFences[frameIndex]);
     CHECK_VKRESULT(result);
 
     VkPresentInfoKHR presentInfo;
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.pNext = nullptr;
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = &renderingComplete;
+    presentInfo.pWaitSemaphores = &renderingComplete[frameIndex];
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = &swapchain;
     presentInfo.pImageIndices = &imageIndex;
     presentInfo.pResults = nullptr;
 
     result = vkQueuePresentKHR(queue, &presentInfo);
-    CHECK_VKRESULT(result);
+    recordPresent(swapchainConfiguration);
+
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+    {
+        swapchainOutdated = true;
+    }
+    else
+    {
+        CHECK_VKRESULT(result);
+    }
+
+    frameIndex = (frameIndex + 1) % maxFramesInFlight;
+    frameCount++;
+}
+
+// Applies everything the message pump posted since the last frame. Returns false once the window closed.
+bool processWindowEvents()
+{
+    WindowEvent event;
+    while (popWindowEvent(windowEvents, event))
+    {
+        switch (event.type)
+        {
+        case WindowEventResize:
+            // The swapchain is recreated at the start of the next frame
+            windowMinimized = false;
+            windowWidth = event.width;
+            windowHeight = event.height;
+            if (windowWidth != swapchainExtent.width || windowHeight != swapchainExtent.height)
+            {
+                swapchainOutdated = true;
+            }
+            break;
+        case WindowEventMinimize:
+            windowMinimized = true;
+            break;
+        case WindowEventKeyDown:
+        case WindowEventKeyUp:
+            keysDown[event.key] = event.type == WindowEventKeyDown;
+            break;
+        case WindowEventMouseMove:
+            mouseX = event.x;
+            mouseY = event.y;
+            break;
+        }
+    }
+
+    return !isWindowQuitPosted(windowEvents);
 }
 
-int main()
+// Owns every Vulkan object from creation to destruction, the main thread only runs the window backend
+void renderThreadMain()
 {
-    createWindow();
     createGraphics();
     createSurface();
     createSwapchain();
     createShaders();
     createPipeline();
+    createScene();
     createFramebuffers();
-    createCommandPool();
+    createCommandPools();
     createCommandBuffers();
-    recordCommandBuffers();
-    createSemaphores();
+    createSynchronization();
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
 
-    bool running = true;
-    while (running)
+    while (processWindowEvents() && (frameLimit == 0 || frameCount < frameLimit))
     {
-        static MSG msg;
-        while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+        // Nothing to draw into until the window gets restored
+        if (windowMinimized)
         {
-            if (msg.message == WM_QUIT)
-            {
-                running = false;
-            }
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
         }
 
         draw();
     }
 
+    // Once the frame limit is reached the message loop would otherwise keep waiting for the user
+    closeWindow();
+
+    // Includes waiting for the last frames, the figure covers everything the GPU did for them
+    VkResult result = vkDeviceWaitIdle(device);
+    CHECK_VKRESULT(result);
+
+    double elapsedMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    if (frameLimit != 0 && frameCount != 0)
+    {
+        std::cout << frameCount << " frames in " << elapsedMilliseconds << " ms, " << elapsedMilliseconds / double(frameCount) << " ms per frame" << std::endl;
+    }
+
+    // Elided commands are the binds and state changes the recorder found redundant
+    if (frameCount != 0)
+    {
+        uint32_t issuedCommands = getIssuedCommandCount(commandStats);
+        uint32_t elidedCommands = getElidedCommandCount(commandStats);
+        std::cout << "Commands: " << issuedCommands << " issued, " << elidedCommands << " elided, "
+                  << double(issuedCommands) / double(frameCount) << " issued and " << double(elidedCommands) / double(frameCount) << " elided per frame" << std::endl;
+    }
+
+    // Steady state of the transient descriptor pools, the last frame of the first slot stands for all of them
+    DescriptorFrameStats descriptorStats = getDescriptorFrameStats(0);
+    std::cout << "Descriptor sets per frame: " << descriptorStats.setCount << " from " << descriptorStats.poolCount << " pools, "
+              << descriptorStats.poolsCreated << " pools created" << std::endl;
+
+    // Live bytes are the steady state, total allocations over the frame count is the per-frame churn
+    printHostAllocationStats();
+
+    ResourcePoolStats poolStats = getResourcePoolStats();
+    std::cout << "Pooled resources: " << poolStats.bufferCount << " buffers (" << double(poolStats.bufferBytes) / 1048576.0 << " MiB), "
+              << poolStats.imageCount << " images, " << poolStats.pipelineCount << " pipelines, " << poolStats.samplerCount << " samplers" << std::endl;
+
+    printResidencyStats();
+    printDefragmentationStats();
+
     destroyGraphics();
+}
+
+// Usage: "Vulkan Renderer.exe" [--frames <count>] [--present-profile <latency|throughput|power>]
+void parseArguments(int argc, char** argv)
+{
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--frames") == 0)
+        {
+            frameLimit = std::strtoull(argv[i + 1], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--present-profile") == 0)
+        {
+            const char* profile = argv[i + 1];
+            if (std::strcmp(profile, "latency") == 0)
+            {
+                presentProfile = PresentProfileLowestLatency;
+            }
+            else if (std::strcmp(profile, "throughput") == 0)
+            {
+                presentProfile = PresentProfileMaxThroughput;
+            }
+            else if (std::strcmp(profile, "power") == 0)
+            {
+                presentProfile = PresentProfilePowerSaving;
+            }
+            else
+            {
+                std::cout << "Unknown present profile " << profile << ", keeping " << getPresentProfileName(presentProfile) << std::endl;
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    parseArguments(argc, argv);
+
+    createWindow(initialWindowWidth, initialWindowHeight, windowTitle, windowEvents);
+
+    std::thread renderThread(renderThreadMain);
+
+    runWindowMessageLoop();
+
+    renderThread.join();
     destroyWindow();
 
+#ifndef WINDOW_BACKEND_HEADLESS
     std::cin.get();
+#endif
 }
@@ -0,0 +1,384 @@
+// Vulkan Renderer - memory_blocks.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#include "host_allocator.h"
+#include "memory_blocks.h"
+
+struct FreeRange
+{
+    VkDeviceSize offset;
+    VkDeviceSize size;
+};
+
+// memory is VK_NULL_HANDLE for slots whose block went back to the driver
+struct MemoryBlock
+{
+    VkDeviceMemory         memory;
+    VkDeviceSize           size;
+    VkDeviceSize           usedBytes;
+    void*                  mapped;
+    uint32_t               memoryType;
+    uint32_t               allocationCount;
+    bool                   draining;
+    std::vector<FreeRange> freeRanges; // Sorted by offset, neighbours never touch
+};
+
+struct PendingRelease
+{
+    uint64_t     submission;
+    uint32_t     block;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+};
+
+static VkPhysicalDeviceMemoryProperties memoryProperties;
+static std::vector<MemoryBlock>         blocks;
+static std::vector<PendingRelease>      pendingReleases;
+static std::vector<uint32_t>            pendingReleaseCounts; // Per block, reused by addPendingBlockFrees
+static uint64_t                         currentSubmission = 0;
+
+static void freeRange(MemoryBlock& block, VkDeviceSize offset, VkDeviceSize size)
+{
+    auto next = std::lower_bound(block.freeRanges.begin(), block.freeRanges.end(), offset,
+        [](const FreeRange& range, VkDeviceSize rangeOffset) { return range.offset < rangeOffset; });
+
+    bool mergesPrevious = next != block.freeRanges.begin() && (next - 1)->offset + (next - 1)->size == offset;
+    bool mergesNext = next != block.freeRanges.end() && offset + size == next->offset;
+
+    if (mergesPrevious && mergesNext)
+    {
+        (next - 1)->size += size + next->size;
+        block.freeRanges.erase(next);
+    }
+    else if (mergesPrevious)
+    {
+        (next - 1)->size += size;
+    }
+    else if (mergesNext)
+    {
+        next->offset = offset;
+        next->size += size;
+    }
+    else
+    {
+        FreeRange range;
+        range.offset = offset;
+        range.size = size;
+        block.freeRanges.insert(next, range);
+    }
+}
+
+static uint32_t createBlock(VkDevice device, uint32_t memoryType, VkDeviceSize size)
+{
+    uint32_t index = 0;
+    while (index < blocks.size() && blocks[index].memory != VK_NULL_HANDLE)
+    {
+        index++;
+    }
+
+    if (index == blocks.size())
+    {
+        blocks.emplace_back();
+    }
+
+    VkMemoryAllocateInfo memoryAllocateInfo;
+    memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memoryAllocateInfo.pNext = nullptr;
+    memoryAllocateInfo.allocationSize = size;
+    memoryAllocateInfo.memoryTypeIndex = memoryType;
+
+    MemoryBlock& block = blocks[index];
+
+    VkResult result = vkAllocateMemory(device, &memoryAllocateInfo, getHostAllocator(VK_OBJECT_TYPE_DEVICE_MEMORY), &block.memory);
+    if (result != VK_SUCCESS)
+    {
+        block.memory = VK_NULL_HANDLE;
+        return invalidMemoryBlock;
+    }
+
+    block.size = size;
+    block.usedBytes = 0;
+    block.mapped = nullptr;
+    block.memoryType = memoryType;
+    block.allocationCount = 0;
+    block.draining = false;
+    block.freeRanges.clear();
+
+    FreeRange range;
+    range.offset = 0;
+    range.size = size;
+    block.freeRanges.push_back(range);
+
+    if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        result = vkMapMemory(device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped);
+        CHECK_VKRESULT(result);
+    }
+
+    return index;
+}
+
+static void destroyBlock(VkDevice device, MemoryBlock& block)
+{
+    // Freeing the memory implicitly unmaps it
+    vkFreeMemory(device, block.memory, getHostAllocator(VK_OBJECT_TYPE_DEVICE_MEMORY));
+
+    block.memory = VK_NULL_HANDLE;
+    block.mapped = nullptr;
+    block.freeRanges.clear();
+}
+
+void createMemoryBlocks(VkPhysicalDevice physicalDevice)
+{
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+}
+
+bool allocateBlockMemory(VkDevice device, const VkMemoryRequirements& requirements, uint32_t memoryType, MemoryAllocation& allocation)
+{
+    VkDeviceSize size = requirements.size;
+    VkDeviceSize alignment = requirements.alignment;
+
+    uint32_t bestBlock = invalidMemoryBlock;
+    uint32_t bestRange = 0;
+    VkDeviceSize bestWaste = ~VkDeviceSize(0);
+
+    for (uint32_t i = 0; i < blocks.size(); i++)
+    {
+        const MemoryBlock& block = blocks[i];
+        if (block.memory == VK_NULL_HANDLE || block.memoryType != memoryType || block.draining || block.size - block.usedBytes < size)
+        {
+            continue;
+        }
+
+        for (uint32_t j = 0; j < block.freeRanges.size(); j++)
+        {
+            const FreeRange& range = block.freeRanges[j];
+            VkDeviceSize alignedOffset = (range.offset + alignment - 1) / alignment * alignment;
+            if (alignedOffset + size > range.offset + range.size)
+            {
+                continue;
+            }
+
+            VkDeviceSize waste = range.size - size;
+            if (waste < bestWaste)
+            {
+                bestBlock = i;
+                bestRange = j;
+                bestWaste = waste;
+            }
+        }
+    }
+
+    if (bestBlock == invalidMemoryBlock)
+    {
+        bestBlock = createBlock(device, memoryType, std::max(memoryBlockSize, size));
+        bestRange = 0;
+        if (bestBlock == invalidMemoryBlock)
+        {
+            return false;
+        }
+    }
+
+    MemoryBlock& block = blocks[bestBlock];
+    FreeRange range = block.freeRanges[bestRange];
+    block.freeRanges.erase(block.freeRanges.begin() + bestRange);
+
+    VkDeviceSize alignedOffset = (range.offset + alignment - 1) / alignment * alignment;
+
+    // The alignment padding in front and the rest behind stay free
+    if (alignedOffset != range.offset)
+    {
+        freeRange(block, range.offset, alignedOffset - range.offset);
+    }
+
+    if (alignedOffset + size != range.offset + range.size)
+    {
+        freeRange(block, alignedOffset + size, range.offset + range.size - alignedOffset - size);
+    }
+
+    block.usedBytes += size;
+    block.allocationCount++;
+
+    allocation.memory = block.memory;
+    allocation.offset = alignedOffset;
+    allocation.size = size;
+    allocation.mapped = block.mapped != nullptr ? static_cast<char*>(block.mapped) + alignedOffset : nullptr;
+    allocation.block = bestBlock;
+    return true;
+}
+
+void releaseBlockMemory(uint32_t block, VkDeviceSize offset, VkDeviceSize size)
+{
+    PendingRelease pendingRelease;
+    pendingRelease.submission = currentSubmission;
+    pendingRelease.block = block;
+    pendingRelease.offset = offset;
+    pendingRelease.size = size;
+    pendingReleases.push_back(pendingRelease);
+}
+
+void advanceMemoryBlocks(VkDevice device, uint64_t recordingSubmission, uint64_t completedSubmissions)
+{
+    currentSubmission = recordingSubmission;
+
+    uint32_t kept = 0;
+    for (const PendingRelease& pendingRelease : pendingReleases)
+    {
+        if (pendingRelease.submission >= completedSubmissions)
+        {
+            pendingReleases[kept++] = pendingRelease;
+            continue;
+        }
+
+        MemoryBlock& block = blocks[pendingRelease.block];
+        freeRange(block, pendingRelease.offset, pendingRelease.size);
+        block.usedBytes -= pendingRelease.size;
+
+        if (--block.allocationCount == 0)
+        {
+            destroyBlock(device, block);
+        }
+    }
+
+    pendingReleases.resize(kept);
+}
+
+bool isBlockReleasePending(uint32_t block)
+{
+    for (const PendingRelease& pendingRelease : pendingReleases)
+    {
+        if (pendingRelease.block == block)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void addPendingBlockFrees(VkDeviceSize* heapBytes)
+{
+    pendingReleaseCounts.assign(blocks.size(), 0);
+    for (const PendingRelease& pendingRelease : pendingReleases)
+    {
+        pendingReleaseCounts[pendingRelease.block]++;
+    }
+
+    for (uint32_t i = 0; i < uint32_t(blocks.size()); i++)
+    {
+        const MemoryBlock& block = blocks[i];
+        if (block.memory != VK_NULL_HANDLE && block.allocationCount == pendingReleaseCounts[i])
+        {
+            heapBytes[memoryProperties.memoryTypes[block.memoryType].heapIndex] += block.size;
+        }
+    }
+}
+
+void findSparseBlocks(float maxOccupancy, std::vector<uint32_t>& sparseBlocks)
+{
+    size_t first = sparseBlocks.size();
+
+    for (uint32_t i = 0; i < blocks.size(); i++)
+    {
+        if (blocks[i].memory != VK_NULL_HANDLE && double(blocks[i].usedBytes) < double(blocks[i].size) * maxOccupancy)
+        {
+            sparseBlocks.push_back(i);
+        }
+    }
+
+    std::sort(sparseBlocks.begin() + first, sparseBlocks.end(), [](uint32_t a, uint32_t b)
+    {
+        return double(blocks[a].usedBytes) / double(blocks[a].size) < double(blocks[b].usedBytes) / double(blocks[b].size);
+    });
+}
+
+void setBlockDraining(uint32_t block, bool draining)
+{
+    blocks[block].draining = draining;
+}
+
+bool isBlockDraining(uint32_t block)
+{
+    return blocks[block].memory != VK_NULL_HANDLE && blocks[block].draining;
+}
+
+FragmentationReport getFragmentationReport()
+{
+    FragmentationReport report;
+    report.blockCount = 0;
+    report.blockBytes = 0;
+    report.usedBytes = 0;
+    report.largestFreeRange = 0;
+
+    // Ranges waiting for their frames count as used, so the free bytes may be split over more ranges than that
+    VkDeviceSize freeBytes = 0;
+    for (const MemoryBlock& block : blocks)
+    {
+        if (block.memory == VK_NULL_HANDLE)
+        {
+            continue;
+        }
+
+        report.blockCount++;
+        report.blockBytes += block.size;
+        report.usedBytes += block.usedBytes;
+
+        for (const FreeRange& range : block.freeRanges)
+        {
+            freeBytes += range.size;
+            report.largestFreeRange = std::max(report.largestFreeRange, range.size);
+        }
+    }
+
+    report.fragmentation = freeBytes != 0 ? 1.0f - float(double(report.largestFreeRange) / double(freeBytes)) : 0.0f;
+    return report;
+}
+
+void printFragmentationReport(const char* label, const FragmentationReport& report)
+{
+    const std::ios_base::fmtflags flags = std::cout.flags();
+    const std::streamsize precision = std::cout.precision();
+
+    std::cout << std::fixed << std::setprecision(1) << label << ": " << report.blockCount << " blocks, "
+              << double(report.usedBytes) / 1048576.0 << " of " << double(report.blockBytes) / 1048576.0 << " MiB used, largest free range "
+              << double(report.largestFreeRange) / 1048576.0 << " MiB, fragmentation " << std::setprecision(2) << report.fragmentation << '\n';
+
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
+
+void destroyMemoryBlocks(VkDevice device)
+{
+    for (MemoryBlock& block : blocks)
+    {
+        if (block.memory != VK_NULL_HANDLE)
+        {
+            destroyBlock(device, block);
+        }
+    }
+
+    blocks.clear();
+    pendingReleases.clear();
+}
@@ -0,0 +1,87 @@
+// Vulkan Renderer - memory_blocks.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _MEMORY_BLOCKS_H_
+#define _MEMORY_BLOCKS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "vkdefines.h"
+
+constexpr VkDeviceSize memoryBlockSize = VkDeviceSize(64) << 20;
+constexpr uint32_t invalidMemoryBlock = ~0u;
+
+struct MemoryAllocation
+{
+    VkDeviceMemory memory;
+    VkDeviceSize   offset;
+    VkDeviceSize   size;
+    void*          mapped; // Into the persistent mapping of host visible blocks, nullptr otherwise
+    uint32_t       block;
+};
+
+struct FragmentationReport
+{
+    uint32_t     blockCount;
+    VkDeviceSize blockBytes;
+    VkDeviceSize usedBytes;        // Includes ranges released by frames still in flight
+    VkDeviceSize largestFreeRange;
+    float        fragmentation;    // 1 - largest free range / free bytes, 0 when the free memory is one range
+};
+
+// Buffers of many sizes share 64 MiB blocks per memory type, larger ones get a block of their own. Blocks hold
+// buffers only, so no buffer-image granularity applies. Render thread only.
+
+void createMemoryBlocks(VkPhysicalDevice physicalDevice);
+
+// Best fit over the blocks of memoryType that are not draining, allocates a new block if none has room
+bool allocateBlockMemory(VkDevice device, const VkMemoryRequirements& requirements, uint32_t memoryType, MemoryAllocation& allocation);
+
+// The range becomes free once the frames that may still use it completed, blocks left empty go back to the driver
+void releaseBlockMemory(uint32_t block, VkDeviceSize offset, VkDeviceSize size);
+
+// Once per frame after waiting for the frame's fence, numbered like advanceDeferredDestruction
+void advanceMemoryBlocks(VkDevice device, uint64_t recordingSubmission, uint64_t completedSubmissions);
+
+bool isBlockReleasePending(uint32_t block);
+
+// Adds the size of every block whose remaining allocations are all pending releases to heapBytes, indexed by
+// heap. Those blocks go back to the driver once the releases retire, a released range alone frees nothing.
+void addPendingBlockFrees(VkDeviceSize* heapBytes);
+
+// Blocks in use below maxOccupancy, emptiest first. Appends to blocks.
+void findSparseBlocks(float maxOccupancy, std::vector<uint32_t>& blocks);
+
+// Draining blocks get no new allocations, so moving their contents elsewhere empties them. Blocks that went
+// back to the driver are not draining, neither is a new block that reuses their index.
+void setBlockDraining(uint32_t block, bool draining);
+bool isBlockDraining(uint32_t block);
+
+FragmentationReport getFragmentationReport();
+void printFragmentationReport(const char* label, const FragmentationReport& report);
+
+// After vkDeviceWaitIdle, frees all blocks whether empty or not
+void destroyMemoryBlocks(VkDevice device);
+
+#endif // !_MEMORY_BLOCKS_H_
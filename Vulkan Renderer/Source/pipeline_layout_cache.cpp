@@ -0,0 +1,228 @@
+// Vulkan Renderer - pipeline_layout_cache.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "host_allocator.h"
+#include "pipeline_layout_cache.h"
+#include "utility.h"
+
+// Keys are the serialized create infos, the hash only picks the bucket so collisions stay harmless
+typedef std::vector<uint64_t> LayoutKey;
+
+struct LayoutKeyHash
+{
+    size_t operator()(const LayoutKey& key) const
+    {
+        return size_t(hashBytes(key.data(), key.size() * sizeof(uint64_t)));
+    }
+};
+
+static std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> descriptorSetLayouts;
+static std::unordered_map<LayoutKey, VkPipelineLayout, LayoutKeyHash>      pipelineLayouts;
+static std::vector<VkDescriptorSetLayout>                                  reservedSetLayouts;
+
+VkDescriptorSetLayout getDescriptorSetLayout(VkDevice device, const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount)
+{
+    LayoutKey key;
+    key.reserve(size_t(bindingCount) * 4);
+
+    for (uint32_t i = 0; i < bindingCount; i++)
+    {
+        key.push_back(bindings[i].binding);
+        key.push_back(bindings[i].descriptorType);
+        key.push_back(bindings[i].descriptorCount);
+        key.push_back(bindings[i].stageFlags);
+    }
+
+    auto it = descriptorSetLayouts.find(key);
+    if (it != descriptorSetLayouts.end())
+    {
+        return it->second;
+    }
+
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo;
+    descriptorSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptorSetLayoutCreateInfo.pNext = nullptr;
+    descriptorSetLayoutCreateInfo.flags = 0;
+    descriptorSetLayoutCreateInfo.bindingCount = bindingCount;
+    descriptorSetLayoutCreateInfo.pBindings = bindings;
+
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkResult result = vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCreateInfo, getHostAllocator(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT), &descriptorSetLayout);
+    CHECK_VKRESULT(result);
+
+    descriptorSetLayouts.emplace(std::move(key), descriptorSetLayout);
+    return descriptorSetLayout;
+}
+
+void setReservedDescriptorSetLayout(uint32_t set, VkDescriptorSetLayout layout)
+{
+    if (set >= reservedSetLayouts.size())
+    {
+        reservedSetLayouts.resize(size_t(set) + 1, VK_NULL_HANDLE);
+    }
+
+    reservedSetLayouts[set] = layout;
+}
+
+VkPipelineLayout getPipelineLayout(VkDevice device, const ShaderReflection* reflections, uint32_t reflectionCount)
+{
+    std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets;
+
+    VkPushConstantRange pushConstantRange;
+    pushConstantRange.stageFlags = 0;
+    pushConstantRange.offset = ~0u;
+    pushConstantRange.size = 0;
+
+    uint32_t pushConstantEnd = 0;
+
+    for (uint32_t i = 0; i < reflectionCount; i++)
+    {
+        for (const ReflectedDescriptorBinding& reflectedBinding : reflections[i].descriptorBindings)
+        {
+            if (reflectedBinding.set >= sets.size())
+            {
+                sets.resize(size_t(reflectedBinding.set) + 1);
+            }
+
+            std::vector<VkDescriptorSetLayoutBinding>& set = sets[reflectedBinding.set];
+
+            auto it = std::find_if(set.begin(), set.end(), [&](const VkDescriptorSetLayoutBinding& binding)
+            {
+                return binding.binding == reflectedBinding.binding;
+            });
+
+            if (it != set.end())
+            {
+                if (it->descriptorType != reflectedBinding.descriptorType || it->descriptorCount != reflectedBinding.descriptorCount)
+                {
+                    __debugbreak(); // Stages disagree about the resource bound here
+                }
+                it->stageFlags |= reflectedBinding.stageFlags;
+                continue;
+            }
+
+            VkDescriptorSetLayoutBinding binding;
+            binding.binding = reflectedBinding.binding;
+            binding.descriptorType = reflectedBinding.descriptorType;
+            binding.descriptorCount = reflectedBinding.descriptorCount;
+            binding.stageFlags = reflectedBinding.stageFlags;
+            binding.pImmutableSamplers = nullptr;
+
+            set.push_back(binding);
+        }
+
+        // All stages share a single range, which keeps layouts compatible across pipelines with different stage usage
+        for (const VkPushConstantRange& range : reflections[i].pushConstantRanges)
+        {
+            pushConstantRange.stageFlags |= range.stageFlags;
+            pushConstantRange.offset = std::min(pushConstantRange.offset, range.offset);
+            pushConstantEnd = std::max(pushConstantEnd, range.offset + range.size);
+        }
+    }
+
+    if (pushConstantRange.stageFlags != 0)
+    {
+        pushConstantRange.size = pushConstantEnd - pushConstantRange.offset;
+    }
+
+    for (size_t i = 0; i < reservedSetLayouts.size(); i++)
+    {
+        if (reservedSetLayouts[i] != VK_NULL_HANDLE && i >= sets.size())
+        {
+            sets.resize(i + 1);
+        }
+    }
+
+    // Unused set indices below the highest used one still need a (empty) layout
+    std::vector<VkDescriptorSetLayout> setLayouts(sets.size());
+    for (size_t i = 0; i < sets.size(); i++)
+    {
+        if (i < reservedSetLayouts.size() && reservedSetLayouts[i] != VK_NULL_HANDLE)
+        {
+            setLayouts[i] = reservedSetLayouts[i];
+            continue;
+        }
+
+        std::sort(sets[i].begin(), sets[i].end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+        {
+            return a.binding < b.binding;
+        });
+
+        setLayouts[i] = getDescriptorSetLayout(device, sets[i].data(), uint32_t(sets[i].size()));
+    }
+
+    LayoutKey key;
+    key.reserve(setLayouts.size() + 3);
+
+    for (VkDescriptorSetLayout setLayout : setLayouts)
+    {
+        key.push_back(uint64_t(setLayout));
+    }
+
+    if (pushConstantRange.stageFlags != 0)
+    {
+        key.push_back(pushConstantRange.stageFlags);
+        key.push_back(pushConstantRange.offset);
+        key.push_back(pushConstantRange.size);
+    }
+
+    auto it = pipelineLayouts.find(key);
+    if (it != pipelineLayouts.end())
+    {
+        return it->second;
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo;
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.pNext = nullptr;
+    pipelineLayoutCreateInfo.flags = 0;
+    pipelineLayoutCreateInfo.setLayoutCount = uint32_t(setLayouts.size());
+    pipelineLayoutCreateInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutCreateInfo.pushConstantRangeCount = pushConstantRange.stageFlags != 0 ? 1 : 0;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+    VkPipelineLayout pipelineLayout;
+    VkResult result = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, getHostAllocator(VK_OBJECT_TYPE_PIPELINE_LAYOUT), &pipelineLayout);
+    CHECK_VKRESULT(result);
+
+    pipelineLayouts.emplace(std::move(key), pipelineLayout);
+    return pipelineLayout;
+}
+
+void destroyPipelineLayoutCache(VkDevice device)
+{
+    for (auto& entry : pipelineLayouts)
+    {
+        vkDestroyPipelineLayout(device, entry.second, getHostAllocator(VK_OBJECT_TYPE_PIPELINE_LAYOUT));
+    }
+
+    for (auto& entry : descriptorSetLayouts)
+    {
+        vkDestroyDescriptorSetLayout(device, entry.second, getHostAllocator(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
+    }
+
+    pipelineLayouts.clear();
+    descriptorSetLayouts.clear();
+}
@@ -0,0 +1,42 @@
+// Vulkan Renderer - pipeline_layout_cache.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _PIPELINE_LAYOUT_CACHE_H_
+#define _PIPELINE_LAYOUT_CACHE_H_
+
+#include "spirv_reflection.h"
+#include "vkdefines.h"
+
+// Layouts returned from here are owned by the cache, identical requests return the same handle
+VkDescriptorSetLayout getDescriptorSetLayout(VkDevice device, const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount);
+
+// Puts layout at the given set index of every pipeline layout created afterwards, whatever the
+// shaders declare there. Used for sets bound once and shared by all pipelines. Pass VK_NULL_HANDLE to clear.
+void setReservedDescriptorSetLayout(uint32_t set, VkDescriptorSetLayout layout);
+
+// Merges the resources of all stages into one pipeline layout
+VkPipelineLayout getPipelineLayout(VkDevice device, const ShaderReflection* reflections, uint32_t reflectionCount);
+
+void destroyPipelineLayoutCache(VkDevice device);
+
+#endif // !_PIPELINE_LAYOUT_CACHE_H_
@@ -0,0 +1,420 @@
+// Vulkan Renderer - pipeline_library.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "deferred_destruction.h"
+#include "host_allocator.h"
+#include "pipeline_library.h"
+#include "utility.h"
+
+#ifdef VK_EXT_graphics_pipeline_library
+
+constexpr uint32_t vertexInputPart = 0;
+constexpr uint32_t preRasterizationPart = 1;
+constexpr uint32_t fragmentShaderPart = 2;
+constexpr uint32_t fragmentOutputPart = 3;
+constexpr uint32_t libraryPartCount = 4;
+
+struct PipelineLibraryEntry
+{
+    PipelineStateDescription key;
+    VkPipeline               library;
+};
+
+struct OptimizeJob
+{
+    VkDevice                 device;
+    VkPipelineLayout         layout;
+    VkPipeline               libraries[libraryPartCount];
+    std::atomic<VkPipeline>* target;
+};
+
+static VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT graphicsPipelineLibraryFeatures;
+static bool graphicsPipelineLibraryEnabled = false;
+
+static std::unordered_multimap<uint64_t, PipelineLibraryEntry> libraryParts[libraryPartCount];
+static std::mutex                                              libraryMutex;
+
+static std::thread              compilerThread;
+static std::deque<OptimizeJob>  compilerJobs;
+static std::mutex               compilerMutex;
+static std::condition_variable  compilerCondition;
+static bool                     compilerStopping = false;
+
+static bool hasExtension(const VkExtensionProperties* extensions, uint32_t extensionCount, const char* name)
+{
+    for (uint32_t i = 0; i < extensionCount; i++)
+    {
+        if (std::strcmp(extensions[i].extensionName, name) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void requestGraphicsPipelineLibrary(
+    VkPhysicalDevice physicalDevice,
+    const VkExtensionProperties* extensions,
+    uint32_t extensionCount,
+    std::vector<const char*>& enabledExtensions,
+    void*& featureChain)
+{
+    graphicsPipelineLibraryEnabled = false;
+
+    if (!hasExtension(extensions, extensionCount, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME) ||
+        !hasExtension(extensions, extensionCount, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME))
+    {
+        return;
+    }
+
+    graphicsPipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    graphicsPipelineLibraryFeatures.pNext = nullptr;
+    graphicsPipelineLibraryFeatures.graphicsPipelineLibrary = VK_FALSE;
+
+    VkPhysicalDeviceFeatures2 features;
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &graphicsPipelineLibraryFeatures;
+
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+    VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT graphicsPipelineLibraryProperties;
+    graphicsPipelineLibraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+    graphicsPipelineLibraryProperties.pNext = nullptr;
+
+    VkPhysicalDeviceProperties2 properties;
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &graphicsPipelineLibraryProperties;
+
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    // Without fast linking a linked pipeline costs about as much as a monolithic one
+    if (graphicsPipelineLibraryFeatures.graphicsPipelineLibrary != VK_TRUE ||
+        graphicsPipelineLibraryProperties.graphicsPipelineLibraryFastLinking != VK_TRUE)
+    {
+        return;
+    }
+
+    graphicsPipelineLibraryFeatures.pNext = featureChain;
+    featureChain = &graphicsPipelineLibraryFeatures;
+
+    enabledExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+    enabledExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+    graphicsPipelineLibraryEnabled = true;
+}
+
+bool isGraphicsPipelineLibraryEnabled()
+{
+    return graphicsPipelineLibraryEnabled;
+}
+
+// Copies the fields a part depends on into an otherwise zeroed description, which then serves as its key
+static PipelineStateDescription getPartKey(const PipelineStateDescription& state, uint32_t part)
+{
+    PipelineStateDescription key;
+    std::memset(&key, 0, sizeof(PipelineStateDescription));
+
+    switch (part)
+    {
+    case vertexInputPart:
+        key.vertexBindingCount = state.vertexBindingCount;
+        key.vertexAttributeCount = state.vertexAttributeCount;
+        std::memcpy(key.vertexBindings, state.vertexBindings, sizeof(key.vertexBindings));
+        std::memcpy(key.vertexAttributes, state.vertexAttributes, sizeof(key.vertexAttributes));
+        key.topology = state.topology;
+        key.primitiveRestartEnable = state.primitiveRestartEnable;
+        break;
+    case preRasterizationPart:
+        key.vertexShader = state.vertexShader;
+        key.vertexConstants = state.vertexConstants;
+        key.layout = state.layout;
+        key.colorFormat = state.colorFormat;
+        key.depthFormat = state.depthFormat;
+        key.subpass = state.subpass;
+        key.polygonMode = state.polygonMode;
+        key.cullMode = state.cullMode;
+        key.frontFace = state.frontFace;
+        break;
+    case fragmentShaderPart:
+        key.fragmentShader = state.fragmentShader;
+        key.fragmentConstants = state.fragmentConstants;
+        key.layout = state.layout;
+        key.colorFormat = state.colorFormat;
+        key.depthFormat = state.depthFormat;
+        key.subpass = state.subpass;
+        key.rasterizationSamples = state.rasterizationSamples;
+        key.depthTestEnable = state.depthTestEnable;
+        key.depthWriteEnable = state.depthWriteEnable;
+        key.depthCompareOp = state.depthCompareOp;
+        break;
+    case fragmentOutputPart:
+        key.colorFormat = state.colorFormat;
+        key.depthFormat = state.depthFormat;
+        key.subpass = state.subpass;
+        key.rasterizationSamples = state.rasterizationSamples;
+        key.blendEnable = state.blendEnable;
+        key.srcColorBlendFactor = state.srcColorBlendFactor;
+        key.dstColorBlendFactor = state.dstColorBlendFactor;
+        key.colorBlendOp = state.colorBlendOp;
+        key.srcAlphaBlendFactor = state.srcAlphaBlendFactor;
+        key.dstAlphaBlendFactor = state.dstAlphaBlendFactor;
+        key.alphaBlendOp = state.alphaBlendOp;
+        key.colorWriteMask = state.colorWriteMask;
+        break;
+    default:
+        __debugbreak();
+    }
+
+    return key;
+}
+
+static VkPipeline createLibraryPart(VkDevice device, const PipelineStateDescription& key, uint32_t part, VkRenderPass renderPass)
+{
+    PipelineCreateInfoStorage storage;
+    fillPipelineCreateInfo(key, renderPass, storage);
+
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryCreateInfo;
+    libraryCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+    libraryCreateInfo.pNext = nullptr;
+
+    // Only the state belonging to the part is passed in, everything else stays null
+    VkGraphicsPipelineCreateInfo& pipelineCreateInfo = storage.pipelineCreateInfo;
+    pipelineCreateInfo.pNext = &libraryCreateInfo;
+    pipelineCreateInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+    pipelineCreateInfo.stageCount = 0;
+    pipelineCreateInfo.pStages = nullptr;
+    pipelineCreateInfo.pVertexInputState = nullptr;
+    pipelineCreateInfo.pInputAssemblyState = nullptr;
+    pipelineCreateInfo.pViewportState = nullptr;
+    pipelineCreateInfo.pRasterizationState = nullptr;
+    pipelineCreateInfo.pMultisampleState = nullptr;
+    pipelineCreateInfo.pDepthStencilState = nullptr;
+    pipelineCreateInfo.pColorBlendState = nullptr;
+
+    switch (part)
+    {
+    case vertexInputPart:
+        libraryCreateInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT;
+        pipelineCreateInfo.pVertexInputState = &storage.vertexInputCreateInfo;
+        pipelineCreateInfo.pInputAssemblyState = &storage.inputAssemblyCreateInfo;
+        pipelineCreateInfo.pDynamicState = nullptr;
+        pipelineCreateInfo.layout = VK_NULL_HANDLE;
+        pipelineCreateInfo.renderPass = VK_NULL_HANDLE;
+        break;
+    case preRasterizationPart:
+        libraryCreateInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+        pipelineCreateInfo.stageCount = 1;
+        pipelineCreateInfo.pStages = &storage.shaderStages[0];
+        pipelineCreateInfo.pViewportState = &storage.viewportStateCreateInfo;
+        pipelineCreateInfo.pRasterizationState = &storage.rasterizationStateCreateInfo;
+        break;
+    case fragmentShaderPart:
+        libraryCreateInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+        pipelineCreateInfo.stageCount = key.fragmentShader != VK_NULL_HANDLE ? 1 : 0;
+        pipelineCreateInfo.pStages = &storage.shaderStages[1];
+        pipelineCreateInfo.pMultisampleState = &storage.multisampleStateCreateInfo;
+        pipelineCreateInfo.pDepthStencilState = key.depthFormat != VK_FORMAT_UNDEFINED ? &storage.depthStencilStateCreateInfo : nullptr;
+        break;
+    case fragmentOutputPart:
+        libraryCreateInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+        pipelineCreateInfo.pMultisampleState = &storage.multisampleStateCreateInfo;
+        pipelineCreateInfo.pColorBlendState = &storage.colorBlendStateCreateInfo;
+        pipelineCreateInfo.layout = VK_NULL_HANDLE;
+        break;
+    default:
+        __debugbreak();
+    }
+
+    VkPipeline library;
+    VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, getHostAllocator(VK_OBJECT_TYPE_PIPELINE), &library);
+    CHECK_VKRESULT(result);
+
+    return library;
+}
+
+static void getLibraryParts(VkDevice device, const PipelineStateDescription& state, VkRenderPass renderPass, VkPipeline* libraries)
+{
+    std::lock_guard<std::mutex> lock(libraryMutex);
+
+    for (uint32_t part = 0; part < libraryPartCount; part++)
+    {
+        const PipelineStateDescription key = getPartKey(state, part);
+        const uint64_t hash = hashBytes(&key, sizeof(PipelineStateDescription));
+
+        libraries[part] = VK_NULL_HANDLE;
+
+        auto range = libraryParts[part].equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (std::memcmp(&it->second.key, &key, sizeof(PipelineStateDescription)) == 0)
+            {
+                libraries[part] = it->second.library;
+                break;
+            }
+        }
+
+        if (libraries[part] == VK_NULL_HANDLE)
+        {
+            libraries[part] = createLibraryPart(device, key, part, renderPass);
+            libraryParts[part].emplace(hash, PipelineLibraryEntry{ key, libraries[part] });
+        }
+    }
+}
+
+static VkPipeline linkLibraries(VkDevice device, VkPipelineLayout layout, const VkPipeline* libraries, VkPipelineCreateFlags flags)
+{
+    VkPipelineLibraryCreateInfoKHR libraryCreateInfo;
+    libraryCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    libraryCreateInfo.pNext = nullptr;
+    libraryCreateInfo.libraryCount = libraryPartCount;
+    libraryCreateInfo.pLibraries = libraries;
+
+    VkGraphicsPipelineCreateInfo pipelineCreateInfo;
+    std::memset(&pipelineCreateInfo, 0, sizeof(VkGraphicsPipelineCreateInfo));
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.pNext = &libraryCreateInfo;
+    pipelineCreateInfo.flags = flags;
+    pipelineCreateInfo.layout = layout;
+    pipelineCreateInfo.renderPass = VK_NULL_HANDLE;
+    pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineCreateInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, getHostAllocator(VK_OBJECT_TYPE_PIPELINE), &pipeline);
+    CHECK_VKRESULT(result);
+
+    return pipeline;
+}
+
+VkPipeline linkPipeline(VkDevice device, const PipelineStateDescription& state, VkRenderPass renderPass)
+{
+    VkPipeline libraries[libraryPartCount];
+    getLibraryParts(device, state, renderPass, libraries);
+
+    return linkLibraries(device, state.layout, libraries, 0);
+}
+
+static void runCompiler()
+{
+    while (true)
+    {
+        OptimizeJob job;
+        {
+            std::unique_lock<std::mutex> lock(compilerMutex);
+            compilerCondition.wait(lock, [] { return compilerStopping || !compilerJobs.empty(); });
+
+            if (compilerStopping)
+            {
+                return;
+            }
+
+            job = compilerJobs.front();
+            compilerJobs.pop_front();
+        }
+
+        VkPipeline optimized = linkLibraries(job.device, job.layout, job.libraries, VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT);
+        VkPipeline replaced = job.target->exchange(optimized, std::memory_order_acq_rel);
+
+        // Command buffers recorded earlier may still reference the fast linked pipeline
+        deferDestruction(VK_OBJECT_TYPE_PIPELINE, uint64_t(replaced));
+    }
+}
+
+void optimizePipelineAsync(VkDevice device, const PipelineStateDescription& state, VkRenderPass renderPass, std::atomic<VkPipeline>* target)
+{
+    OptimizeJob job;
+    job.device = device;
+    job.layout = state.layout;
+    job.target = target;
+    getLibraryParts(device, state, renderPass, job.libraries);
+
+    std::lock_guard<std::mutex> lock(compilerMutex);
+
+    if (!compilerThread.joinable())
+    {
+        compilerStopping = false;
+        compilerThread = std::thread(runCompiler);
+    }
+
+    compilerJobs.push_back(job);
+    compilerCondition.notify_one();
+}
+
+void destroyPipelineLibraries(VkDevice device)
+{
+    {
+        std::lock_guard<std::mutex> lock(compilerMutex);
+        compilerStopping = true;
+        compilerJobs.clear(); // Anything not started yet keeps its fast linked pipeline
+    }
+
+    compilerCondition.notify_one();
+
+    if (compilerThread.joinable())
+    {
+        compilerThread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(libraryMutex);
+
+    for (uint32_t part = 0; part < libraryPartCount; part++)
+    {
+        for (auto& entry : libraryParts[part])
+        {
+            vkDestroyPipeline(device, entry.second.library, getHostAllocator(VK_OBJECT_TYPE_PIPELINE));
+        }
+        libraryParts[part].clear();
+    }
+}
+
+#else
+
+void requestGraphicsPipelineLibrary(VkPhysicalDevice, const VkExtensionProperties*, uint32_t, std::vector<const char*>&, void*&)
+{
+}
+
+bool isGraphicsPipelineLibraryEnabled()
+{
+    return false;
+}
+
+VkPipeline linkPipeline(VkDevice, const PipelineStateDescription&, VkRenderPass)
+{
+    __debugbreak(); // Never enabled without the extension headers
+    return VK_NULL_HANDLE;
+}
+
+void optimizePipelineAsync(VkDevice, const PipelineStateDescription&, VkRenderPass, std::atomic<VkPipeline>*)
+{
+    __debugbreak();
+}
+
+void destroyPipelineLibraries(VkDevice)
+{
+}
+
+#endif // VK_EXT_graphics_pipeline_library
@@ -0,0 +1,57 @@
+// Vulkan Renderer - pipeline_library.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _PIPELINE_LIBRARY_H_
+#define _PIPELINE_LIBRARY_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "pipeline_state_cache.h"
+#include "vkdefines.h"
+
+// Appends VK_EXT_graphics_pipeline_library and its dependencies when the device supports fast linking.
+// Without the extension (or with headers that predate it) pipelines are compiled monolithically.
+void requestGraphicsPipelineLibrary(
+    VkPhysicalDevice physicalDevice,
+    const VkExtensionProperties* extensions,
+    uint32_t extensionCount,
+    std::vector<const char*>& enabledExtensions,
+    void*& featureChain
+);
+
+bool isGraphicsPipelineLibraryEnabled();
+
+// Links a pipeline from the vertex input, pre-rasterization, fragment shader and fragment output
+// parts of the state. Parts are compiled once and shared by every state that agrees on them.
+VkPipeline linkPipeline(VkDevice device, const PipelineStateDescription& state, VkRenderPass renderPass);
+
+// Queues a link time optimized build of the state on the background compiler, which swaps it into
+// target once it is done. The replaced pipeline goes to the deferred destruction queue.
+void optimizePipelineAsync(VkDevice device, const PipelineStateDescription& state, VkRenderPass renderPass, std::atomic<VkPipeline>* target);
+
+// Stops the background compiler and destroys all parts. Call before flushing the deferred destruction queue.
+void destroyPipelineLibraries(VkDevice device);
+
+#endif // !_PIPELINE_LIBRARY_H_
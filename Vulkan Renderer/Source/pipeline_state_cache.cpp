@@ -0,0 +1,447 @@
+// Vulkan Renderer - pipeline_state_cache.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+#include "dynamic_state.h"
+#include "host_allocator.h"
+#include "pipeline_library.h"
+#include "pipeline_state_cache.h"
+#include "utility.h"
+
+struct PipelineCacheEntry
+{
+    uint64_t                 hash;
+    PipelineStateDescription state;
+    std::atomic<VkPipeline>  pipeline;
+};
+
+// Open addressing table of entry pointers. Slots only ever go from empty to filled and entries are
+// never removed while the renderer runs, so readers need no synchronization beyond acquire loads.
+struct PipelineCacheTable
+{
+    uint32_t                          capacity;
+    std::atomic<PipelineCacheEntry*>* slots;
+};
+
+constexpr uint32_t initialTableCapacity = 64;
+
+static std::atomic<PipelineCacheTable*> currentTable{ nullptr };
+static std::vector<PipelineCacheTable*> tables; // Replaced tables stay alive, readers may still be probing them
+static std::vector<PipelineCacheEntry*> entries;
+static std::mutex                       insertMutex;
+
+void initPipelineState(PipelineStateDescription& state)
+{
+    std::memset(&state, 0, sizeof(PipelineStateDescription));
+
+    initSpecializationConstants(state.vertexConstants);
+    initSpecializationConstants(state.fragmentConstants);
+
+    state.colorFormat = VK_FORMAT_UNDEFINED;
+    state.depthFormat = VK_FORMAT_UNDEFINED;
+
+    state.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    state.primitiveRestartEnable = VK_FALSE;
+    state.polygonMode = VK_POLYGON_MODE_FILL;
+    state.cullMode = VK_CULL_MODE_BACK_BIT;
+    state.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    state.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    state.depthTestEnable = VK_FALSE;
+    state.depthWriteEnable = VK_FALSE;
+    state.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+    state.blendEnable = VK_TRUE;
+    state.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    state.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    state.colorBlendOp = VK_BLEND_OP_ADD;
+    state.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    state.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    state.alphaBlendOp = VK_BLEND_OP_ADD;
+    state.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+}
+
+void setVertexInputState(
+    PipelineStateDescription& state,
+    const std::vector<VkVertexInputBindingDescription>& bindings,
+    const std::vector<VkVertexInputAttributeDescription>& attributes)
+{
+    if (bindings.size() > maxVertexBindings || attributes.size() > maxVertexAttributes)
+    {
+        __debugbreak();
+        return;
+    }
+
+    std::memset(state.vertexBindings, 0, sizeof(state.vertexBindings));
+    std::memset(state.vertexAttributes, 0, sizeof(state.vertexAttributes));
+
+    state.vertexBindingCount = uint32_t(bindings.size());
+    for (size_t i = 0; i < bindings.size(); i++)
+    {
+        state.vertexBindings[i].stride = uint16_t(bindings[i].stride);
+        state.vertexBindings[i].binding = uint8_t(bindings[i].binding);
+        state.vertexBindings[i].inputRate = uint8_t(bindings[i].inputRate);
+    }
+
+    state.vertexAttributeCount = uint32_t(attributes.size());
+    for (size_t i = 0; i < attributes.size(); i++)
+    {
+        state.vertexAttributes[i].format = uint32_t(attributes[i].format);
+        state.vertexAttributes[i].offset = uint16_t(attributes[i].offset);
+        state.vertexAttributes[i].location = uint8_t(attributes[i].location);
+        state.vertexAttributes[i].binding = uint8_t(attributes[i].binding);
+    }
+}
+
+// States that only differ in what is set dynamically map to the same pipeline
+static PipelineStateDescription getPipelineKey(const PipelineStateDescription& state)
+{
+    PipelineStateDescription key = state;
+
+    if (isExtendedDynamicStateEnabled())
+    {
+        key.cullMode = 0;
+        key.frontFace = 0;
+        key.depthTestEnable = 0;
+        key.depthWriteEnable = 0;
+        key.depthCompareOp = 0;
+    }
+
+    return key;
+}
+
+uint64_t hashPipelineState(const PipelineStateDescription& state)
+{
+    const PipelineStateDescription key = getPipelineKey(state);
+    return hashBytes(&key, sizeof(PipelineStateDescription));
+}
+
+void fillPipelineCreateInfo(const PipelineStateDescription& state, VkRenderPass renderPass, PipelineCreateInfoStorage& storage)
+{
+    storage.vertexSpecializationInfo = getSpecializationInfo(state.vertexConstants, storage.vertexMapEntries);
+    storage.fragmentSpecializationInfo = getSpecializationInfo(state.fragmentConstants, storage.fragmentMapEntries);
+
+    VkPipelineShaderStageCreateInfo& vertexStateCreateInfo = storage.shaderStages[0];
+    vertexStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertexStateCreateInfo.pNext = nullptr;
+    vertexStateCreateInfo.flags = 0;
+    vertexStateCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertexStateCreateInfo.module = state.vertexShader;
+    vertexStateCreateInfo.pName = "main";
+    vertexStateCreateInfo.pSpecializationInfo = &storage.vertexSpecializationInfo;
+
+    VkPipelineShaderStageCreateInfo& fragmentStateCreateInfo = storage.shaderStages[1];
+    fragmentStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragmentStateCreateInfo.pNext = nullptr;
+    fragmentStateCreateInfo.flags = 0;
+    fragmentStateCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragmentStateCreateInfo.module = state.fragmentShader;
+    fragmentStateCreateInfo.pName = "main";
+    fragmentStateCreateInfo.pSpecializationInfo = &storage.fragmentSpecializationInfo;
+
+    for (uint32_t i = 0; i < state.vertexBindingCount; i++)
+    {
+        storage.vertexBindings[i].binding = state.vertexBindings[i].binding;
+        storage.vertexBindings[i].stride = state.vertexBindings[i].stride;
+        storage.vertexBindings[i].inputRate = VkVertexInputRate(state.vertexBindings[i].inputRate);
+    }
+
+    for (uint32_t i = 0; i < state.vertexAttributeCount; i++)
+    {
+        storage.vertexAttributes[i].location = state.vertexAttributes[i].location;
+        storage.vertexAttributes[i].binding = state.vertexAttributes[i].binding;
+        storage.vertexAttributes[i].format = VkFormat(state.vertexAttributes[i].format);
+        storage.vertexAttributes[i].offset = state.vertexAttributes[i].offset;
+    }
+
+    storage.vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    storage.vertexInputCreateInfo.pNext = nullptr;
+    storage.vertexInputCreateInfo.flags = 0;
+    storage.vertexInputCreateInfo.vertexBindingDescriptionCount = state.vertexBindingCount;
+    storage.vertexInputCreateInfo.pVertexBindingDescriptions = storage.vertexBindings;
+    storage.vertexInputCreateInfo.vertexAttributeDescriptionCount = state.vertexAttributeCount;
+    storage.vertexInputCreateInfo.pVertexAttributeDescriptions = storage.vertexAttributes;
+
+    storage.inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    storage.inputAssemblyCreateInfo.pNext = nullptr;
+    storage.inputAssemblyCreateInfo.flags = 0;
+    storage.inputAssemblyCreateInfo.topology = VkPrimitiveTopology(state.topology);
+    storage.inputAssemblyCreateInfo.primitiveRestartEnable = state.primitiveRestartEnable;
+
+    storage.viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    storage.viewportStateCreateInfo.pNext = nullptr;
+    storage.viewportStateCreateInfo.flags = 0;
+    storage.viewportStateCreateInfo.viewportCount = 1;
+    storage.viewportStateCreateInfo.pViewports = nullptr; // Dynamic
+    storage.viewportStateCreateInfo.scissorCount = 1;
+    storage.viewportStateCreateInfo.pScissors = nullptr; // Dynamic
+
+    storage.rasterizationStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    storage.rasterizationStateCreateInfo.pNext = nullptr;
+    storage.rasterizationStateCreateInfo.flags = 0;
+    storage.rasterizationStateCreateInfo.depthClampEnable = VK_FALSE;
+    storage.rasterizationStateCreateInfo.rasterizerDiscardEnable = VK_FALSE;
+    storage.rasterizationStateCreateInfo.polygonMode = VkPolygonMode(state.polygonMode);
+    storage.rasterizationStateCreateInfo.cullMode = state.cullMode;
+    storage.rasterizationStateCreateInfo.frontFace = VkFrontFace(state.frontFace);
+    storage.rasterizationStateCreateInfo.depthBiasEnable = VK_FALSE;
+    storage.rasterizationStateCreateInfo.depthBiasConstantFactor = 0.0f;
+    storage.rasterizationStateCreateInfo.depthBiasClamp = 0.0f;
+    storage.rasterizationStateCreateInfo.depthBiasSlopeFactor = 0.0f;
+    storage.rasterizationStateCreateInfo.lineWidth = 1.0f;
+
+    storage.multisampleStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    storage.multisampleStateCreateInfo.pNext = nullptr;
+    storage.multisampleStateCreateInfo.flags = 0;
+    storage.multisampleStateCreateInfo.rasterizationSamples = VkSampleCountFlagBits(state.rasterizationSamples);
+    storage.multisampleStateCreateInfo.sampleShadingEnable = VK_FALSE;
+    storage.multisampleStateCreateInfo.minSampleShading = 1.0f;
+    storage.multisampleStateCreateInfo.pSampleMask = nullptr;
+    storage.multisampleStateCreateInfo.alphaToCoverageEnable = VK_FALSE;
+    storage.multisampleStateCreateInfo.alphaToOneEnable = VK_FALSE;
+
+    storage.depthStencilStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    storage.depthStencilStateCreateInfo.pNext = nullptr;
+    storage.depthStencilStateCreateInfo.flags = 0;
+    storage.depthStencilStateCreateInfo.depthTestEnable = state.depthTestEnable;
+    storage.depthStencilStateCreateInfo.depthWriteEnable = state.depthWriteEnable;
+    storage.depthStencilStateCreateInfo.depthCompareOp = VkCompareOp(state.depthCompareOp);
+    storage.depthStencilStateCreateInfo.depthBoundsTestEnable = VK_FALSE;
+    storage.depthStencilStateCreateInfo.stencilTestEnable = VK_FALSE;
+    storage.depthStencilStateCreateInfo.front = {};
+    storage.depthStencilStateCreateInfo.back = {};
+    storage.depthStencilStateCreateInfo.minDepthBounds = 0.0f;
+    storage.depthStencilStateCreateInfo.maxDepthBounds = 1.0f;
+
+    storage.colorBlendAttachmentState.blendEnable = state.blendEnable;
+    storage.colorBlendAttachmentState.srcColorBlendFactor = VkBlendFactor(state.srcColorBlendFactor);
+    storage.colorBlendAttachmentState.dstColorBlendFactor = VkBlendFactor(state.dstColorBlendFactor);
+    storage.colorBlendAttachmentState.colorBlendOp = VkBlendOp(state.colorBlendOp);
+    storage.colorBlendAttachmentState.srcAlphaBlendFactor = VkBlendFactor(state.srcAlphaBlendFactor);
+    storage.colorBlendAttachmentState.dstAlphaBlendFactor = VkBlendFactor(state.dstAlphaBlendFactor);
+    storage.colorBlendAttachmentState.alphaBlendOp = VkBlendOp(state.alphaBlendOp);
+    storage.colorBlendAttachmentState.colorWriteMask = state.colorWriteMask;
+
+    storage.colorBlendStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    storage.colorBlendStateCreateInfo.pNext = nullptr;
+    storage.colorBlendStateCreateInfo.flags = 0;
+    storage.colorBlendStateCreateInfo.logicOpEnable = VK_FALSE;
+    storage.colorBlendStateCreateInfo.logicOp = VK_LOGIC_OP_NO_OP;
+    storage.colorBlendStateCreateInfo.attachmentCount = state.colorFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
+    storage.colorBlendStateCreateInfo.pAttachments = &storage.colorBlendAttachmentState;
+    storage.colorBlendStateCreateInfo.blendConstants[0] = 0.0f;
+    storage.colorBlendStateCreateInfo.blendConstants[1] = 0.0f;
+    storage.colorBlendStateCreateInfo.blendConstants[2] = 0.0f;
+    storage.colorBlendStateCreateInfo.blendConstants[3] = 0.0f;
+
+    storage.dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    storage.dynamicStateCreateInfo.pNext = nullptr;
+    storage.dynamicStateCreateInfo.flags = 0;
+    storage.dynamicStateCreateInfo.dynamicStateCount = getDynamicStates(storage.dynamicStates, state.depthFormat != VK_FORMAT_UNDEFINED);
+    storage.dynamicStateCreateInfo.pDynamicStates = storage.dynamicStates;
+
+    storage.pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    storage.pipelineCreateInfo.pNext = nullptr;
+    storage.pipelineCreateInfo.flags = 0;
+    storage.pipelineCreateInfo.stageCount = state.fragmentShader != VK_NULL_HANDLE ? 2 : 1;
+    storage.pipelineCreateInfo.pStages = storage.shaderStages;
+    storage.pipelineCreateInfo.pVertexInputState = &storage.vertexInputCreateInfo;
+    storage.pipelineCreateInfo.pInputAssemblyState = &storage.inputAssemblyCreateInfo;
+    storage.pipelineCreateInfo.pTessellationState = nullptr;
+    storage.pipelineCreateInfo.pViewportState = &storage.viewportStateCreateInfo;
+    storage.pipelineCreateInfo.pRasterizationState = &storage.rasterizationStateCreateInfo;
+    storage.pipelineCreateInfo.pMultisampleState = &storage.multisampleStateCreateInfo;
+    storage.pipelineCreateInfo.pDepthStencilState = state.depthFormat != VK_FORMAT_UNDEFINED ? &storage.depthStencilStateCreateInfo : nullptr;
+    storage.pipelineCreateInfo.pColorBlendState = &storage.colorBlendStateCreateInfo;
+    storage.pipelineCreateInfo.pDynamicState = &storage.dynamicStateCreateInfo;
+    storage.pipelineCreateInfo.layout = state.layout;
+    storage.pipelineCreateInfo.renderPass = renderPass;
+    storage.pipelineCreateInfo.subpass = state.subpass;
+    storage.pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+    storage.pipelineCreateInfo.basePipelineIndex = -1;
+}
+
+static VkPipeline createPipeline(VkDevice device, const PipelineStateDescription& state, VkRenderPass renderPass)
+{
+    PipelineCreateInfoStorage storage;
+    fillPipelineCreateInfo(state, renderPass, storage);
+
+    VkPipeline pipeline;
+    VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &storage.pipelineCreateInfo, getHostAllocator(VK_OBJECT_TYPE_PIPELINE), &pipeline);
+    CHECK_VKRESULT(result);
+
+    return pipeline;
+}
+
+static PipelineCacheTable* createTable(uint32_t capacity)
+{
+    PipelineCacheTable* table = new PipelineCacheTable;
+    table->capacity = capacity;
+    table->slots = new std::atomic<PipelineCacheEntry*>[capacity];
+
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        table->slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    return table;
+}
+
+static void insertEntry(PipelineCacheTable* table, PipelineCacheEntry* entry)
+{
+    const uint32_t mask = table->capacity - 1;
+
+    for (uint32_t index = uint32_t(entry->hash) & mask;; index = (index + 1) & mask)
+    {
+        if (table->slots[index].load(std::memory_order_relaxed) == nullptr)
+        {
+            table->slots[index].store(entry, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+static PipelineCacheEntry* findEntry(const PipelineStateDescription& state, uint64_t hash)
+{
+    PipelineCacheTable* table = currentTable.load(std::memory_order_acquire);
+    if (table == nullptr)
+    {
+        return nullptr;
+    }
+
+    const PipelineStateDescription key = getPipelineKey(state);
+
+    // The load factor is kept below 3/4, so an empty slot always ends the probe sequence
+    const uint32_t mask = table->capacity - 1;
+
+    for (uint32_t index = uint32_t(hash) & mask;; index = (index + 1) & mask)
+    {
+        PipelineCacheEntry* entry = table->slots[index].load(std::memory_order_acquire);
+        if (entry == nullptr || (entry->hash == hash && std::memcmp(&entry->state, &key, sizeof(PipelineStateDescription)) == 0))
+        {
+            return entry;
+        }
+    }
+}
+
+VkPipeline findPipeline(const PipelineStateDescription& state, uint64_t hash)
+{
+    PipelineCacheEntry* entry = findEntry(state, hash);
+    return entry == nullptr ? VK_NULL_HANDLE : entry->pipeline.load(std::memory_order_acquire);
+}
+
+const PipelineCacheEntry* getPipelineEntry(VkDevice device, const PipelineStateDescription& state, VkRenderPass renderPass)
+{
+    const uint64_t hash = hashPipelineState(state);
+
+    const PipelineCacheEntry* found = findEntry(state, hash);
+    if (found != nullptr)
+    {
+        return found;
+    }
+
+    // Compile outside of the lock so several threads missing on different states don't serialize.
+    // With pipeline libraries a quickly linked pipeline is returned and an optimized one swapped in later.
+    const PipelineStateDescription key = getPipelineKey(state);
+    const bool useLibraries = isGraphicsPipelineLibraryEnabled();
+
+    VkPipeline pipeline = useLibraries ? linkPipeline(device, key, renderPass) : createPipeline(device, key, renderPass);
+
+    std::lock_guard<std::mutex> lock(insertMutex);
+
+    const PipelineCacheEntry* existing = findEntry(state, hash);
+    if (existing != nullptr)
+    {
+        vkDestroyPipeline(device, pipeline, getHostAllocator(VK_OBJECT_TYPE_PIPELINE));
+        return existing;
+    }
+
+    PipelineCacheEntry* entry = new PipelineCacheEntry;
+    entry->hash = hash;
+    entry->state = key;
+    entry->pipeline.store(pipeline, std::memory_order_relaxed);
+
+    PipelineCacheTable* table = currentTable.load(std::memory_order_relaxed);
+    if (table == nullptr || (entries.size() + 1) * 4 > size_t(table->capacity) * 3)
+    {
+        PipelineCacheTable* grownTable = createTable(table == nullptr ? initialTableCapacity : table->capacity * 2);
+        for (PipelineCacheEntry* existingEntry : entries)
+        {
+            insertEntry(grownTable, existingEntry);
+        }
+
+        insertEntry(grownTable, entry);
+        tables.push_back(grownTable);
+        currentTable.store(grownTable, std::memory_order_release);
+    }
+    else
+    {
+        insertEntry(table, entry);
+    }
+
+    entries.push_back(entry);
+
+    if (useLibraries)
+    {
+        optimizePipelineAsync(device, key, renderPass, &entry->pipeline);
+    }
+
+    return entry;
+}
+
+VkPipeline loadPipeline(const PipelineCacheEntry* entry)
+{
+    return entry->pipeline.load(std::memory_order_acquire);
+}
+
+uint32_t getPipelineCount()
+{
+    std::lock_guard<std::mutex> lock(insertMutex);
+    return uint32_t(entries.size());
+}
+
+void destroyPipelineStateCache(VkDevice device)
+{
+    // The background compiler writes into entries, so it has to be stopped first
+    destroyPipelineLibraries(device);
+
+    std::lock_guard<std::mutex> lock(insertMutex);
+
+    currentTable.store(nullptr, std::memory_order_release);
+
+    for (PipelineCacheEntry* entry : entries)
+    {
+        vkDestroyPipeline(device, entry->pipeline.load(std::memory_order_relaxed), getHostAllocator(VK_OBJECT_TYPE_PIPELINE));
+        delete entry;
+    }
+
+    for (PipelineCacheTable* table : tables)
+    {
+        delete[] table->slots;
+        delete table;
+    }
+
+    entries.clear();
+    tables.clear();
+}
@@ -0,0 +1,160 @@
+// Vulkan Renderer - pipeline_state_cache.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _PIPELINE_STATE_CACHE_H_
+#define _PIPELINE_STATE_CACHE_H_
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "dynamic_state.h"
+#include "shader_variant.h"
+#include "vkdefines.h"
+
+constexpr uint32_t maxVertexBindings = 4;
+constexpr uint32_t maxVertexAttributes = 16;
+
+struct PipelineVertexBinding
+{
+    uint16_t stride;
+    uint8_t  binding;
+    uint8_t  inputRate;
+};
+
+struct PipelineVertexAttribute
+{
+    uint32_t format;
+    uint16_t offset;
+    uint8_t  location;
+    uint8_t  binding;
+};
+
+// Everything that goes into a graphics pipeline, packed without padding so it can be hashed and
+// compared bytewise. The render pass is described by its compatibility class (attachment formats,
+// sample count and subpass) rather than by handle, so compatible render passes share pipelines.
+// Viewport and scissor are always dynamic. With extended dynamic state the cull mode, front face and
+// depth test fields are ignored for lookups as well and have to be set while recording instead.
+struct PipelineStateDescription
+{
+    VkShaderModule          vertexShader;
+    VkShaderModule          fragmentShader;
+    VkPipelineLayout        layout;
+
+    SpecializationConstants vertexConstants;
+    SpecializationConstants fragmentConstants;
+
+    uint32_t                colorFormat;
+    uint32_t                depthFormat;
+    uint32_t                subpass;
+
+    uint32_t                vertexBindingCount;
+    uint32_t                vertexAttributeCount;
+    PipelineVertexBinding   vertexBindings[maxVertexBindings];
+    PipelineVertexAttribute vertexAttributes[maxVertexAttributes];
+
+    uint8_t                 topology;
+    uint8_t                 primitiveRestartEnable;
+    uint8_t                 polygonMode;
+    uint8_t                 cullMode;
+    uint8_t                 frontFace;
+    uint8_t                 rasterizationSamples;
+
+    uint8_t                 depthTestEnable;
+    uint8_t                 depthWriteEnable;
+    uint8_t                 depthCompareOp;
+
+    uint8_t                 blendEnable;
+    uint8_t                 srcColorBlendFactor;
+    uint8_t                 dstColorBlendFactor;
+    uint8_t                 colorBlendOp;
+    uint8_t                 srcAlphaBlendFactor;
+    uint8_t                 dstAlphaBlendFactor;
+    uint8_t                 alphaBlendOp;
+    uint8_t                 colorWriteMask;
+    uint8_t                 reserved[3];
+};
+
+static_assert(std::has_unique_object_representations_v<PipelineStateDescription>, "PipelineStateDescription must not contain padding");
+
+struct PipelineCacheEntry;
+
+// Backing storage for the create infos of one pipeline, the pointers inside refer to its own members
+struct PipelineCreateInfoStorage
+{
+    VkSpecializationMapEntry               vertexMapEntries[maxSpecializationConstants];
+    VkSpecializationMapEntry               fragmentMapEntries[maxSpecializationConstants];
+    VkSpecializationInfo                   vertexSpecializationInfo;
+    VkSpecializationInfo                   fragmentSpecializationInfo;
+    VkPipelineShaderStageCreateInfo        shaderStages[2];
+
+    VkVertexInputBindingDescription        vertexBindings[maxVertexBindings];
+    VkVertexInputAttributeDescription      vertexAttributes[maxVertexAttributes];
+    VkPipelineVertexInputStateCreateInfo   vertexInputCreateInfo;
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo;
+
+    VkPipelineViewportStateCreateInfo      viewportStateCreateInfo;
+    VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo;
+    VkPipelineMultisampleStateCreateInfo   multisampleStateCreateInfo;
+    VkPipelineDepthStencilStateCreateInfo  depthStencilStateCreateInfo;
+    VkPipelineColorBlendAttachmentState    colorBlendAttachmentState;
+    VkPipelineColorBlendStateCreateInfo    colorBlendStateCreateInfo;
+
+    VkDynamicState                         dynamicStates[maxDynamicStates];
+    VkPipelineDynamicStateCreateInfo       dynamicStateCreateInfo;
+
+    VkGraphicsPipelineCreateInfo           pipelineCreateInfo;
+};
+
+// Zeroes the description and fills in the renderer defaults: triangle lists, back face culling,
+// no depth test and alpha blending
+void initPipelineState(PipelineStateDescription& state);
+
+void setVertexInputState(
+    PipelineStateDescription& state,
+    const std::vector<VkVertexInputBindingDescription>& bindings,
+    const std::vector<VkVertexInputAttributeDescription>& attributes
+);
+
+uint64_t hashPipelineState(const PipelineStateDescription& state);
+
+// Fills in the create info of a complete pipeline, pipeline library parts are derived from it
+void fillPipelineCreateInfo(const PipelineStateDescription& state, VkRenderPass renderPass, PipelineCreateInfoStorage& storage);
+
+// Lock-free, may be called from any number of threads while other threads insert pipelines.
+// Returns VK_NULL_HANDLE if the state has not been compiled yet.
+VkPipeline findPipeline(const PipelineStateDescription& state, uint64_t hash);
+
+// Compiles the pipeline on a miss, renderPass has to be compatible with the description. The entry
+// stays valid until destroyPipelineStateCache and its pipeline may be swapped for an optimized one,
+// so callers keep the entry and load the pipeline again whenever they record.
+const PipelineCacheEntry* getPipelineEntry(VkDevice device, const PipelineStateDescription& state, VkRenderPass renderPass);
+
+// Lock-free, returns the best pipeline compiled for the entry so far
+VkPipeline loadPipeline(const PipelineCacheEntry* entry);
+
+uint32_t getPipelineCount();
+
+void destroyPipelineStateCache(VkDevice device);
+
+#endif // !_PIPELINE_STATE_CACHE_H_
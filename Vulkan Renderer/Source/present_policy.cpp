@@ -0,0 +1,198 @@
+// Vulkan Renderer - present_policy.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "present_policy.h"
+
+// Most preferred first
+static const VkPresentModeKHR lowestLatencyModes[] = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+static const VkPresentModeKHR maxThroughputModes[] = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+
+// The renderer writes SDR, so 8 bit sRGB formats come first for every profile
+static const VkFormat preferredFormats[] =
+{
+    VK_FORMAT_B8G8R8A8_SRGB,
+    VK_FORMAT_R8G8B8A8_SRGB,
+    VK_FORMAT_B8G8R8A8_UNORM,
+    VK_FORMAT_R8G8B8A8_UNORM
+};
+
+static std::chrono::steady_clock::time_point lastPresentTime;
+static SwapchainConfiguration loggedConfiguration;
+static float presentIntervals[presentLogInterval];
+static uint32_t presentIntervalCount = 0;
+static bool measuring = false;
+
+static VkPresentModeKHR selectPresentMode(const VkPresentModeKHR* candidates, uint32_t candidateCount, const VkPresentModeKHR* presentModes, uint32_t presentModeCount)
+{
+    for (uint32_t i = 0; i < candidateCount; i++)
+    {
+        if (std::find(presentModes, presentModes + presentModeCount, candidates[i]) != presentModes + presentModeCount)
+        {
+            return candidates[i];
+        }
+    }
+
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+static VkSurfaceFormatKHR selectSurfaceFormat(const VkSurfaceFormatKHR* surfaceFormats, uint32_t surfaceFormatCount)
+{
+    for (VkFormat format : preferredFormats)
+    {
+        for (uint32_t i = 0; i < surfaceFormatCount; i++)
+        {
+            if (surfaceFormats[i].format == format && surfaceFormats[i].colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
+            {
+                return surfaceFormats[i];
+            }
+        }
+    }
+
+    // Whatever the surface lists first, the renderer can write any 8 bit color format
+    return surfaceFormats[0];
+}
+
+SwapchainConfiguration selectSwapchainConfiguration(
+    PresentProfile profile,
+    const VkSurfaceCapabilitiesKHR& surfaceCapabilities,
+    const VkSurfaceFormatKHR* surfaceFormats,
+    uint32_t surfaceFormatCount,
+    const VkPresentModeKHR* presentModes,
+    uint32_t presentModeCount)
+{
+    SwapchainConfiguration configuration;
+    configuration.surfaceFormat = selectSurfaceFormat(surfaceFormats, surfaceFormatCount);
+
+    uint32_t imageCount = 2;
+    switch (profile)
+    {
+    case PresentProfileLowestLatency:
+        configuration.presentMode = selectPresentMode(lowestLatencyModes, 3, presentModes, presentModeCount);
+
+        // Mailbox needs a third image to render into while one is queued and one is on screen
+        imageCount = configuration.presentMode == VK_PRESENT_MODE_MAILBOX_KHR ? 3 : 2;
+        break;
+    case PresentProfileMaxThroughput:
+        configuration.presentMode = selectPresentMode(maxThroughputModes, 3, presentModes, presentModeCount);
+
+        // One more image than the presentation engine holds on to, so acquire never blocks
+        imageCount = std::max(surfaceCapabilities.minImageCount + 1, 3u);
+        break;
+    case PresentProfilePowerSaving:
+        configuration.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        imageCount = 2;
+        break;
+    default:
+        __debugbreak();
+        configuration.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    // A maxImageCount of 0 means there is no upper limit
+    imageCount = std::max(imageCount, surfaceCapabilities.minImageCount);
+    if (surfaceCapabilities.maxImageCount != 0)
+    {
+        imageCount = std::min(imageCount, surfaceCapabilities.maxImageCount);
+    }
+
+    configuration.imageCount = imageCount;
+    return configuration;
+}
+
+bool isSrgbFormat(VkFormat format)
+{
+    return format == VK_FORMAT_B8G8R8A8_SRGB || format == VK_FORMAT_R8G8B8A8_SRGB;
+}
+
+const char* getPresentProfileName(PresentProfile profile)
+{
+    switch (profile)
+    {
+    case PresentProfileLowestLatency:
+        return "lowest latency";
+    case PresentProfileMaxThroughput:
+        return "max throughput";
+    case PresentProfilePowerSaving:
+        return "power saving";
+    default:
+        return "unknown";
+    }
+}
+
+const char* getPresentModeName(VkPresentModeKHR presentMode)
+{
+    switch (presentMode)
+    {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR:
+        return "fifo";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "fifo relaxed";
+    default:
+        return "unknown";
+    }
+}
+
+static void printPresentIntervals()
+{
+    std::sort(presentIntervals, presentIntervals + presentIntervalCount);
+
+    float total = 0.0f;
+    for (uint32_t i = 0; i < presentIntervalCount; i++)
+    {
+        total += presentIntervals[i];
+    }
+
+    std::cout << "Present intervals (" << getPresentModeName(loggedConfiguration.presentMode) << ", "
+        << loggedConfiguration.imageCount << " images): average " << total / presentIntervalCount
+        << " ms, median " << presentIntervals[presentIntervalCount / 2]
+        << " ms, 99th percentile " << presentIntervals[presentIntervalCount * 99 / 100]
+        << " ms, max " << presentIntervals[presentIntervalCount - 1] << " ms" << std::endl;
+}
+
+void recordPresent(const SwapchainConfiguration& configuration)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    if (!measuring || configuration.presentMode != loggedConfiguration.presentMode || configuration.imageCount != loggedConfiguration.imageCount)
+    {
+        loggedConfiguration = configuration;
+        presentIntervalCount = 0;
+        lastPresentTime = now;
+        measuring = true;
+        return;
+    }
+
+    presentIntervals[presentIntervalCount++] = std::chrono::duration<float, std::milli>(now - lastPresentTime).count();
+    lastPresentTime = now;
+
+    if (presentIntervalCount == presentLogInterval)
+    {
+        printPresentIntervals();
+        presentIntervalCount = 0;
+    }
+}
@@ -0,0 +1,69 @@
+// Vulkan Renderer - present_policy.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _PRESENT_POLICY_H_
+#define _PRESENT_POLICY_H_
+
+#include <cstdint>
+
+#include "vkdefines.h"
+
+enum PresentProfile : uint32_t
+{
+    PresentProfileLowestLatency, // Uncapped without tearing where possible, the newest frame is shown at every vblank
+    PresentProfileMaxThroughput, // Uncapped and tearing, the GPU never waits for the display
+    PresentProfilePowerSaving,   // Capped to the refresh rate with as few images as allowed
+    PresentProfileCount
+};
+
+struct SwapchainConfiguration
+{
+    VkPresentModeKHR   presentMode;
+    uint32_t           imageCount;
+    VkSurfaceFormatKHR surfaceFormat;
+};
+
+// Picks from what the surface supports. FIFO is the fallback of every profile since it's the only mode
+// that's always available.
+SwapchainConfiguration selectSwapchainConfiguration(
+    PresentProfile profile,
+    const VkSurfaceCapabilitiesKHR& surfaceCapabilities,
+    const VkSurfaceFormatKHR* surfaceFormats,
+    uint32_t surfaceFormatCount,
+    const VkPresentModeKHR* presentModes,
+    uint32_t presentModeCount
+);
+
+// sRGB formats encode in the output merger, for UNORM ones the fragment shader has to do it
+bool isSrgbFormat(VkFormat format);
+
+const char* getPresentProfileName(PresentProfile profile);
+const char* getPresentModeName(VkPresentModeKHR presentMode);
+
+// Call right after every vkQueuePresentKHR. Prints the present-to-present intervals of the configuration
+// every presentLogInterval presents, restarts the measurement when the configuration changes. The intervals are
+// taken on the CPU, once the swapchain is saturated they follow the cadence of the presentation engine.
+constexpr uint32_t presentLogInterval = 1000;
+void recordPresent(const SwapchainConfiguration& configuration);
+
+#endif // !_PRESENT_POLICY_H_
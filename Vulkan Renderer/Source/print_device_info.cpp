@@ -25,7 +25,9 @@
 #include "vkdefines.h"
 
 // I don't even understand why I have to disable this abomination, sometimes Visual Studio is just straight up retarded
+#ifdef _MSC_VER
 #pragma warning(disable: 6385)
+#endif
 
 void printSinglePhysicalDeviceFeatures(const VkPhysicalDevice physicalDevice)
 {
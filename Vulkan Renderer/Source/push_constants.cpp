@@ -0,0 +1,80 @@
+// Vulkan Renderer - push_constants.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <cstring>
+#include <iostream>
+
+#include "push_constants.h"
+
+bool validatePushConstants(const ShaderReflection* reflections, uint32_t reflectionCount, uint32_t blockSize, uint32_t maxPushConstantsSize)
+{
+    if (blockSize > maxPushConstantsSize)
+    {
+        std::cout << "Push constant block of " << blockSize << " bytes exceeds maxPushConstantsSize of " << maxPushConstantsSize << '\n';
+        return false;
+    }
+
+    for (uint32_t i = 0; i < reflectionCount; i++)
+    {
+        for (const VkPushConstantRange& range : reflections[i].pushConstantRanges)
+        {
+            if (range.offset + range.size > blockSize)
+            {
+                std::cout << "Shader push constant range [" << range.offset << ", " << range.offset + range.size
+                          << ") doesn't fit the " << blockSize << " byte block\n";
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void resetPushConstantState(PushConstantState& state)
+{
+    state.layout = VK_NULL_HANDLE;
+    state.valid = false;
+    state.pushCount = 0;
+    state.skipCount = 0;
+}
+
+void cmdPushDrawConstants(
+    VkCommandBuffer commandBuffer,
+    PushConstantState& state,
+    VkPipelineLayout layout,
+    VkShaderStageFlags stageFlags,
+    const DrawPushConstants& constants)
+{
+    // Pipeline layouts from the layout cache share one range, so values survive pipeline switches
+    // as long as the layout stays the same
+    if (state.valid && state.layout == layout && std::memcmp(&state.constants, &constants, sizeof(DrawPushConstants)) == 0)
+    {
+        state.skipCount++;
+        return;
+    }
+
+    vkCmdPushConstants(commandBuffer, layout, stageFlags, 0, sizeof(DrawPushConstants), &constants);
+
+    state.layout = layout;
+    state.valid = true;
+    state.constants = constants;
+    state.pushCount++;
+}
@@ -0,0 +1,69 @@
+// Vulkan Renderer - push_constants.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _PUSH_CONSTANTS_H_
+#define _PUSH_CONSTANTS_H_
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "spirv_reflection.h"
+#include "vkdefines.h"
+
+// Per-draw data, mirrors the push constant block of vertex_shader.vert
+struct DrawPushConstants
+{
+    glm::mat4 transform;
+    uint32_t  objectIndex;
+    uint32_t  materialIndex;
+};
+
+// 128 bytes is the minimum maxPushConstantsSize every implementation has to support
+static_assert(sizeof(DrawPushConstants) <= 128, "DrawPushConstants exceeds the guaranteed push constant size");
+
+// Remembers what was pushed last into a command buffer so unchanged values can be skipped
+struct PushConstantState
+{
+    VkPipelineLayout  layout;
+    bool              valid;
+    DrawPushConstants constants;
+    uint32_t          pushCount;
+    uint32_t          skipCount;
+};
+
+// Checks that every reflected push constant range lies within the block and that the block fits the device limit
+bool validatePushConstants(const ShaderReflection* reflections, uint32_t reflectionCount, uint32_t blockSize, uint32_t maxPushConstantsSize);
+
+// Call at the start of every command buffer, push constants don't carry over between them
+void resetPushConstantState(PushConstantState& state);
+
+void cmdPushDrawConstants(
+    VkCommandBuffer commandBuffer,
+    PushConstantState& state,
+    VkPipelineLayout layout,
+    VkShaderStageFlags stageFlags,
+    const DrawPushConstants& constants
+);
+
+#endif // !_PUSH_CONSTANTS_H_
@@ -0,0 +1,455 @@
+// Vulkan Renderer - residency.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include "residency.h"
+
+struct PendingFree
+{
+    uint64_t     frame;
+    uint32_t     heapIndex;
+    VkDeviceSize size;
+};
+
+static VkPhysicalDevice                 residencyPhysicalDevice = VK_NULL_HANDLE;
+static VkPhysicalDeviceMemoryProperties memoryProperties;
+static bool                             memoryBudgetEnabled = false;
+static uint32_t                         demotionMemoryType = invalidMemoryType;
+static float                            budgetFraction = 0.9f;
+
+// Indexed by the slot of the buffer handle, trackedHandles is 0 for slots the manager doesn't track
+static uint32_t           trackedHandles[maxPooledBuffers];
+static uint64_t           lastUsedFrames[maxPooledBuffers];
+static VkDeviceSize       trackedSizes[maxPooledBuffers];
+static VkBufferUsageFlags trackedUsages[maxPooledBuffers];
+static uint32_t           trackedPositions[maxPooledBuffers];
+static uint8_t            trackedHeaps[maxPooledBuffers];
+static uint8_t            trackedPolicies[maxPooledBuffers];
+static uint8_t            trackedStates[maxPooledBuffers];
+
+static std::vector<uint32_t>    trackedSlots;
+static std::vector<uint32_t>    candidates;
+// Released dedicated allocations count against the driver usage until the frames that used them completed.
+// Sub-allocated buffers only free memory when their block empties, memory_blocks keeps track of that.
+static std::vector<PendingFree> pendingFrees;
+static VkDeviceSize             pendingBlockBytes[VK_MAX_MEMORY_HEAPS];
+static VkDeviceSize             residentBytes[VK_MAX_MEMORY_HEAPS];
+static ResidencyStats           stats;
+
+static uint32_t getHeapIndex(uint32_t memoryType)
+{
+    return memoryProperties.memoryTypes[memoryType].heapIndex;
+}
+
+static bool isDeviceLocalHeap(uint32_t heapIndex)
+{
+    return (memoryProperties.memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+}
+
+static void untrack(uint32_t slot)
+{
+    uint32_t position = trackedPositions[slot];
+    uint32_t lastSlot = trackedSlots.back();
+    trackedSlots[position] = lastSlot;
+    trackedPositions[lastSlot] = position;
+    trackedSlots.pop_back();
+
+    if (trackedStates[slot] == ResidencyStateResident)
+    {
+        residentBytes[trackedHeaps[slot]] -= trackedSizes[slot];
+    }
+
+    trackedHandles[slot] = 0;
+}
+
+static void pollBudgets()
+{
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties;
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    budgetProperties.pNext = nullptr;
+
+    if (memoryBudgetEnabled)
+    {
+        VkPhysicalDeviceMemoryProperties2 properties;
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties.pNext = &budgetProperties;
+
+        vkGetPhysicalDeviceMemoryProperties2(residencyPhysicalDevice, &properties);
+    }
+
+    for (uint32_t i = 0; i < stats.heapCount; i++)
+    {
+        HeapResidency& heap = stats.heaps[i];
+        heap.budget = memoryBudgetEnabled ? budgetProperties.heapBudget[i] : heap.size;
+        heap.usage = memoryBudgetEnabled ? budgetProperties.heapUsage[i] : residentBytes[i];
+        heap.limit = VkDeviceSize(double(heap.budget) * budgetFraction);
+    }
+}
+
+static void addPendingFree(const GpuBuffer& buffer, uint32_t slot, uint64_t frame)
+{
+    if (buffer.memoryBlock != invalidMemoryBlock)
+    {
+        return;
+    }
+
+    PendingFree pendingFree;
+    pendingFree.frame = frame;
+    pendingFree.heapIndex = trackedHeaps[slot];
+    pendingFree.size = buffer.memorySize;
+    pendingFrees.push_back(pendingFree);
+}
+
+static void evict(uint32_t slot, uint64_t frame)
+{
+    BufferHandle handle;
+    handle.value = trackedHandles[slot];
+
+    addPendingFree(resolveGpuBuffer(handle), slot, frame);
+
+    untrack(slot);
+    releaseBuffer(handle);
+
+    stats.frameEvictions++;
+}
+
+static bool demote(VkDevice device, VkCommandBuffer commandBuffer, uint32_t slot, uint64_t frame, bool& copiesRecorded)
+{
+    if (demotionMemoryType == invalidMemoryType)
+    {
+        return false;
+    }
+
+    // The buffer may not accept host memory, or the host heap may be full
+    GpuBuffer hostBuffer;
+    if (!tryCreateSuballocatedGpuBuffer(device, trackedSizes[slot], trackedUsages[slot] | VK_BUFFER_USAGE_TRANSFER_DST_BIT, demotionMemoryType, hostBuffer))
+    {
+        return false;
+    }
+
+    // Earlier submissions may have written the buffer on the GPU
+    if (!copiesRecorded)
+    {
+        VkMemoryBarrier barrier;
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.pNext = nullptr;
+        barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        copiesRecorded = true;
+    }
+
+    BufferHandle handle;
+    handle.value = trackedHandles[slot];
+
+    VkBufferCopy region;
+    region.srcOffset = 0;
+    region.dstOffset = 0;
+    region.size = trackedSizes[slot];
+
+    GpuBuffer deviceBuffer = resolveGpuBuffer(handle);
+    vkCmdCopyBuffer(commandBuffer, deviceBuffer.buffer, hostBuffer.buffer, 1, &region);
+
+    // The bindless array may be out of slots for the host copy
+    if (!replaceBuffer(handle, hostBuffer))
+    {
+        releaseGpuBuffer(hostBuffer);
+        return false;
+    }
+
+    addPendingFree(deviceBuffer, slot, frame);
+
+    residentBytes[trackedHeaps[slot]] -= trackedSizes[slot];
+    trackedHeaps[slot] = uint8_t(getHeapIndex(hostBuffer.memoryType));
+    trackedStates[slot] = ResidencyStateDemoted;
+
+    stats.frameDemotions++;
+    return true;
+}
+
+void requestMemoryBudget(const VkExtensionProperties* extensions, uint32_t extensionCount, std::vector<const char*>& enabledExtensions)
+{
+    memoryBudgetEnabled = false;
+
+    for (uint32_t i = 0; i < extensionCount; i++)
+    {
+        if (std::strcmp(extensions[i].extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0)
+        {
+            enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            memoryBudgetEnabled = true;
+            return;
+        }
+    }
+}
+
+void createResidencyManager(VkPhysicalDevice physicalDevice)
+{
+    residencyPhysicalDevice = physicalDevice;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    // Only types of heaps outside the device qualify, with resizable BAR the first host visible type may well
+    // be device local. Integrated GPUs have no memory to demote to, everything gets evicted there.
+    uint32_t hostMemoryTypeBits = 0;
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        if (!isDeviceLocalHeap(memoryProperties.memoryTypes[i].heapIndex))
+        {
+            hostMemoryTypeBits |= 1u << i;
+        }
+    }
+
+    demotionMemoryType = findMemoryType(physicalDevice, hostMemoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    stats = {};
+    stats.heapCount = memoryProperties.memoryHeapCount;
+    stats.memoryBudgetEnabled = memoryBudgetEnabled;
+
+    for (uint32_t i = 0; i < stats.heapCount; i++)
+    {
+        stats.heaps[i].size = memoryProperties.memoryHeaps[i].size;
+        stats.heaps[i].deviceLocal = isDeviceLocalHeap(i);
+        residentBytes[i] = 0;
+    }
+
+    pollBudgets();
+}
+
+void setResidencyBudget(float fraction)
+{
+    budgetFraction = fraction;
+}
+
+BufferHandle addStreamableBuffer(const GpuBuffer& buffer, ResidencyPolicy policy)
+{
+    BufferHandle handle = addBuffer(buffer);
+    if (handle.value == 0)
+    {
+        return handle;
+    }
+
+    if (policy == ResidencyPolicyDemote && (buffer.usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) == 0)
+    {
+        __debugbreak(); // Demotion copies out of the buffer
+    }
+
+    uint32_t slot = handle.value & handleSlotMask;
+    trackedHandles[slot] = handle.value;
+    lastUsedFrames[slot] = 0;
+    trackedSizes[slot] = buffer.size;
+    trackedUsages[slot] = buffer.usage;
+    trackedHeaps[slot] = uint8_t(getHeapIndex(buffer.memoryType));
+    trackedPolicies[slot] = uint8_t(policy);
+    trackedStates[slot] = ResidencyStateResident;
+
+    trackedPositions[slot] = uint32_t(trackedSlots.size());
+    trackedSlots.push_back(slot);
+
+    residentBytes[trackedHeaps[slot]] += buffer.size;
+    return handle;
+}
+
+void markBufferUsed(BufferHandle handle, uint64_t frame)
+{
+    uint32_t slot = handle.value & handleSlotMask;
+    if (handle.value != 0 && trackedHandles[slot] == handle.value)
+    {
+        lastUsedFrames[slot] = frame;
+    }
+}
+
+ResidencyState getResidencyState(BufferHandle handle)
+{
+    uint32_t slot = handle.value & handleSlotMask;
+    if (handle.value == 0 || trackedHandles[slot] != handle.value)
+    {
+        return ResidencyStateEvicted;
+    }
+
+    return ResidencyState(trackedStates[slot]);
+}
+
+void releaseStreamableBuffer(BufferHandle& handle)
+{
+    uint32_t slot = handle.value & handleSlotMask;
+    if (handle.value != 0 && trackedHandles[slot] == handle.value)
+    {
+        untrack(slot);
+    }
+
+    releaseBuffer(handle);
+}
+
+void updateResidency(VkDevice device, VkCommandBuffer commandBuffer, uint64_t frame, uint64_t completedFrames)
+{
+    stats.frameEvictions = 0;
+    stats.frameDemotions = 0;
+
+    pendingFrees.erase(std::remove_if(pendingFrees.begin(), pendingFrees.end(),
+        [completedFrames](const PendingFree& pendingFree) { return pendingFree.frame < completedFrames; }), pendingFrees.end());
+
+    pollBudgets();
+
+    if (memoryBudgetEnabled)
+    {
+        for (uint32_t heapIndex = 0; heapIndex < stats.heapCount; heapIndex++)
+        {
+            pendingBlockBytes[heapIndex] = 0;
+        }
+
+        addPendingBlockFrees(pendingBlockBytes);
+    }
+
+    bool copiesRecorded = false;
+
+    for (uint32_t heapIndex = 0; heapIndex < stats.heapCount; heapIndex++)
+    {
+        const HeapResidency& heap = stats.heaps[heapIndex];
+        if (!heap.deviceLocal)
+        {
+            continue;
+        }
+
+        // Without VK_EXT_memory_budget the usage is computed from the tracked buffers and never includes pending frees
+        VkDeviceSize usage = heap.usage;
+        if (memoryBudgetEnabled)
+        {
+            usage -= std::min(pendingBlockBytes[heapIndex], usage);
+
+            for (const PendingFree& pendingFree : pendingFrees)
+            {
+                if (pendingFree.heapIndex == heapIndex)
+                {
+                    usage -= std::min(pendingFree.size, usage);
+                }
+            }
+        }
+
+        if (usage <= heap.limit)
+        {
+            continue;
+        }
+
+        VkDeviceSize excess = usage - heap.limit;
+
+        candidates.clear();
+        for (uint32_t slot : trackedSlots)
+        {
+            if (trackedHeaps[slot] == heapIndex && trackedStates[slot] == ResidencyStateResident && lastUsedFrames[slot] < frame)
+            {
+                candidates.push_back(slot);
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](uint32_t a, uint32_t b) { return lastUsedFrames[a] < lastUsedFrames[b]; });
+
+        for (uint32_t slot : candidates)
+        {
+            if (excess == 0)
+            {
+                break;
+            }
+
+            VkDeviceSize size = trackedSizes[slot];
+
+            if (trackedPolicies[slot] != ResidencyPolicyDemote || !demote(device, commandBuffer, slot, frame, copiesRecorded))
+            {
+                evict(slot, frame);
+            }
+
+            excess -= std::min(size, excess);
+        }
+    }
+
+    if (copiesRecorded)
+    {
+        VkMemoryBarrier barrier;
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.pNext = nullptr;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+            VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+        VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    stats.trackedCount = uint32_t(trackedSlots.size());
+    stats.totalEvictions += stats.frameEvictions;
+    stats.totalDemotions += stats.frameDemotions;
+}
+
+const ResidencyStats& getResidencyStats()
+{
+    return stats;
+}
+
+void printResidencyStats()
+{
+    const std::ios_base::fmtflags flags = std::cout.flags();
+    const std::streamsize precision = std::cout.precision();
+
+    std::cout << std::left << std::setw(6) << "Heap" << ' ' << std::setw(13) << "Flags" << std::right
+              << ' ' << std::setw(12) << "Size (MiB)" << ' ' << std::setw(12) << "Budget (MiB)"
+              << ' ' << std::setw(12) << "Usage (MiB)" << ' ' << std::setw(12) << "Limit (MiB)" << '\n';
+
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (uint32_t i = 0; i < stats.heapCount; i++)
+    {
+        const HeapResidency& heap = stats.heaps[i];
+        std::cout << std::left << std::setw(6) << i << ' ' << std::setw(13) << (heap.deviceLocal ? "device local" : "host") << std::right
+                  << ' ' << std::setw(12) << double(heap.size) / 1048576.0 << ' ' << std::setw(12) << double(heap.budget) / 1048576.0
+                  << ' ' << std::setw(12) << double(heap.usage) / 1048576.0 << ' ' << std::setw(12) << double(heap.limit) / 1048576.0 << '\n';
+    }
+
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+
+    std::cout << stats.trackedCount << " tracked buffers, " << stats.totalEvictions << " evictions, " << stats.totalDemotions << " demotions"
+              << (stats.memoryBudgetEnabled ? "" : ", no VK_EXT_memory_budget") << '\n';
+}
+
+void destroyResidencyManager()
+{
+    for (uint32_t slot : trackedSlots)
+    {
+        BufferHandle handle;
+        handle.value = trackedHandles[slot];
+        trackedHandles[slot] = 0;
+
+        releaseBuffer(handle);
+    }
+
+    trackedSlots.clear();
+    pendingFrees.clear();
+
+    for (uint32_t i = 0; i < stats.heapCount; i++)
+    {
+        residentBytes[i] = 0;
+    }
+}
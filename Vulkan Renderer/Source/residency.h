@@ -0,0 +1,95 @@
+// Vulkan Renderer - residency.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _RESIDENCY_H_
+#define _RESIDENCY_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "gpu_buffer.h"
+#include "resource_pools.h"
+#include "vkdefines.h"
+
+enum ResidencyPolicy : uint32_t
+{
+    ResidencyPolicyEvict,  // Released under pressure, the owner streams it in again once it is needed
+    ResidencyPolicyDemote  // Moved to host memory under pressure, the handle stays valid but reads cross the bus
+};
+
+enum ResidencyState : uint32_t
+{
+    ResidencyStateResident,
+    ResidencyStateDemoted,
+    ResidencyStateEvicted  // Also for handles the manager never tracked
+};
+
+struct HeapResidency
+{
+    VkDeviceSize size;
+    VkDeviceSize budget; // Reported by the driver, the heap size without VK_EXT_memory_budget
+    VkDeviceSize usage;  // Of the whole process, only the tracked buffers without VK_EXT_memory_budget
+    VkDeviceSize limit;  // Eviction starts above it
+    bool         deviceLocal;
+};
+
+struct ResidencyStats
+{
+    uint32_t      heapCount;
+    HeapResidency heaps[VK_MAX_MEMORY_HEAPS];
+    uint32_t      trackedCount;
+    uint32_t      frameEvictions;
+    uint32_t      frameDemotions;
+    uint64_t      totalEvictions;
+    uint64_t      totalDemotions;
+    bool          memoryBudgetEnabled;
+};
+
+// Appends VK_EXT_memory_budget when the physical device supports it, has to be called before vkCreateDevice
+void requestMemoryBudget(const VkExtensionProperties* extensions, uint32_t extensionCount, std::vector<const char*>& enabledExtensions);
+
+void createResidencyManager(VkPhysicalDevice physicalDevice);
+
+// Fraction of the driver budget of each device local heap the process may use before tracked buffers get
+// evicted, 0.9 by default
+void setResidencyBudget(float fraction);
+
+// Render thread only. Takes ownership like addBuffer. Demotable buffers need VK_BUFFER_USAGE_TRANSFER_SRC_BIT.
+BufferHandle addStreamableBuffer(const GpuBuffer& buffer, ResidencyPolicy policy);
+void markBufferUsed(BufferHandle handle, uint64_t frame);
+ResidencyState getResidencyState(BufferHandle handle);
+void releaseStreamableBuffer(BufferHandle& handle);
+
+// Once per frame, after advanceDeferredDestruction and before anything reading tracked buffers is recorded.
+// Polls the budgets and evicts or demotes the least recently used buffers of heaps over their limit, buffers
+// used in frame itself are kept. The copies of demotions are recorded into commandBuffer.
+void updateResidency(VkDevice device, VkCommandBuffer commandBuffer, uint64_t frame, uint64_t completedFrames);
+
+// Updated by updateResidency, the eviction and demotion counts of the last call are in frameEvictions and frameDemotions
+const ResidencyStats& getResidencyStats();
+void printResidencyStats();
+
+// Releases all tracked buffers, their handles become stale
+void destroyResidencyManager();
+
+#endif // !_RESIDENCY_H_
@@ -0,0 +1,405 @@
+// Vulkan Renderer - resource_pools.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "bindless_descriptors.h"
+#include "deferred_destruction.h"
+#include "resource_pools.h"
+
+// One array per field, all indexed by dense position. Lookups touch the handle pool and the one array
+// they need, walks over a field read nothing else.
+struct BufferPool
+{
+    HandlePool<maxPooledBuffers> handles;
+    VkBuffer           buffers[maxPooledBuffers];
+    VkDeviceMemory     memories[maxPooledBuffers];
+    VkDeviceSize       sizes[maxPooledBuffers];
+    void*              mappings[maxPooledBuffers];
+    VkBufferUsageFlags usages[maxPooledBuffers];
+    uint32_t           memoryTypes[maxPooledBuffers];
+    uint32_t           memoryBlocks[maxPooledBuffers];
+    VkDeviceSize       memoryOffsets[maxPooledBuffers];
+    VkDeviceSize       memorySizes[maxPooledBuffers];
+    uint32_t           bindlessIndices[maxPooledBuffers]; // Follows the buffer, replaceBuffer moves it to a new slot
+};
+
+struct ImagePool
+{
+    HandlePool<maxPooledImages> handles;
+    VkImage        images[maxPooledImages];
+    VkDeviceMemory memories[maxPooledImages];
+    VkImageView    views[maxPooledImages];
+    VkFormat       formats[maxPooledImages];
+    VkExtent2D     extents[maxPooledImages];
+};
+
+struct PipelinePool
+{
+    HandlePool<maxPooledPipelines> handles;
+    VkPipeline          pipelines[maxPooledPipelines];
+    VkPipelineBindPoint bindPoints[maxPooledPipelines];
+};
+
+struct SamplerPool
+{
+    HandlePool<maxPooledSamplers> handles;
+    VkSampler samplers[maxPooledSamplers];
+};
+
+static BufferPool   bufferPool;
+static ImagePool    imagePool;
+static PipelinePool pipelinePool;
+static SamplerPool  samplerPool;
+
+template<typename Tag, uint32_t Capacity>
+static uint32_t resolveDenseIndex(const HandlePool<Capacity>& pool, ResourceHandle<Tag> handle)
+{
+    uint32_t denseIndex = findDenseIndex(pool, handle);
+    if (denseIndex == invalidDenseIndex)
+    {
+        __debugbreak(); // Released or never created
+    }
+    return denseIndex;
+}
+
+static void storeBuffer(uint32_t denseIndex, const GpuBuffer& buffer)
+{
+    bufferPool.buffers[denseIndex] = buffer.buffer;
+    bufferPool.memories[denseIndex] = buffer.memory;
+    bufferPool.sizes[denseIndex] = buffer.size;
+    bufferPool.mappings[denseIndex] = buffer.mapped;
+    bufferPool.usages[denseIndex] = buffer.usage;
+    bufferPool.memoryTypes[denseIndex] = buffer.memoryType;
+    bufferPool.memoryBlocks[denseIndex] = buffer.memoryBlock;
+    bufferPool.memoryOffsets[denseIndex] = buffer.memoryOffset;
+    bufferPool.memorySizes[denseIndex] = buffer.memorySize;
+}
+
+static GpuBuffer loadBuffer(uint32_t denseIndex)
+{
+    GpuBuffer buffer;
+    buffer.buffer = bufferPool.buffers[denseIndex];
+    buffer.memory = bufferPool.memories[denseIndex];
+    buffer.size = bufferPool.sizes[denseIndex];
+    buffer.mapped = bufferPool.mappings[denseIndex];
+    buffer.usage = bufferPool.usages[denseIndex];
+    buffer.memoryType = bufferPool.memoryTypes[denseIndex];
+    buffer.memoryBlock = bufferPool.memoryBlocks[denseIndex];
+    buffer.memoryOffset = bufferPool.memoryOffsets[denseIndex];
+    buffer.memorySize = bufferPool.memorySizes[denseIndex];
+    return buffer;
+}
+
+BufferHandle addBuffer(const GpuBuffer& buffer)
+{
+    BufferHandle handle;
+    uint32_t denseIndex = allocateHandle(bufferPool.handles, handle);
+    if (denseIndex == invalidDenseIndex)
+    {
+        __debugbreak(); // Raise maxPooledBuffers
+        return handle;
+    }
+
+    storeBuffer(denseIndex, buffer);
+    bufferPool.bindlessIndices[denseIndex] = invalidBindlessIndex;
+    return handle;
+}
+
+VkBuffer resolveBuffer(BufferHandle handle)
+{
+    uint32_t denseIndex = resolveDenseIndex(bufferPool.handles, handle);
+    return denseIndex != invalidDenseIndex ? bufferPool.buffers[denseIndex] : VK_NULL_HANDLE;
+}
+
+VkDeviceSize resolveBufferSize(BufferHandle handle)
+{
+    uint32_t denseIndex = resolveDenseIndex(bufferPool.handles, handle);
+    return denseIndex != invalidDenseIndex ? bufferPool.sizes[denseIndex] : 0;
+}
+
+void* resolveBufferMapping(BufferHandle handle)
+{
+    uint32_t denseIndex = resolveDenseIndex(bufferPool.handles, handle);
+    return denseIndex != invalidDenseIndex ? bufferPool.mappings[denseIndex] : nullptr;
+}
+
+uint32_t registerBufferBindless(BufferHandle handle)
+{
+    uint32_t denseIndex = resolveDenseIndex(bufferPool.handles, handle);
+    if (denseIndex == invalidDenseIndex)
+    {
+        return invalidBindlessIndex;
+    }
+
+    if (bufferPool.bindlessIndices[denseIndex] == invalidBindlessIndex)
+    {
+        bufferPool.bindlessIndices[denseIndex] = registerStorageBuffer(bufferPool.buffers[denseIndex], 0, VK_WHOLE_SIZE);
+    }
+
+    return bufferPool.bindlessIndices[denseIndex];
+}
+
+uint32_t resolveBufferBindlessIndex(BufferHandle handle)
+{
+    uint32_t denseIndex = resolveDenseIndex(bufferPool.handles, handle);
+    return denseIndex != invalidDenseIndex ? bufferPool.bindlessIndices[denseIndex] : invalidBindlessIndex;
+}
+
+GpuBuffer resolveGpuBuffer(BufferHandle handle)
+{
+    uint32_t denseIndex = resolveDenseIndex(bufferPool.handles, handle);
+    if (denseIndex == invalidDenseIndex)
+    {
+        GpuBuffer buffer = {};
+        buffer.memoryType = invalidMemoryType;
+        buffer.memoryBlock = invalidMemoryBlock;
+        return buffer;
+    }
+
+    return loadBuffer(denseIndex);
+}
+
+bool replaceBuffer(BufferHandle handle, const GpuBuffer& buffer)
+{
+    uint32_t denseIndex = resolveDenseIndex(bufferPool.handles, handle);
+    if (denseIndex == invalidDenseIndex)
+    {
+        return false;
+    }
+
+    // Frames in flight still index the old descriptor, so the new buffer gets a slot of its own
+    // and the old one retires with the old buffer
+    uint32_t bindlessIndex = bufferPool.bindlessIndices[denseIndex];
+    if (bindlessIndex != invalidBindlessIndex)
+    {
+        uint32_t newIndex = registerStorageBuffer(buffer.buffer, 0, VK_WHOLE_SIZE);
+        if (newIndex == invalidBindlessIndex)
+        {
+            return false;
+        }
+
+        deferBindlessRelease(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bindlessIndex);
+        bufferPool.bindlessIndices[denseIndex] = newIndex;
+    }
+
+    GpuBuffer previous = loadBuffer(denseIndex);
+    releaseGpuBuffer(previous);
+
+    storeBuffer(denseIndex, buffer);
+    return true;
+}
+
+void releaseBuffer(BufferHandle& handle)
+{
+    uint32_t movedFrom;
+    uint32_t denseIndex = releaseHandle(bufferPool.handles, handle, movedFrom);
+    if (denseIndex == invalidDenseIndex)
+    {
+        __debugbreak(); // Released twice
+        return;
+    }
+
+    GpuBuffer buffer = loadBuffer(denseIndex);
+    releaseGpuBuffer(buffer);
+    deferBindlessRelease(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bufferPool.bindlessIndices[denseIndex]);
+
+    storeBuffer(denseIndex, loadBuffer(movedFrom));
+    bufferPool.bindlessIndices[denseIndex] = bufferPool.bindlessIndices[movedFrom];
+
+    handle.value = 0;
+}
+
+void findBuffersInMemoryBlock(uint32_t block, std::vector<BufferHandle>& handles)
+{
+    for (uint32_t i = 0; i < bufferPool.handles.count; i++)
+    {
+        if (bufferPool.memoryBlocks[i] == block)
+        {
+            BufferHandle handle;
+            getHandle(bufferPool.handles, i, handle);
+            handles.push_back(handle);
+        }
+    }
+}
+
+ImageHandle addImage(VkImage image, VkDeviceMemory memory, VkImageView view, VkFormat format, VkExtent2D extent)
+{
+    ImageHandle handle;
+    uint32_t denseIndex = allocateHandle(imagePool.handles, handle);
+    if (denseIndex == invalidDenseIndex)
+    {
+        __debugbreak(); // Raise maxPooledImages
+        return handle;
+    }
+
+    imagePool.images[denseIndex] = image;
+    imagePool.memories[denseIndex] = memory;
+    imagePool.views[denseIndex] = view;
+    imagePool.formats[denseIndex] = format;
+    imagePool.extents[denseIndex] = extent;
+    return handle;
+}
+
+VkImage resolveImage(ImageHandle handle)
+{
+    uint32_t denseIndex = resolveDenseIndex(imagePool.handles, handle);
+    return denseIndex != invalidDenseIndex ? imagePool.images[denseIndex] : VK_NULL_HANDLE;
+}
+
+VkImageView resolveImageView(ImageHandle handle)
+{
+    uint32_t denseIndex = resolveDenseIndex(imagePool.handles, handle);
+    return denseIndex != invalidDenseIndex ? imagePool.views[denseIndex] : VK_NULL_HANDLE;
+}
+
+VkFormat resolveImageFormat(ImageHandle handle)
+{
+    uint32_t denseIndex = resolveDenseIndex(imagePool.handles, handle);
+    return denseIndex != invalidDenseIndex ? imagePool.formats[denseIndex] : VK_FORMAT_UNDEFINED;
+}
+
+VkExtent2D resolveImageExtent(ImageHandle handle)
+{
+    uint32_t denseIndex = resolveDenseIndex(imagePool.handles, handle);
+    return denseIndex != invalidDenseIndex ? imagePool.extents[denseIndex] : VkExtent2D{ 0, 0 };
+}
+
+void releaseImage(ImageHandle& handle)
+{
+    uint32_t movedFrom;
+    uint32_t denseIndex = releaseHandle(imagePool.handles, handle, movedFrom);
+    if (denseIndex == invalidDenseIndex)
+    {
+        __debugbreak(); // Released twice
+        return;
+    }
+
+    // The view goes first, the memory last
+    deferDestruction(VK_OBJECT_TYPE_IMAGE_VIEW, uint64_t(imagePool.views[denseIndex]));
+    deferDestruction(VK_OBJECT_TYPE_IMAGE, uint64_t(imagePool.images[denseIndex]));
+    deferDestruction(VK_OBJECT_TYPE_DEVICE_MEMORY, uint64_t(imagePool.memories[denseIndex]));
+
+    imagePool.images[denseIndex] = imagePool.images[movedFrom];
+    imagePool.memories[denseIndex] = imagePool.memories[movedFrom];
+    imagePool.views[denseIndex] = imagePool.views[movedFrom];
+    imagePool.formats[denseIndex] = imagePool.formats[movedFrom];
+    imagePool.extents[denseIndex] = imagePool.extents[movedFrom];
+
+    handle.value = 0;
+}
+
+PipelineHandle addPipeline(VkPipeline pipeline, VkPipelineBindPoint bindPoint)
+{
+    PipelineHandle handle;
+    uint32_t denseIndex = allocateHandle(pipelinePool.handles, handle);
+    if (denseIndex == invalidDenseIndex)
+    {
+        __debugbreak(); // Raise maxPooledPipelines
+        return handle;
+    }
+
+    pipelinePool.pipelines[denseIndex] = pipeline;
+    pipelinePool.bindPoints[denseIndex] = bindPoint;
+    return handle;
+}
+
+VkPipeline resolvePipeline(PipelineHandle handle)
+{
+    uint32_t denseIndex = resolveDenseIndex(pipelinePool.handles, handle);
+    return denseIndex != invalidDenseIndex ? pipelinePool.pipelines[denseIndex] : VK_NULL_HANDLE;
+}
+
+VkPipelineBindPoint resolvePipelineBindPoint(PipelineHandle handle)
+{
+    uint32_t denseIndex = resolveDenseIndex(pipelinePool.handles, handle);
+    return denseIndex != invalidDenseIndex ? pipelinePool.bindPoints[denseIndex] : VK_PIPELINE_BIND_POINT_GRAPHICS;
+}
+
+void releasePipeline(PipelineHandle& handle)
+{
+    uint32_t movedFrom;
+    uint32_t denseIndex = releaseHandle(pipelinePool.handles, handle, movedFrom);
+    if (denseIndex == invalidDenseIndex)
+    {
+        __debugbreak(); // Released twice
+        return;
+    }
+
+    deferDestruction(VK_OBJECT_TYPE_PIPELINE, uint64_t(pipelinePool.pipelines[denseIndex]));
+
+    pipelinePool.pipelines[denseIndex] = pipelinePool.pipelines[movedFrom];
+    pipelinePool.bindPoints[denseIndex] = pipelinePool.bindPoints[movedFrom];
+
+    handle.value = 0;
+}
+
+SamplerHandle addSampler(VkSampler sampler)
+{
+    SamplerHandle handle;
+    uint32_t denseIndex = allocateHandle(samplerPool.handles, handle);
+    if (denseIndex == invalidDenseIndex)
+    {
+        __debugbreak(); // Raise maxPooledSamplers
+        return handle;
+    }
+
+    samplerPool.samplers[denseIndex] = sampler;
+    return handle;
+}
+
+VkSampler resolveSampler(SamplerHandle handle)
+{
+    uint32_t denseIndex = resolveDenseIndex(samplerPool.handles, handle);
+    return denseIndex != invalidDenseIndex ? samplerPool.samplers[denseIndex] : VK_NULL_HANDLE;
+}
+
+void releaseSampler(SamplerHandle& handle)
+{
+    uint32_t movedFrom;
+    uint32_t denseIndex = releaseHandle(samplerPool.handles, handle, movedFrom);
+    if (denseIndex == invalidDenseIndex)
+    {
+        __debugbreak(); // Released twice
+        return;
+    }
+
+    deferDestruction(VK_OBJECT_TYPE_SAMPLER, uint64_t(samplerPool.samplers[denseIndex]));
+
+    samplerPool.samplers[denseIndex] = samplerPool.samplers[movedFrom];
+
+    handle.value = 0;
+}
+
+ResourcePoolStats getResourcePoolStats()
+{
+    ResourcePoolStats stats;
+    stats.bufferCount = bufferPool.handles.count;
+    stats.imageCount = imagePool.handles.count;
+    stats.pipelineCount = pipelinePool.handles.count;
+    stats.samplerCount = samplerPool.handles.count;
+
+    stats.bufferBytes = 0;
+    for (uint32_t i = 0; i < bufferPool.handles.count; i++)
+    {
+        stats.bufferBytes += bufferPool.sizes[i];
+    }
+
+    return stats;
+}
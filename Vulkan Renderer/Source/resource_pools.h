@@ -0,0 +1,98 @@
+// Vulkan Renderer - resource_pools.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _RESOURCE_POOLS_H_
+#define _RESOURCE_POOLS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "gpu_buffer.h"
+#include "handle_pool.h"
+#include "vkdefines.h"
+
+using BufferHandle   = ResourceHandle<struct BufferTag>;
+using ImageHandle    = ResourceHandle<struct ImageTag>;
+using PipelineHandle = ResourceHandle<struct PipelineTag>;
+using SamplerHandle  = ResourceHandle<struct SamplerTag>;
+
+constexpr uint32_t maxPooledBuffers = 16384;
+constexpr uint32_t maxPooledImages = 16384;
+constexpr uint32_t maxPooledPipelines = 4096;
+constexpr uint32_t maxPooledSamplers = 256;
+
+struct ResourcePoolStats
+{
+    uint32_t     bufferCount;
+    uint32_t     imageCount;
+    uint32_t     pipelineCount;
+    uint32_t     samplerCount;
+    VkDeviceSize bufferBytes;
+};
+
+// Render thread only. The pools take ownership of the objects added to them, releasing a handle hands the
+// objects to the deferred destruction queue. Resolving a released handle breaks into the debugger and
+// returns VK_NULL_HANDLE.
+
+BufferHandle addBuffer(const GpuBuffer& buffer);
+VkBuffer resolveBuffer(BufferHandle handle);
+VkDeviceSize resolveBufferSize(BufferHandle handle);
+void* resolveBufferMapping(BufferHandle handle);
+GpuBuffer resolveGpuBuffer(BufferHandle handle);
+// Registers the whole buffer in the bindless storage buffer array, once per handle. The index changes when
+// residency or the defragmenter move the buffer, so resolve it every frame instead of keeping it around.
+// Releasing the handle retires the index with the buffer.
+uint32_t registerBufferBindless(BufferHandle handle);
+// invalidBindlessIndex unless the buffer was registered
+uint32_t resolveBufferBindlessIndex(BufferHandle handle);
+// Points a live handle at other objects, for moving a buffer between memory types or blocks. The old objects
+// are released like in releaseBuffer. A registered buffer gets a new index and the old one retires with the
+// old buffer. Returns false and leaves the handle as it was if the bindless array is full.
+bool replaceBuffer(BufferHandle handle, const GpuBuffer& buffer);
+void releaseBuffer(BufferHandle& handle);
+// Appends the live buffers bound to the block, in no particular order
+void findBuffersInMemoryBlock(uint32_t block, std::vector<BufferHandle>& handles);
+
+// view may be VK_NULL_HANDLE, memory too for images bound to memory the pool doesn't own
+ImageHandle addImage(VkImage image, VkDeviceMemory memory, VkImageView view, VkFormat format, VkExtent2D extent);
+VkImage resolveImage(ImageHandle handle);
+VkImageView resolveImageView(ImageHandle handle);
+VkFormat resolveImageFormat(ImageHandle handle);
+VkExtent2D resolveImageExtent(ImageHandle handle);
+void releaseImage(ImageHandle& handle);
+
+// For pipelines built outside the pipeline state cache, like the compute ones. Cached graphics pipelines are
+// referenced through their cache entries, which follow the swap to the optimized pipeline.
+PipelineHandle addPipeline(VkPipeline pipeline, VkPipelineBindPoint bindPoint);
+VkPipeline resolvePipeline(PipelineHandle handle);
+VkPipelineBindPoint resolvePipelineBindPoint(PipelineHandle handle);
+void releasePipeline(PipelineHandle& handle);
+
+SamplerHandle addSampler(VkSampler sampler);
+VkSampler resolveSampler(SamplerHandle handle);
+void releaseSampler(SamplerHandle& handle);
+
+// Walks the dense arrays, cheap enough to call every frame
+ResourcePoolStats getResourcePoolStats();
+
+#endif // !_RESOURCE_POOLS_H_
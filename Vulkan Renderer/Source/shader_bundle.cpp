@@ -0,0 +1,195 @@
+// Vulkan Renderer - shader_bundle.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include "windefines.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "shader_bundle.h"
+#include "utility.h"
+
+static const uint8_t*           bundleData = nullptr;
+static size_t                   bundleSize = 0;
+static const ShaderBundleEntry* bundleEntries = nullptr;
+static uint32_t                 bundleEntryCount = 0;
+
+#ifdef _WIN32
+static HANDLE                   bundleFile = INVALID_HANDLE_VALUE;
+static HANDLE                   bundleMapping = nullptr;
+
+static bool mapBundleFile(const char* filePath)
+{
+    bundleFile = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (bundleFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(bundleFile, &fileSize) || size_t(fileSize.QuadPart) < sizeof(ShaderBundleHeader))
+    {
+        return false;
+    }
+
+    bundleMapping = CreateFileMappingA(bundleFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (bundleMapping == nullptr)
+    {
+        return false;
+    }
+
+    bundleData = static_cast<const uint8_t*>(MapViewOfFile(bundleMapping, FILE_MAP_READ, 0, 0, 0));
+    bundleSize = size_t(fileSize.QuadPart);
+
+    return bundleData != nullptr;
+}
+
+static void unmapBundleFile()
+{
+    if (bundleData != nullptr)
+    {
+        UnmapViewOfFile(bundleData);
+    }
+
+    if (bundleMapping != nullptr)
+    {
+        CloseHandle(bundleMapping);
+    }
+
+    if (bundleFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(bundleFile);
+    }
+
+    bundleFile = INVALID_HANDLE_VALUE;
+    bundleMapping = nullptr;
+}
+#else
+static int                      bundleFile = -1;
+
+static bool mapBundleFile(const char* filePath)
+{
+    bundleFile = open(filePath, O_RDONLY);
+    if (bundleFile == -1)
+    {
+        return false;
+    }
+
+    struct stat fileStatus;
+    if (fstat(bundleFile, &fileStatus) != 0 || size_t(fileStatus.st_size) < sizeof(ShaderBundleHeader))
+    {
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, size_t(fileStatus.st_size), PROT_READ, MAP_PRIVATE, bundleFile, 0);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    bundleData = static_cast<const uint8_t*>(mapping);
+    bundleSize = size_t(fileStatus.st_size);
+
+    return true;
+}
+
+static void unmapBundleFile()
+{
+    if (bundleData != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(bundleData), bundleSize);
+    }
+
+    if (bundleFile != -1)
+    {
+        close(bundleFile);
+    }
+
+    bundleFile = -1;
+}
+#endif
+
+uint64_t hashShaderName(const char* name)
+{
+    return hashBytes(name, std::strlen(name));
+}
+
+bool openShaderBundle(const char* filePath)
+{
+    closeShaderBundle();
+
+    if (!mapBundleFile(filePath))
+    {
+        closeShaderBundle();
+        return false;
+    }
+
+    const ShaderBundleHeader* header = reinterpret_cast<const ShaderBundleHeader*>(bundleData);
+    if (header->magic != shaderBundleMagic || header->version != shaderBundleVersion ||
+        sizeof(ShaderBundleHeader) + size_t(header->entryCount) * sizeof(ShaderBundleEntry) > bundleSize)
+    {
+        closeShaderBundle();
+        return false;
+    }
+
+    bundleEntries = reinterpret_cast<const ShaderBundleEntry*>(bundleData + sizeof(ShaderBundleHeader));
+    bundleEntryCount = header->entryCount;
+
+    return true;
+}
+
+const uint32_t* findBundledShader(const char* name, size_t& codeSize)
+{
+    codeSize = 0;
+
+    const uint64_t nameHash = hashShaderName(name);
+    const ShaderBundleEntry* end = bundleEntries + bundleEntryCount;
+
+    const ShaderBundleEntry* entry = std::lower_bound(bundleEntries, end, nameHash, [](const ShaderBundleEntry& entry, uint64_t hash)
+    {
+        return entry.nameHash < hash;
+    });
+
+    if (entry == end || entry->nameHash != nameHash || size_t(entry->offset) + entry->size > bundleSize)
+    {
+        return nullptr;
+    }
+
+    codeSize = entry->size;
+    return reinterpret_cast<const uint32_t*>(bundleData + entry->offset);
+}
+
+void closeShaderBundle()
+{
+    unmapBundleFile();
+
+    bundleData = nullptr;
+    bundleSize = 0;
+    bundleEntries = nullptr;
+    bundleEntryCount = 0;
+}
@@ -0,0 +1,61 @@
+// Vulkan Renderer - shader_bundle.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _SHADER_BUNDLE_H_
+#define _SHADER_BUNDLE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Layout of the bundle written by the shader bundler: the header, entryCount entries sorted by
+// name hash and the SPIR-V of all permutations. Offsets are from the start of the file and keep
+// the code 4 byte aligned, so it can be handed to vkCreateShaderModule straight from the mapping.
+constexpr uint32_t shaderBundleMagic = 0x42565053; // "SPVB"
+constexpr uint32_t shaderBundleVersion = 1;
+
+struct ShaderBundleHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+};
+
+struct ShaderBundleEntry
+{
+    uint64_t nameHash;
+    uint32_t offset;
+    uint32_t size;
+};
+
+uint64_t hashShaderName(const char* name);
+
+// Maps the bundle into memory, returns false if it is missing or was written by another version
+bool openShaderBundle(const char* filePath);
+
+// Returns nullptr if no bundle is open or it doesn't contain the shader
+const uint32_t* findBundledShader(const char* name, size_t& codeSize);
+
+void closeShaderBundle();
+
+#endif // !_SHADER_BUNDLE_H_
@@ -0,0 +1,50 @@
+// Vulkan Renderer - shader_permutations.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _SHADER_PERMUTATIONS_H_
+#define _SHADER_PERMUTATIONS_H_
+
+#include <cstdint>
+
+// Every shader the renderer can request. The shader bundler compiles exactly this list and the renderer
+// loads nothing else, a permutation missing here fails at startup.
+struct ShaderPermutation
+{
+    const char* name;
+    const char* sourcePath; // Relative to the Source directory
+    const char* defines;    // Space separated NAME or NAME=VALUE pairs
+};
+
+constexpr ShaderPermutation shaderPermutations[] =
+{
+    { "vertex_shader",                  "Shaders/vertex_shader.vert",   "" },
+    { "vertex_shader_depth",            "Shaders/vertex_shader.vert",   "DEPTH_ONLY" },
+    { "vertex_shader_gpu_driven",       "Shaders/vertex_shader.vert",   "GPU_DRIVEN" },
+    { "vertex_shader_gpu_driven_depth", "Shaders/vertex_shader.vert",   "GPU_DRIVEN DEPTH_ONLY" },
+    { "fragment_shader",                "Shaders/fragment_shader.frag", "" },
+    { "cull_instances",                 "Shaders/cull_instances.comp",  "" },
+};
+
+constexpr uint32_t shaderPermutationCount = sizeof(shaderPermutations) / sizeof(ShaderPermutation);
+
+#endif // !_SHADER_PERMUTATIONS_H_
@@ -0,0 +1,110 @@
+// Vulkan Renderer - shader_variant.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cstring>
+
+#include "shader_variant.h"
+
+void initSpecializationConstants(SpecializationConstants& constants)
+{
+    std::memset(&constants, 0, sizeof(SpecializationConstants));
+}
+
+void setSpecializationConstant(SpecializationConstants& constants, uint32_t constantId, uint32_t value)
+{
+    uint32_t index = uint32_t(std::lower_bound(constants.constantIds, constants.constantIds + constants.count, constantId) - constants.constantIds);
+
+    if (index < constants.count && constants.constantIds[index] == constantId)
+    {
+        constants.data[index] = value;
+        return;
+    }
+
+    if (constants.count == maxSpecializationConstants)
+    {
+        __debugbreak(); // Raise maxSpecializationConstants
+        return;
+    }
+
+    for (uint32_t i = constants.count; i > index; i--)
+    {
+        constants.constantIds[i] = constants.constantIds[i - 1];
+        constants.data[i] = constants.data[i - 1];
+    }
+
+    constants.constantIds[index] = constantId;
+    constants.data[index] = value;
+    constants.count++;
+}
+
+void setSpecializationConstant(SpecializationConstants& constants, uint32_t constantId, int32_t value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(uint32_t));
+    setSpecializationConstant(constants, constantId, bits);
+}
+
+void setSpecializationConstant(SpecializationConstants& constants, uint32_t constantId, float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(uint32_t));
+    setSpecializationConstant(constants, constantId, bits);
+}
+
+void setSpecializationConstant(SpecializationConstants& constants, uint32_t constantId, bool value)
+{
+    setSpecializationConstant(constants, constantId, uint32_t(value ? VK_TRUE : VK_FALSE));
+}
+
+VkSpecializationInfo getSpecializationInfo(const SpecializationConstants& constants, VkSpecializationMapEntry* mapEntries)
+{
+    for (uint32_t i = 0; i < constants.count; i++)
+    {
+        mapEntries[i].constantID = constants.constantIds[i];
+        mapEntries[i].offset = uint32_t(i * sizeof(uint32_t));
+        mapEntries[i].size = sizeof(uint32_t);
+    }
+
+    VkSpecializationInfo specializationInfo;
+    specializationInfo.mapEntryCount = constants.count;
+    specializationInfo.pMapEntries = mapEntries;
+    specializationInfo.dataSize = constants.count * sizeof(uint32_t);
+    specializationInfo.pData = constants.data;
+
+    return specializationInfo;
+}
+
+bool validateSpecializationConstants(const SpecializationConstants& constants, const ShaderReflection& reflection)
+{
+    for (uint32_t i = 0; i < constants.count; i++)
+    {
+        for (const ReflectedSpecializationConstant& declared : reflection.specializationConstants)
+        {
+            if (declared.constantId == constants.constantIds[i] && declared.size != sizeof(uint32_t))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,56 @@
+// Vulkan Renderer - shader_variant.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _SHADER_VARIANT_H_
+#define _SHADER_VARIANT_H_
+
+#include <cstdint>
+
+#include "spirv_reflection.h"
+#include "vkdefines.h"
+
+constexpr uint32_t maxSpecializationConstants = 8;
+
+// Specialization constant values for one shader stage, constants that are not set keep the default from the shader.
+// IDs are kept sorted and unused slots zeroed, so equal sets compare and hash equal bytewise.
+struct SpecializationConstants
+{
+    uint32_t count;
+    uint32_t constantIds[maxSpecializationConstants];
+    uint32_t data[maxSpecializationConstants];
+};
+
+void initSpecializationConstants(SpecializationConstants& constants);
+
+void setSpecializationConstant(SpecializationConstants& constants, uint32_t constantId, uint32_t value);
+void setSpecializationConstant(SpecializationConstants& constants, uint32_t constantId, int32_t value);
+void setSpecializationConstant(SpecializationConstants& constants, uint32_t constantId, float value);
+void setSpecializationConstant(SpecializationConstants& constants, uint32_t constantId, bool value);
+
+// The returned info points into constants and mapEntries, both have to outlive the pipeline creation
+VkSpecializationInfo getSpecializationInfo(const SpecializationConstants& constants, VkSpecializationMapEntry* mapEntries);
+
+// Constant IDs the shader does not declare are legal and ignored by the driver, only sizes are checked
+bool validateSpecializationConstants(const SpecializationConstants& constants, const ShaderReflection& reflection);
+
+#endif // !_SHADER_VARIANT_H_
@@ -0,0 +1,701 @@
+// Vulkan Renderer - spirv_reflection.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+
+#include "spirv_reflection.h"
+
+// Only the small subset of the SPIR-V specification needed to build layouts is handled here
+constexpr uint32_t spirvMagicNumber = 0x07230203;
+constexpr uint32_t spirvHeaderWordCount = 5;
+
+enum SpirvOp : uint16_t
+{
+    SpirvOpEntryPoint        = 15,
+    SpirvOpTypeBool          = 20,
+    SpirvOpTypeInt           = 21,
+    SpirvOpTypeFloat         = 22,
+    SpirvOpTypeVector        = 23,
+    SpirvOpTypeMatrix        = 24,
+    SpirvOpTypeImage         = 25,
+    SpirvOpTypeSampler       = 26,
+    SpirvOpTypeSampledImage  = 27,
+    SpirvOpTypeArray         = 28,
+    SpirvOpTypeRuntimeArray  = 29,
+    SpirvOpTypeStruct        = 30,
+    SpirvOpTypePointer       = 32,
+    SpirvOpConstant          = 43,
+    SpirvOpSpecConstantTrue  = 48,
+    SpirvOpSpecConstantFalse = 49,
+    SpirvOpSpecConstant      = 50,
+    SpirvOpVariable          = 59,
+    SpirvOpDecorate          = 71,
+    SpirvOpMemberDecorate    = 72
+};
+
+enum SpirvDecoration : uint32_t
+{
+    SpirvDecorationSpecId        = 1,
+    SpirvDecorationBufferBlock   = 3,
+    SpirvDecorationArrayStride   = 6,
+    SpirvDecorationMatrixStride  = 7,
+    SpirvDecorationBuiltIn       = 11,
+    SpirvDecorationLocation      = 30,
+    SpirvDecorationBinding       = 33,
+    SpirvDecorationDescriptorSet = 34,
+    SpirvDecorationOffset        = 35
+};
+
+enum SpirvStorageClass : uint32_t
+{
+    SpirvStorageClassUniformConstant = 0,
+    SpirvStorageClassInput           = 1,
+    SpirvStorageClassUniform         = 2,
+    SpirvStorageClassPushConstant    = 9,
+    SpirvStorageClassStorageBuffer   = 12
+};
+
+constexpr uint32_t spirvDimBuffer = 5;
+constexpr uint32_t spirvDimSubpassData = 6;
+constexpr uint32_t spirvImageStorage = 2;
+
+struct SpirvId
+{
+    uint16_t              opcode;
+    uint32_t              typeId;       // Component, element, pointee or result type depending on the opcode
+    uint32_t              storageClass;
+    uint32_t              width;
+    uint32_t              signedness;
+    uint32_t              count;        // Vector components, matrix columns or the array length id
+    uint32_t              constantValue;
+    uint32_t              dim;
+    uint32_t              sampled;
+    uint32_t              set;
+    uint32_t              binding;
+    uint32_t              location;
+    uint32_t              arrayStride;
+    uint32_t              specId;
+    bool                  hasSpecId;
+    bool                  hasBinding;
+    bool                  hasLocation;
+    bool                  builtIn;
+    bool                  bufferBlock;
+    std::vector<uint32_t> members;
+    std::vector<uint32_t> memberOffsets;
+    std::vector<uint32_t> memberMatrixStrides;
+};
+
+// Every operand read below has to lie within the instruction and every id operand below the id bound of the
+// header, ids index the table directly. Members are capped by the module size, a struct needs a word per member.
+static bool validateInstruction(const uint32_t* instruction, uint16_t opcode, uint16_t length, uint32_t idBound, uint32_t wordCount)
+{
+    uint32_t minimumLength = 1;
+    uint32_t idOperands[3] = {};
+    uint32_t idOperandCount = 0;
+
+    switch (opcode)
+    {
+    case SpirvOpEntryPoint:
+        minimumLength = 2;
+        break;
+    case SpirvOpDecorate:
+        minimumLength = 3;
+        switch (length >= 3 ? instruction[2] : ~0u)
+        {
+        case SpirvDecorationSpecId:
+        case SpirvDecorationArrayStride:
+        case SpirvDecorationLocation:
+        case SpirvDecorationBinding:
+        case SpirvDecorationDescriptorSet:
+            minimumLength = 4;
+            break;
+        }
+        idOperands[idOperandCount++] = 1;
+        break;
+    case SpirvOpMemberDecorate:
+        minimumLength = 4;
+        if (length >= 4 && (instruction[3] == SpirvDecorationOffset || instruction[3] == SpirvDecorationMatrixStride))
+        {
+            minimumLength = 5;
+        }
+        if (length >= 3 && instruction[2] >= wordCount)
+        {
+            return false;
+        }
+        idOperands[idOperandCount++] = 1;
+        break;
+    case SpirvOpTypeBool:
+    case SpirvOpTypeSampler:
+        minimumLength = 2;
+        idOperands[idOperandCount++] = 1;
+        break;
+    case SpirvOpTypeInt:
+        minimumLength = 4;
+        idOperands[idOperandCount++] = 1;
+        break;
+    case SpirvOpTypeFloat:
+        minimumLength = 3;
+        idOperands[idOperandCount++] = 1;
+        break;
+    case SpirvOpTypeVector:
+    case SpirvOpTypeMatrix:
+        minimumLength = 4;
+        idOperands[idOperandCount++] = 1;
+        idOperands[idOperandCount++] = 2;
+        break;
+    case SpirvOpTypeArray:
+        minimumLength = 4;
+        idOperands[idOperandCount++] = 1;
+        idOperands[idOperandCount++] = 2;
+        idOperands[idOperandCount++] = 3;
+        break;
+    case SpirvOpTypeImage:
+        minimumLength = 8;
+        idOperands[idOperandCount++] = 1;
+        idOperands[idOperandCount++] = 2;
+        break;
+    case SpirvOpTypeSampledImage:
+    case SpirvOpTypeRuntimeArray:
+        minimumLength = 3;
+        idOperands[idOperandCount++] = 1;
+        idOperands[idOperandCount++] = 2;
+        break;
+    case SpirvOpTypeStruct:
+        minimumLength = 2;
+        for (uint32_t i = 1; i < length; i++)
+        {
+            if (instruction[i] >= idBound)
+            {
+                return false;
+            }
+        }
+        break;
+    case SpirvOpTypePointer:
+        minimumLength = 4;
+        idOperands[idOperandCount++] = 1;
+        idOperands[idOperandCount++] = 3;
+        break;
+    case SpirvOpConstant:
+    case SpirvOpSpecConstant:
+    case SpirvOpVariable:
+        minimumLength = 4;
+        idOperands[idOperandCount++] = 1;
+        idOperands[idOperandCount++] = 2;
+        break;
+    case SpirvOpSpecConstantTrue:
+    case SpirvOpSpecConstantFalse:
+        minimumLength = 3;
+        idOperands[idOperandCount++] = 1;
+        idOperands[idOperandCount++] = 2;
+        break;
+    }
+
+    if (length < minimumLength)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < idOperandCount; i++)
+    {
+        if (instruction[idOperands[i]] >= idBound)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static VkShaderStageFlagBits getShaderStage(const uint32_t executionModel)
+{
+    switch (executionModel)
+    {
+    case 0:
+        return VK_SHADER_STAGE_VERTEX_BIT;
+    case 1:
+        return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+    case 2:
+        return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    case 3:
+        return VK_SHADER_STAGE_GEOMETRY_BIT;
+    case 4:
+        return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case 5:
+        return VK_SHADER_STAGE_COMPUTE_BIT;
+    default:
+        __debugbreak(); // Unsupported execution model
+        return VK_SHADER_STAGE_ALL;
+    }
+}
+
+static bool getDescriptorType(const std::vector<SpirvId>& ids, const uint32_t typeId, const uint32_t storageClass, VkDescriptorType& descriptorType)
+{
+    const SpirvId& type = ids[typeId];
+
+    if (storageClass == SpirvStorageClassStorageBuffer)
+    {
+        descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        return true;
+    }
+
+    if (storageClass == SpirvStorageClassUniform)
+    {
+        descriptorType = type.bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        return true;
+    }
+
+    switch (type.opcode)
+    {
+    case SpirvOpTypeSampler:
+        descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        return true;
+    case SpirvOpTypeSampledImage:
+        descriptorType = ids[type.typeId].dim == spirvDimBuffer ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        return true;
+    case SpirvOpTypeImage:
+        if (type.dim == spirvDimBuffer)
+        {
+            descriptorType = type.sampled == spirvImageStorage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+        }
+        else if (type.dim == spirvDimSubpassData)
+        {
+            descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        }
+        else
+        {
+            descriptorType = type.sampled == spirvImageStorage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+static uint32_t getTypeSize(const std::vector<SpirvId>& ids, const uint32_t typeId, const uint32_t matrixStride)
+{
+    const SpirvId& type = ids[typeId];
+
+    switch (type.opcode)
+    {
+    case SpirvOpTypeBool:
+        return 4;
+    case SpirvOpTypeInt:
+    case SpirvOpTypeFloat:
+        return type.width / 8;
+    case SpirvOpTypeVector:
+        return type.count * getTypeSize(ids, type.typeId, 0);
+    case SpirvOpTypeMatrix:
+        return type.count * (matrixStride != 0 ? matrixStride : getTypeSize(ids, type.typeId, 0));
+    case SpirvOpTypeArray:
+    {
+        uint32_t elementSize = type.arrayStride != 0 ? type.arrayStride : getTypeSize(ids, type.typeId, matrixStride);
+        return ids[type.count].constantValue * elementSize;
+    }
+    case SpirvOpTypeStruct:
+    {
+        uint32_t size = 0;
+        for (size_t i = 0; i < type.members.size(); i++)
+        {
+            uint32_t memberOffset = i < type.memberOffsets.size() ? type.memberOffsets[i] : 0;
+            uint32_t memberMatrixStride = i < type.memberMatrixStrides.size() ? type.memberMatrixStrides[i] : 0;
+            size = std::max(size, memberOffset + getTypeSize(ids, type.members[i], memberMatrixStride));
+        }
+        return size;
+    }
+    default:
+        return 0;
+    }
+}
+
+static VkFormat getVertexFormat(const std::vector<SpirvId>& ids, const uint32_t typeId, uint32_t& size)
+{
+    static const VkFormat floatFormats[4] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+    static const VkFormat doubleFormats[4] = { VK_FORMAT_R64_SFLOAT, VK_FORMAT_R64G64_SFLOAT, VK_FORMAT_R64G64B64_SFLOAT, VK_FORMAT_R64G64B64A64_SFLOAT };
+    static const VkFormat intFormats[4] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+    static const VkFormat uintFormats[4] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+    const SpirvId* type = &ids[typeId];
+
+    uint32_t componentCount = 1;
+    if (type->opcode == SpirvOpTypeVector)
+    {
+        componentCount = type->count;
+        type = &ids[type->typeId];
+    }
+
+    if (componentCount == 0 || componentCount > 4)
+    {
+        __debugbreak(); // Vertex attributes have at most four components
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    size = componentCount * type->width / 8;
+
+    if (type->opcode == SpirvOpTypeFloat && type->width == 32)
+    {
+        return floatFormats[componentCount - 1];
+    }
+    if (type->opcode == SpirvOpTypeFloat && type->width == 64)
+    {
+        return doubleFormats[componentCount - 1];
+    }
+    if (type->opcode == SpirvOpTypeInt && type->width == 32)
+    {
+        return type->signedness ? intFormats[componentCount - 1] : uintFormats[componentCount - 1];
+    }
+
+    __debugbreak(); // Unsupported vertex attribute type
+    return VK_FORMAT_UNDEFINED;
+}
+
+static void reflectVertexAttributes(const std::vector<SpirvId>& ids, const SpirvId& variable, uint32_t typeId, ShaderReflection& reflection)
+{
+    // Arrays and matrices occupy one location per element or column
+    uint32_t locationCount = 1;
+    while (ids[typeId].opcode == SpirvOpTypeArray)
+    {
+        locationCount *= ids[ids[typeId].count].constantValue;
+        typeId = ids[typeId].typeId;
+    }
+
+    if (ids[typeId].opcode == SpirvOpTypeMatrix)
+    {
+        locationCount *= ids[typeId].count;
+        typeId = ids[typeId].typeId;
+    }
+
+    for (uint32_t i = 0; i < locationCount; i++)
+    {
+        ReflectedVertexAttribute attribute;
+        attribute.location = variable.location + i;
+        attribute.format = getVertexFormat(ids, typeId, attribute.size);
+
+        reflection.vertexAttributes.push_back(attribute);
+    }
+}
+
+ShaderReflection reflectShader(const uint32_t* code, size_t codeSize)
+{
+    ShaderReflection reflection;
+    reflection.stage = VK_SHADER_STAGE_ALL;
+
+    const uint32_t wordCount = uint32_t(codeSize / sizeof(uint32_t));
+    if (wordCount < spirvHeaderWordCount || code[0] != spirvMagicNumber)
+    {
+        __debugbreak(); // Not a SPIR-V module
+        return reflection;
+    }
+
+    const uint32_t idBound = code[3];
+    std::vector<SpirvId> ids(idBound);
+    std::vector<uint32_t> variables;
+    std::vector<uint32_t> constants;
+    uint32_t executionModel = ~0u;
+
+    for (uint32_t offset = spirvHeaderWordCount; offset < wordCount;)
+    {
+        const uint32_t* instruction = code + offset;
+        const uint16_t opcode = uint16_t(instruction[0] & 0xffff);
+        const uint16_t length = uint16_t(instruction[0] >> 16);
+
+        if (length == 0 || offset + length > wordCount)
+        {
+            __debugbreak(); // Malformed instruction stream
+            return reflection;
+        }
+
+        if (!validateInstruction(instruction, opcode, length, idBound, wordCount))
+        {
+            __debugbreak(); // Operand missing or id past the bound of the header
+            return reflection;
+        }
+
+        switch (opcode)
+        {
+        case SpirvOpEntryPoint:
+            if (executionModel == ~0u)
+            {
+                executionModel = instruction[1];
+            }
+            break;
+        case SpirvOpDecorate:
+        {
+            SpirvId& target = ids[instruction[1]];
+            switch (instruction[2])
+            {
+            case SpirvDecorationSpecId:
+                target.specId = instruction[3];
+                target.hasSpecId = true;
+                break;
+            case SpirvDecorationBufferBlock:
+                target.bufferBlock = true;
+                break;
+            case SpirvDecorationArrayStride:
+                target.arrayStride = instruction[3];
+                break;
+            case SpirvDecorationBuiltIn:
+                target.builtIn = true;
+                break;
+            case SpirvDecorationLocation:
+                target.location = instruction[3];
+                target.hasLocation = true;
+                break;
+            case SpirvDecorationBinding:
+                target.binding = instruction[3];
+                target.hasBinding = true;
+                break;
+            case SpirvDecorationDescriptorSet:
+                target.set = instruction[3];
+                break;
+            }
+            break;
+        }
+        case SpirvOpMemberDecorate:
+        {
+            SpirvId& target = ids[instruction[1]];
+            const uint32_t member = instruction[2];
+            if (instruction[3] == SpirvDecorationOffset)
+            {
+                target.memberOffsets.resize(std::max(target.memberOffsets.size(), size_t(member) + 1));
+                target.memberOffsets[member] = instruction[4];
+            }
+            else if (instruction[3] == SpirvDecorationMatrixStride)
+            {
+                target.memberMatrixStrides.resize(std::max(target.memberMatrixStrides.size(), size_t(member) + 1));
+                target.memberMatrixStrides[member] = instruction[4];
+            }
+            break;
+        }
+        case SpirvOpTypeBool:
+        case SpirvOpTypeSampler:
+            ids[instruction[1]].opcode = opcode;
+            break;
+        case SpirvOpTypeInt:
+            ids[instruction[1]].opcode = opcode;
+            ids[instruction[1]].width = instruction[2];
+            ids[instruction[1]].signedness = instruction[3];
+            break;
+        case SpirvOpTypeFloat:
+            ids[instruction[1]].opcode = opcode;
+            ids[instruction[1]].width = instruction[2];
+            break;
+        case SpirvOpTypeVector:
+        case SpirvOpTypeMatrix:
+        case SpirvOpTypeArray:
+            ids[instruction[1]].opcode = opcode;
+            ids[instruction[1]].typeId = instruction[2];
+            ids[instruction[1]].count = instruction[3];
+            break;
+        case SpirvOpTypeImage:
+            ids[instruction[1]].opcode = opcode;
+            ids[instruction[1]].typeId = instruction[2];
+            ids[instruction[1]].dim = instruction[3];
+            ids[instruction[1]].sampled = instruction[7];
+            break;
+        case SpirvOpTypeSampledImage:
+        case SpirvOpTypeRuntimeArray:
+            ids[instruction[1]].opcode = opcode;
+            ids[instruction[1]].typeId = instruction[2];
+            break;
+        case SpirvOpTypeStruct:
+            ids[instruction[1]].opcode = opcode;
+            ids[instruction[1]].members.assign(instruction + 2, instruction + length);
+            break;
+        case SpirvOpTypePointer:
+            ids[instruction[1]].opcode = opcode;
+            ids[instruction[1]].storageClass = instruction[2];
+            ids[instruction[1]].typeId = instruction[3];
+            break;
+        case SpirvOpConstant:
+            ids[instruction[2]].opcode = opcode;
+            ids[instruction[2]].typeId = instruction[1];
+            ids[instruction[2]].constantValue = instruction[3];
+            break;
+        case SpirvOpSpecConstantTrue:
+        case SpirvOpSpecConstantFalse:
+        case SpirvOpSpecConstant:
+            ids[instruction[2]].opcode = opcode;
+            ids[instruction[2]].typeId = instruction[1];
+            ids[instruction[2]].constantValue = opcode == SpirvOpSpecConstant ? instruction[3] : uint32_t(opcode == SpirvOpSpecConstantTrue);
+            constants.push_back(instruction[2]);
+            break;
+        case SpirvOpVariable:
+            ids[instruction[2]].opcode = opcode;
+            ids[instruction[2]].typeId = instruction[1];
+            ids[instruction[2]].storageClass = instruction[3];
+            variables.push_back(instruction[2]);
+            break;
+        }
+
+        offset += length;
+    }
+
+    reflection.stage = getShaderStage(executionModel);
+
+    for (uint32_t variableId : variables)
+    {
+        const SpirvId& variable = ids[variableId];
+        uint32_t typeId = ids[variable.typeId].typeId;
+
+        switch (variable.storageClass)
+        {
+        case SpirvStorageClassUniformConstant:
+        case SpirvStorageClassUniform:
+        case SpirvStorageClassStorageBuffer:
+        {
+            if (!variable.hasBinding)
+            {
+                break;
+            }
+
+            uint32_t descriptorCount = 1;
+            while (ids[typeId].opcode == SpirvOpTypeArray || ids[typeId].opcode == SpirvOpTypeRuntimeArray)
+            {
+                descriptorCount = ids[typeId].opcode == SpirvOpTypeArray ? descriptorCount * ids[ids[typeId].count].constantValue : 0;
+                typeId = ids[typeId].typeId;
+            }
+
+            ReflectedDescriptorBinding binding;
+            binding.set = variable.set;
+            binding.binding = variable.binding;
+            binding.descriptorCount = descriptorCount;
+            binding.stageFlags = reflection.stage;
+
+            if (getDescriptorType(ids, typeId, variable.storageClass, binding.descriptorType))
+            {
+                reflection.descriptorBindings.push_back(binding);
+            }
+            break;
+        }
+        case SpirvStorageClassPushConstant:
+        {
+            const SpirvId& block = ids[typeId];
+            if (block.memberOffsets.empty())
+            {
+                break;
+            }
+
+            VkPushConstantRange pushConstantRange;
+            pushConstantRange.stageFlags = reflection.stage;
+            pushConstantRange.offset = *std::min_element(block.memberOffsets.begin(), block.memberOffsets.end());
+            pushConstantRange.size = getTypeSize(ids, typeId, 0) - pushConstantRange.offset;
+
+            reflection.pushConstantRanges.push_back(pushConstantRange);
+            break;
+        }
+        case SpirvStorageClassInput:
+            if (reflection.stage == VK_SHADER_STAGE_VERTEX_BIT && variable.hasLocation && !variable.builtIn)
+            {
+                reflectVertexAttributes(ids, variable, typeId, reflection);
+            }
+            break;
+        }
+    }
+
+    for (uint32_t constantId : constants)
+    {
+        const SpirvId& constant = ids[constantId];
+        if (!constant.hasSpecId)
+        {
+            continue;
+        }
+
+        // Booleans are specialized through a 32-bit VkBool32, 64-bit constants are not supported
+        ReflectedSpecializationConstant specializationConstant;
+        specializationConstant.constantId = constant.specId;
+        specializationConstant.size = ids[constant.typeId].opcode == SpirvOpTypeBool ? 4 : ids[constant.typeId].width / 8;
+        specializationConstant.defaultValue = constant.constantValue;
+
+        if (specializationConstant.size != 4)
+        {
+            __debugbreak();
+        }
+
+        reflection.specializationConstants.push_back(specializationConstant);
+    }
+
+    std::sort(reflection.descriptorBindings.begin(), reflection.descriptorBindings.end(), [](const ReflectedDescriptorBinding& a, const ReflectedDescriptorBinding& b)
+    {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+
+    std::sort(reflection.vertexAttributes.begin(), reflection.vertexAttributes.end(), [](const ReflectedVertexAttribute& a, const ReflectedVertexAttribute& b)
+    {
+        return a.location < b.location;
+    });
+
+    return reflection;
+}
+
+void getVertexInputDescription(
+    const ShaderReflection& reflection,
+    std::vector<VkVertexInputBindingDescription>& bindings,
+    std::vector<VkVertexInputAttributeDescription>& attributes)
+{
+    bindings.clear();
+    attributes.clear();
+
+    if (reflection.vertexAttributes.empty())
+    {
+        return;
+    }
+
+    uint32_t strides[3] = {};
+    const uint32_t streamBindings[3] = { positionInputBinding, attributeInputBinding, instanceInputBinding };
+    const VkVertexInputRate streamRates[3] = { VK_VERTEX_INPUT_RATE_VERTEX, VK_VERTEX_INPUT_RATE_VERTEX, VK_VERTEX_INPUT_RATE_INSTANCE };
+
+    for (const ReflectedVertexAttribute& reflectedAttribute : reflection.vertexAttributes)
+    {
+        uint32_t stream = 1;
+        if (reflectedAttribute.location == positionAttributeLocation)
+        {
+            stream = 0;
+        }
+        else if (reflectedAttribute.location >= firstInstanceAttributeLocation)
+        {
+            stream = 2;
+        }
+
+        VkVertexInputAttributeDescription attribute;
+        attribute.location = reflectedAttribute.location;
+        attribute.binding = streamBindings[stream];
+        attribute.format = reflectedAttribute.format;
+        attribute.offset = strides[stream];
+
+        attributes.push_back(attribute);
+        strides[stream] += reflectedAttribute.size;
+    }
+
+    for (uint32_t stream = 0; stream < 3; stream++)
+    {
+        if (strides[stream] == 0)
+        {
+            continue;
+        }
+
+        VkVertexInputBindingDescription binding;
+        binding.binding = streamBindings[stream];
+        binding.stride = strides[stream];
+        binding.inputRate = streamRates[stream];
+
+        bindings.push_back(binding);
+    }
+}
@@ -0,0 +1,84 @@
+// Vulkan Renderer - spirv_reflection.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _SPIRV_REFLECTION_H_
+#define _SPIRV_REFLECTION_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "vkdefines.h"
+
+struct ReflectedDescriptorBinding
+{
+    uint32_t           set;
+    uint32_t           binding;
+    VkDescriptorType   descriptorType;
+    uint32_t           descriptorCount; // 0 for runtime sized arrays
+    VkShaderStageFlags stageFlags;
+};
+
+struct ReflectedVertexAttribute
+{
+    uint32_t           location;
+    VkFormat           format;
+    uint32_t           size;
+};
+
+struct ReflectedSpecializationConstant
+{
+    uint32_t           constantId;
+    uint32_t           size;
+    uint32_t           defaultValue;
+};
+
+struct ShaderReflection
+{
+    VkShaderStageFlagBits                        stage;
+    std::vector<ReflectedDescriptorBinding>      descriptorBindings;
+    std::vector<VkPushConstantRange>             pushConstantRanges;
+    std::vector<ReflectedVertexAttribute>        vertexAttributes; // Only filled for vertex shaders, sorted by location
+    std::vector<ReflectedSpecializationConstant> specializationConstants;
+};
+
+// codeSize is in bytes, same as VkShaderModuleCreateInfo::codeSize
+ShaderReflection reflectShader(const uint32_t* code, size_t codeSize);
+
+// Location 0 is the position and gets a stream of its own, so depth-only passes fetch nothing else.
+// Vertex shader inputs at firstInstanceAttributeLocation and above are per-instance.
+constexpr uint32_t positionAttributeLocation = 0;
+constexpr uint32_t firstInstanceAttributeLocation = 8;
+constexpr uint32_t positionInputBinding = 0;
+constexpr uint32_t instanceInputBinding = 1;
+constexpr uint32_t attributeInputBinding = 2;
+
+// Packs the position into positionInputBinding, the remaining per-vertex attributes into attributeInputBinding
+// and the per-instance ones into instanceInputBinding, each tightly in location order. Bindings without
+// attributes are left out.
+void getVertexInputDescription(
+    const ShaderReflection& reflection,
+    std::vector<VkVertexInputBindingDescription>& bindings,
+    std::vector<VkVertexInputAttributeDescription>& attributes
+);
+
+#endif // !_SPIRV_REFLECTION_H_
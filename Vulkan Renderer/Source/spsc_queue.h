@@ -0,0 +1,95 @@
+// Vulkan Renderer - spsc_queue.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _SPSC_QUEUE_H_
+#define _SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstdint>
+
+// Bounded lock-free queue for exactly one producer and one consumer thread. Both indices count up forever
+// and wrap around through unsigned overflow, the slot is the index modulo the capacity. Each side keeps a
+// copy of the other side's index on its own cache line and only reloads it when the copy says full or empty.
+template<typename T, uint32_t Capacity>
+struct SpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+    T items[Capacity];
+
+    alignas(64) std::atomic<uint32_t> tail{ 0 }; // Written by the producer
+    uint32_t cachedHead = 0;
+
+    alignas(64) std::atomic<uint32_t> head{ 0 }; // Written by the consumer
+    uint32_t cachedTail = 0;
+};
+
+// Producer only. Returns false if the queue is full.
+template<typename T, uint32_t Capacity>
+bool pushSpsc(SpscQueue<T, Capacity>& queue, const T& item)
+{
+    uint32_t tail = queue.tail.load(std::memory_order_relaxed);
+
+    if (tail - queue.cachedHead == Capacity)
+    {
+        queue.cachedHead = queue.head.load(std::memory_order_acquire);
+        if (tail - queue.cachedHead == Capacity)
+        {
+            return false;
+        }
+    }
+
+    queue.items[tail & (Capacity - 1)] = item;
+    queue.tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+// Any thread. Only a snapshot, the other side may push or pop right after.
+template<typename T, uint32_t Capacity>
+uint32_t getSpscSize(const SpscQueue<T, Capacity>& queue)
+{
+    uint32_t head = queue.head.load(std::memory_order_acquire);
+    return queue.tail.load(std::memory_order_acquire) - head;
+}
+
+// Consumer only. Returns false if the queue is empty.
+template<typename T, uint32_t Capacity>
+bool popSpsc(SpscQueue<T, Capacity>& queue, T& item)
+{
+    uint32_t head = queue.head.load(std::memory_order_relaxed);
+
+    if (head == queue.cachedTail)
+    {
+        queue.cachedTail = queue.tail.load(std::memory_order_acquire);
+        if (head == queue.cachedTail)
+        {
+            return false;
+        }
+    }
+
+    item = queue.items[head & (Capacity - 1)];
+    queue.head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+#endif // !_SPSC_QUEUE_H_
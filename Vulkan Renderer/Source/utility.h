@@ -24,9 +24,17 @@
 #ifndef _UTILITY_H_
 #define _UTILITY_H_
 
+#include <cstdint>
 #include <vector>
 #include <string_view>
 
+#include "platform.h"
+
+constexpr uint64_t fnvOffsetBasis = 14695981039346656037ull;
+
 std::vector<char> loadFile(const std::string_view& filePath);
 
+// 64-bit FNV-1a, pass the previous result as seed to hash several ranges in sequence
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = fnvOffsetBasis);
+
 #endif // !_UTILITY_H_
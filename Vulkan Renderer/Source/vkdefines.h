@@ -26,12 +26,19 @@
 
 #include <cstdlib>
 
+#include "platform.h"
+
+#ifdef _MSC_VER
 // I fucking despise this warning, why is this shit enabled on /W3?
 #pragma warning(disable: 26812)
+#endif
 
-#define VK_USE_PLATFORM_WIN32_KHR
+// Platform surface types are only needed by the window backends, which include their own headers
 #include <vulkan/vulkan.hpp>
 
+// Every file that talks to Vulkan calls the per-frame device functions through the dispatch table
+#include "device_dispatch.h"
+
 #ifdef _DEBUG
 #define CHECK_VKRESULT(x) \
 	if (x != VK_SUCCESS) \
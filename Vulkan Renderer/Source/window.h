@@ -0,0 +1,59 @@
+// Vulkan Renderer - window.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _WINDOW_H_
+#define _WINDOW_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "vkdefines.h"
+#include "window_events.h"
+
+// Win32 is the default on Windows, define WINDOW_BACKEND_GLFW to build the GLFW backend there as well.
+// Everywhere else GLFW is the default. WINDOW_BACKEND_HEADLESS opens no window at all and presents to a
+// VK_EXT_headless_surface, for benchmarks on machines without a display.
+#if !defined(_WIN32) && !defined(WINDOW_BACKEND_GLFW) && !defined(WINDOW_BACKEND_HEADLESS)
+#define WINDOW_BACKEND_GLFW
+#endif
+
+// Main thread. Window events are posted to events from here on, including the ones sent while the window opens.
+void createWindow(uint32_t width, uint32_t height, const char* title, WindowEventQueue& events);
+
+// Any thread, appends the instance extensions the backend needs to create its surface
+void getWindowInstanceExtensions(std::vector<const char*>& extensions);
+
+// Any thread, the render thread creates the surface together with the instance
+VkSurfaceKHR createWindowSurface(VkInstance instance);
+
+// Main thread. Pumps OS messages until the window closes or closeWindow is called, then posts the quit flag.
+// The headless backend returns right away, there is nothing that could close.
+void runWindowMessageLoop();
+
+// Any thread. Ends runWindowMessageLoop without asking the user, for when the render thread stops on its own.
+void closeWindow();
+
+// Main thread, after the render thread destroyed the surface
+void destroyWindow();
+
+#endif // !_WINDOW_H_
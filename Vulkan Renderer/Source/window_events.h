@@ -0,0 +1,97 @@
+// Vulkan Renderer - window_events.h
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#ifndef _WINDOW_EVENTS_H_
+#define _WINDOW_EVENTS_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "spsc_queue.h"
+
+enum WindowEventType : uint32_t
+{
+    WindowEventResize,    // width and height hold the new client size
+    WindowEventMinimize,
+    WindowEventKeyDown,   // key holds the key code of the window backend, below maxKeyCode
+    WindowEventKeyUp,
+    WindowEventMouseMove  // x and y hold the cursor position in client coordinates
+};
+
+// Only the fields named by the type are meaningful
+struct WindowEvent
+{
+    WindowEventType type;
+    uint32_t        width;
+    uint32_t        height;
+    int32_t         x;
+    int32_t         y;
+    uint32_t        key;
+};
+
+constexpr uint32_t windowEventQueueCapacity = 1024;
+
+// Mouse moves stop here, the rest of the queue is kept for events that can't be coalesced
+constexpr uint32_t maxQueuedMouseMoves = windowEventQueueCapacity * 3 / 4;
+
+// Covers Win32 virtual key codes and GLFW key codes
+constexpr uint32_t maxKeyCode = 512;
+
+// Filled by the thread that pumps the OS messages, drained by the render thread once per frame.
+// Quitting is a flag rather than an event so it gets through while the queue is full.
+struct WindowEventQueue
+{
+    SpscQueue<WindowEvent, windowEventQueueCapacity> events;
+    std::atomic<bool>                                quit{ false };
+};
+
+// Never blocks, the window has to keep answering the OS while the render thread is busy or gone.
+// Mouse moves past maxQueuedMouseMoves are dropped, the next one that fits carries the latest position.
+// Returns false if the event was dropped.
+inline bool postWindowEvent(WindowEventQueue& queue, const WindowEvent& event)
+{
+    if (event.type == WindowEventMouseMove && getSpscSize(queue.events) >= maxQueuedMouseMoves)
+    {
+        return false;
+    }
+
+    return pushSpsc(queue.events, event);
+}
+
+inline void postWindowQuit(WindowEventQueue& queue)
+{
+    queue.quit.store(true, std::memory_order_release);
+}
+
+// Consumer side. Returns false once the queue is empty.
+inline bool popWindowEvent(WindowEventQueue& queue, WindowEvent& event)
+{
+    return popSpsc(queue.events, event);
+}
+
+inline bool isWindowQuitPosted(const WindowEventQueue& queue)
+{
+    return queue.quit.load(std::memory_order_acquire);
+}
+
+#endif // !_WINDOW_EVENTS_H_
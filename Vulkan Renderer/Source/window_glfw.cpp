@@ -0,0 +1,142 @@
+// Vulkan Renderer - window_glfw.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "host_allocator.h"
+#include "window.h"
+
+#ifdef WINDOW_BACKEND_GLFW
+
+#define GLFW_INCLUDE_VULKAN
+#include <glfw/glfw3.h>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "glfw3.lib")
+#endif
+
+static GLFWwindow*       window = nullptr;
+static WindowEventQueue* eventQueue = nullptr;
+
+// The callbacks run on the main thread from within glfwWaitEvents, same as the Win32 window procedure
+static void onFramebufferSize(GLFWwindow*, int width, int height)
+{
+    // Minimizing shrinks the framebuffer to zero on every platform
+    WindowEvent event = {};
+    event.type = width == 0 || height == 0 ? WindowEventMinimize : WindowEventResize;
+    event.width = uint32_t(width);
+    event.height = uint32_t(height);
+    postWindowEvent(*eventQueue, event);
+}
+
+static void onKey(GLFWwindow*, int key, int, int action, int)
+{
+    if (key < 0 || uint32_t(key) >= maxKeyCode)
+    {
+        return;
+    }
+
+    // Repeats count as presses, like WM_KEYDOWN
+    WindowEvent event = {};
+    event.type = action == GLFW_RELEASE ? WindowEventKeyUp : WindowEventKeyDown;
+    event.key = uint32_t(key);
+    postWindowEvent(*eventQueue, event);
+}
+
+static void onCursorPosition(GLFWwindow*, double x, double y)
+{
+    WindowEvent event = {};
+    event.type = WindowEventMouseMove;
+    event.x = int32_t(x);
+    event.y = int32_t(y);
+    postWindowEvent(*eventQueue, event);
+}
+
+void createWindow(uint32_t width, uint32_t height, const char* title, WindowEventQueue& events)
+{
+    eventQueue = &events;
+
+    if (!glfwInit())
+    {
+        __debugbreak(); // No display
+        return;
+    }
+
+    // Vulkan renders into the window, GLFW must not create a GL context for it
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+
+    window = glfwCreateWindow(int(width), int(height), title, nullptr, nullptr);
+    if (window == nullptr)
+    {
+        __debugbreak();
+        return;
+    }
+
+    glfwSetFramebufferSizeCallback(window, onFramebufferSize);
+    glfwSetKeyCallback(window, onKey);
+    glfwSetCursorPosCallback(window, onCursorPosition);
+}
+
+void getWindowInstanceExtensions(std::vector<const char*>& extensions)
+{
+    uint32_t extensionCount = 0;
+    const char** requiredExtensions = glfwGetRequiredInstanceExtensions(&extensionCount);
+    if (requiredExtensions == nullptr)
+    {
+        __debugbreak(); // No Vulkan loader or no surface support on this platform
+        return;
+    }
+
+    extensions.insert(extensions.end(), requiredExtensions, requiredExtensions + extensionCount);
+}
+
+VkSurfaceKHR createWindowSurface(VkInstance instance)
+{
+    VkSurfaceKHR surface;
+    VkResult result = glfwCreateWindowSurface(instance, window, getHostAllocator(VK_OBJECT_TYPE_SURFACE_KHR), &surface);
+    CHECK_VKRESULT(result);
+
+    return surface;
+}
+
+void runWindowMessageLoop()
+{
+    // Blocks until there are events, the render thread keeps going regardless
+    while (!glfwWindowShouldClose(window))
+    {
+        glfwWaitEvents();
+    }
+
+    postWindowQuit(*eventQueue);
+}
+
+void closeWindow()
+{
+    // Both may be called from any thread, the empty event wakes glfwWaitEvents to see the flag
+    glfwSetWindowShouldClose(window, GLFW_TRUE);
+    glfwPostEmptyEvent();
+}
+
+void destroyWindow()
+{
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
+
+#endif // WINDOW_BACKEND_GLFW
@@ -0,0 +1,82 @@
+// Vulkan Renderer - window_headless.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "host_allocator.h"
+#include "window.h"
+
+#ifdef WINDOW_BACKEND_HEADLESS
+
+static WindowEventQueue* eventQueue = nullptr;
+
+void createWindow(uint32_t width, uint32_t height, const char*, WindowEventQueue& events)
+{
+    eventQueue = &events;
+
+    // The headless surface leaves the extent to the swapchain, this is the size it gets
+    WindowEvent event = {};
+    event.type = WindowEventResize;
+    event.width = width;
+    event.height = height;
+    postWindowEvent(*eventQueue, event);
+}
+
+void getWindowInstanceExtensions(std::vector<const char*>& extensions)
+{
+    extensions.push_back("VK_KHR_surface");
+    extensions.push_back("VK_EXT_headless_surface");
+}
+
+VkSurfaceKHR createWindowSurface(VkInstance instance)
+{
+    // Not every loader exports the entry point
+    PFN_vkCreateHeadlessSurfaceEXT vkCreateHeadlessSurface = (PFN_vkCreateHeadlessSurfaceEXT)vkGetInstanceProcAddr(instance, "vkCreateHeadlessSurfaceEXT");
+    if (vkCreateHeadlessSurface == nullptr)
+    {
+        __debugbreak(); // Driver without VK_EXT_headless_surface
+        return VK_NULL_HANDLE;
+    }
+
+    VkHeadlessSurfaceCreateInfoEXT surfaceCreateInfo;
+    surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+    surfaceCreateInfo.pNext = nullptr;
+    surfaceCreateInfo.flags = 0;
+
+    VkSurfaceKHR surface;
+    VkResult result = vkCreateHeadlessSurface(instance, &surfaceCreateInfo, getHostAllocator(VK_OBJECT_TYPE_SURFACE_KHR), &surface);
+    CHECK_VKRESULT(result);
+
+    return surface;
+}
+
+void runWindowMessageLoop()
+{
+    // The render thread stops on its own once it reached its frame limit
+}
+
+void closeWindow()
+{
+}
+
+void destroyWindow()
+{
+}
+
+#endif // WINDOW_BACKEND_HEADLESS
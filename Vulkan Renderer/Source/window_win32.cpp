@@ -0,0 +1,184 @@
+// Vulkan Renderer - window_win32.cpp
+//
+// Copyright (c) 2020 Meowmere
+//
+// https://github.com/Meowmere420/Vulkan-Renderer
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without restriction,
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "host_allocator.h"
+#include "window.h"
+
+#if !defined(WINDOW_BACKEND_GLFW) && !defined(WINDOW_BACKEND_HEADLESS)
+
+#include "windefines.h"
+#include <vulkan/vulkan_win32.h>
+
+static HINSTANCE         windowClass;
+static HWND              windowHandle;
+static const char*       windowClassName = "Vulkan Renderer Window";
+static WindowEventQueue* eventQueue = nullptr;
+
+// Posted by closeWindow, skips the confirmation of WM_CLOSE
+constexpr UINT closeWindowMessage = WM_APP;
+
+// Runs on the main thread. Nothing in here touches renderer state, so a blocking message such as the
+// close confirmation or a window drag never holds up a frame.
+static LRESULT WINAPI processMessage(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
+{
+    WindowEvent event = {};
+
+    switch (msg)
+    {
+    case WM_CLOSE:
+    {
+        if (MessageBox(hwnd, L"Close application?", L"Vulkan Renderer Application", MB_OKCANCEL | MB_ICONQUESTION) == IDOK)
+        {
+            PostQuitMessage(0);
+        }
+        return 0;
+    }
+    case closeWindowMessage:
+    {
+        PostQuitMessage(0);
+        return 0;
+    }
+    case WM_SIZE:
+    {
+        event.type = wparam == SIZE_MINIMIZED ? WindowEventMinimize : WindowEventResize;
+        event.width = LOWORD(lparam);
+        event.height = HIWORD(lparam);
+        postWindowEvent(*eventQueue, event);
+        return 0;
+    }
+    case WM_KEYDOWN:
+    case WM_KEYUP:
+    {
+        event.type = msg == WM_KEYDOWN ? WindowEventKeyDown : WindowEventKeyUp;
+        event.key = uint32_t(wparam);
+        postWindowEvent(*eventQueue, event);
+        return 0;
+    }
+    case WM_MOUSEMOVE:
+    {
+        // Signed, the position is negative left of or above the client area while captured
+        event.type = WindowEventMouseMove;
+        event.x = int16_t(LOWORD(lparam));
+        event.y = int16_t(HIWORD(lparam));
+        postWindowEvent(*eventQueue, event);
+        return 0;
+    }
+    default:
+        return DefWindowProcA(hwnd, msg, wparam, lparam);
+    }
+}
+
+void createWindow(uint32_t width, uint32_t height, const char* title, WindowEventQueue& events)
+{
+    eventQueue = &events;
+    windowClass = GetModuleHandleA(nullptr);
+
+    // ANSI class and window, the title comes in as a plain char string
+
+    WNDCLASSEXA wndClass;
+    ZeroMemory(&wndClass, sizeof(WNDCLASSEXA));
+    wndClass.cbSize = sizeof(WNDCLASSEXA);
+    wndClass.style = CS_OWNDC;
+    wndClass.lpfnWndProc = processMessage;
+    wndClass.cbClsExtra = 0;
+    wndClass.cbWndExtra = 0;
+    wndClass.hInstance = windowClass;
+    wndClass.hIcon = nullptr;
+    wndClass.hCursor = nullptr;
+    wndClass.lpszMenuName = nullptr;
+    wndClass.lpszClassName = windowClassName;
+    wndClass.hIconSm = nullptr;
+
+    RegisterClassExA(&wndClass);
+
+    LONG windowStyle = WS_OVERLAPPEDWINDOW;
+    RECT clientSize = { 0, 0, LONG(width), LONG(height) };
+    AdjustWindowRect(&clientSize, windowStyle, FALSE);
+
+    windowHandle = CreateWindowA(
+        windowClassName,
+        title,
+        windowStyle,
+        CW_USEDEFAULT,
+        CW_USEDEFAULT,
+        clientSize.right - clientSize.left,
+        clientSize.bottom - clientSize.top,
+        NULL,
+        NULL,
+        windowClass,
+        nullptr
+    );
+
+    HRESULT hresult = GetLastError();
+    if (hresult != S_OK)
+    {
+        __debugbreak();
+    }
+
+    ShowWindow(windowHandle, SW_SHOWDEFAULT);
+}
+
+void getWindowInstanceExtensions(std::vector<const char*>& extensions)
+{
+    extensions.push_back("VK_KHR_surface");
+    extensions.push_back("VK_KHR_win32_surface");
+}
+
+VkSurfaceKHR createWindowSurface(VkInstance instance)
+{
+    VkWin32SurfaceCreateInfoKHR surfaceCreateInfo;
+    surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
+    surfaceCreateInfo.pNext = nullptr;
+    surfaceCreateInfo.flags = 0;
+    surfaceCreateInfo.hinstance = windowClass;
+    surfaceCreateInfo.hwnd = windowHandle;
+
+    VkSurfaceKHR surface;
+    VkResult result = vkCreateWin32SurfaceKHR(instance, &surfaceCreateInfo, getHostAllocator(VK_OBJECT_TYPE_SURFACE_KHR), &surface);
+    CHECK_VKRESULT(result);
+
+    return surface;
+}
+
+void runWindowMessageLoop()
+{
+    MSG msg;
+    while (GetMessage(&msg, nullptr, 0, 0) > 0)
+    {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+
+    postWindowQuit(*eventQueue);
+}
+
+void closeWindow()
+{
+    PostMessageA(windowHandle, closeWindowMessage, 0, 0);
+}
+
+void destroyWindow()
+{
+    DestroyWindow(windowHandle);
+    UnregisterClassA(windowClassName, windowClass);
+}
+
+#endif // !WINDOW_BACKEND_GLFW && !WINDOW_BACKEND_HEADLESS